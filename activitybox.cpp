@@ -1,5 +1,6 @@
 #include "activitybox.h"
 #include "ui_activitybox.h"
+#include "starcatalogreader.h"
 #include <QMessageBox>
 #include <QIcon>
 #include <QSqlDatabase>
@@ -8,6 +9,11 @@
 #include <QListWidget>
 #include <QMessageBox>
 #include <QInputDialog>
+#include <QGuiApplication>
+#include <QAbstractItemView>
+#include <QThreadPool>
+#include <QPointer>
+#include <QElapsedTimer>
 
 // Set the stylesheet for give button
 void ActivityBox::setButtonImage(QPushButton* button, const QString& normalPath, const QString& pressedPath) {
@@ -112,7 +118,7 @@ ActivityBox::ActivityBox(QWidget *parent)
 
     // Connect the toggle camera mode button
     connect(ui->toggleCameraModeButton, &QPushButton::clicked, this, &ActivityBox::onToggleCameraModeClicked);
-    connect(ui->typeBox, &QComboBox::currentTextChanged,
+    connect(ui->typeBox, &QComboBox::textActivated,
             this, &ActivityBox::onTypeBoxChanged);
 
     // Set the initial button images
@@ -124,6 +130,19 @@ ActivityBox::ActivityBox(QWidget *parent)
     QObject::connect(ui->searchLineEdit, &QLineEdit::textChanged, [=](const QString &text){
         ui->searchButton->setVisible(!text.trimmed().isEmpty());
     });
+
+    // Förslag medan man skriver, från prefixindexet. Listan är redan filtrerad
+    // och rankad, så completern ska visa den som den är.
+    m_idSuggestions = new QStringListModel(this);
+    m_idCompleter = new QCompleter(m_idSuggestions, this);
+    m_idCompleter->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    m_idCompleter->setMaxVisibleItems(MAX_ID_SUGGESTIONS);
+    m_idCompleter->setWidget(ui->searchLineEdit);
+    connect(ui->searchLineEdit, &QLineEdit::textEdited, this, &ActivityBox::onSearchTextEdited);
+    connect(m_idCompleter, QOverload<const QString &>::of(&QCompleter::activated), this, [this](const QString &id) {
+        ui->searchLineEdit->setText(id);
+        searchById(id);
+    });
 }
 
 ActivityBox::~ActivityBox()
@@ -148,6 +167,66 @@ void ActivityBox::updateCameraModeButton(int mode)
     }
 }
 
+// Searches read from the catalog instead of the stars database
+void ActivityBox::setCatalog(const StarCatalog *catalog) {
+    m_catalog = catalog;
+    rebuildIdIndex();
+}
+
+// Drops the index when the catalog is about to be refilled, its rows would point at other stars
+void ActivityBox::clearIdIndex() {
+    ++m_idIndexGeneration;
+    m_idIndex.clear();
+    m_idSuggestions->setStringList(QStringList());
+    m_idCompleter->popup()->hide();
+}
+
+// Sorts the ids for the suggestions on a worker thread, the old index answers until it's done
+void ActivityBox::rebuildIdIndex() {
+    if (!m_catalog)
+        return;
+
+    const int generation = ++m_idIndexGeneration;
+    const QVector<QString> ids = m_catalog->ids();
+    QPointer<ActivityBox> target(this);
+
+    QThreadPool::globalInstance()->start([target, ids, generation]() {
+        QElapsedTimer timer;
+        timer.start();
+        StarIdIndex index;
+        index.build(ids);
+        qCDebug(lcStarLoading) << "indexed" << index.count() << "star ids in" << timer.elapsed() << "ms";
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [target, index, generation]() {
+            // Only the latest build counts, the catalog may have changed again since
+            if (target && target->m_idIndexGeneration == generation)
+                target->m_idIndex = index;
+        }, Qt::QueuedConnection);
+    });
+}
+
+// Shows the best matches for what has been typed so far
+void ActivityBox::onSearchTextEdited(const QString &text) {
+    const QVector<int> rows = m_idIndex.complete(text, MAX_ID_SUGGESTIONS);
+
+    // The index may be from before an edit, only rows whose id still matches are shown
+    const QByteArray key = StarIdIndex::normalized(text);
+    QStringList suggestions;
+    for (int row : rows) {
+        if (m_catalog && row < m_catalog->count()
+            && StarIdIndex::normalized(m_catalog->id(row)).startsWith(key)) {
+            suggestions << m_catalog->id(row);
+        }
+    }
+
+    m_idSuggestions->setStringList(suggestions);
+    if (suggestions.isEmpty()) {
+        m_idCompleter->popup()->hide();
+    } else {
+        m_idCompleter->complete();
+    }
+}
+
 // Updates infobox to current stars info
 void ActivityBox::setCurrentStarId(const QString& starId) {
     currentStarId = starId;
@@ -205,30 +284,23 @@ void ActivityBox::searchById(const QString &id) {
         return;
     }
 
-    // Get the existing open connection to the stars database
-    QSqlDatabase db = QSqlDatabase::database("starsConnection");
-
-    // Prepare a query to retrieve the star's coordinates by ID
-    QSqlQuery query(db);
-    query.prepare("SELECT x_koord, y_koord, z_koord FROM stars WHERE MAIN_ID = ?");
-    query.addBindValue(id);
+    // Look the star up in the catalog, a hash lookup instead of a query
+    int row = m_catalog ? m_catalog->indexOf(id) : -1;
 
-    // Execute the query and check for errors
-    if (!query.exec()) {
-        QMessageBox::warning(this, "Query Error",
-                             "Failed to execute query: " + query.lastError().text());
-        return;
+    // Otherwise the same id written with other case or spacing, "hd 48915" for "HD  48915"
+    if (row < 0 && m_catalog) {
+        row = m_idIndex.find(id);
+        if (row >= m_catalog->count()
+            || (row >= 0 && StarIdIndex::normalized(m_catalog->id(row)) != StarIdIndex::normalized(id))) {
+            row = -1;
+        }
     }
 
-    // If a match is found, extract coordinates and teleport to the star
-    if (query.next()) {
-        QVector3D starCoordinates(
-            query.value(0).toFloat(),
-            query.value(1).toFloat(),
-            query.value(2).toFloat()
-            );
-        emit teleportToStar(starCoordinates, id);  // Emit both coordinates and ID
-        setCurrentStarId(id);  // Update the current star ID
+    // If a match is found, teleport to the star's scene position
+    if (row >= 0) {
+        const QString starId = m_catalog->id(row);
+        emit teleportToStar(m_catalog->scenePosition(row), starId);  // Emit both coordinates and ID
+        setCurrentStarId(starId);  // Update the current star ID
     } else {
         // If no match found, inform the user
         QMessageBox::information(this, "Search Result", "No star found with ID: " + id);
@@ -650,63 +722,56 @@ void ActivityBox::onSunButtonClicked(){
     updateFavoriteButtonIcon();
 }
 
-void ActivityBox::searchByType(const QString &typeFilter)
+// Kör typfiltret, klasser och luminositetsklasser från typeBox kombinerade
+void ActivityBox::searchByType()
 {
-    QSqlDatabase db = QSqlDatabase::database("starsConnection");
-    if (!db.isOpen()) {
-        QMessageBox::warning(this, "Database Error", "Database connection is not open.");
+    if (!m_catalog) {
+        QMessageBox::warning(this, "Database Error", "The star catalog is not loaded.");
         return;
     }
 
-    QSqlQuery query(db);
-    QString pattern;
+    // Rensa tidigare sökresultat
+    ui->searchResultsList->clear();
 
-    // Skapa mönster baserat på valt filter
-    if (typeFilter == "O" || typeFilter == "B" || typeFilter == "A" ||
-        typeFilter == "F" || typeFilter == "G" || typeFilter == "K" || typeFilter == "M") {
-        pattern = typeFilter + "%";
-    }
-    else if (typeFilter == "Supergiant (I)") {
-        pattern = "%I";
-    }
-    else if (typeFilter == "Bright Giant (II)") {
-        pattern = "%II";
-    }
-    else if (typeFilter == "Giant (III)") {
-        pattern = "%III";
-    }
-    else if (typeFilter == "Subgiant (IV)") {
-        pattern = "%IV";
-    }
-    else {
-        // Om inget giltigt filter, hämta alla stjärnor
-        pattern = "%";
+    if (m_typeClasses.isEmpty() && m_typeLuminosities.isEmpty()) {
+        ui->typeBox->setPlaceholderText("Type");
+        emit typeMatched(StarBitmap());
+        return;
     }
 
-    query.prepare("SELECT MAIN_ID, x_koord, y_koord, z_koord, SP_TYPE FROM stars WHERE SP_TYPE LIKE ?");
-    query.addBindValue(pattern);
+    // Beskrivning av filtret, t.ex. "O, B Dwarf Star"
+    QStringList classNames;
+    for (SpectralType::Class spectralClass : std::as_const(m_typeClasses))
+        classNames << typeBoxText(spectralClass, SpectralType::UnknownLuminosity);
+    QStringList luminosityNames;
+    for (SpectralType::Luminosity luminosity : std::as_const(m_typeLuminosities))
+        luminosityNames << typeBoxText(SpectralType::UnknownClass, luminosity);
+    const QString description = QStringList({ classNames.join(", "), luminosityNames.join(", ") }).join(' ').trimmed();
+    ui->typeBox->setPlaceholderText(description);
 
-    if (!query.exec()) {
-        QMessageBox::warning(this, "Query Error", "Failed to execute query: " + query.lastError().text());
-        return;
-    }
+    // Bitmapparna ger svaret direkt, (O | B) & V
+    const StarBitmap matches = m_catalog->spectralIndex().match(m_typeClasses, m_typeLuminosities);
+    emit typeMatched(matches);
 
-    // Rensa tidigare sökresultat och se till att listwidgeten syns
-    ui->searchResultsList->clear();
     ui->searchResultsList->setVisible(true);
-
-    bool foundAny = false;
-    while (query.next()) {
-        QString starId = query.value(0).toString();
-        QString spType = query.value(4).toString();
+    int listed = 0;
+    matches.forEach([this, &listed](int row) {
+        if (listed++ >= MAX_TYPE_RESULTS)
+            return;
         // Bygg en beskrivande text, t.ex. "StarID (spType)"
-        QString displayText = starId + " (" + spType + ")";
+        QString displayText = m_catalog->id(row) + " (" + m_catalog->spectralType(row) + ")";
         ui->searchResultsList->addItem(displayText);
-        foundAny = true;
+    });
+
+    if (listed > MAX_TYPE_RESULTS) {
+        // Alla träffar markeras i 3D-vyn, listan visar bara de första
+        QListWidgetItem *more = new QListWidgetItem(QString("... and %1 more").arg(listed - MAX_TYPE_RESULTS));
+        more->setFlags(Qt::NoItemFlags);
+        ui->searchResultsList->addItem(more);
     }
 
-    if (!foundAny) {
-        QMessageBox::information(this, "Search Result", "No star found with type: " + typeFilter);
+    if (listed == 0) {
+        QMessageBox::information(this, "Search Result", "No star found with type: " + description);
     }
 }
 
@@ -726,9 +791,92 @@ void ActivityBox::onTypeBoxChanged(const QString &text)
     if (trimmed.isEmpty() || trimmed == "Type")
         return;
 
+    SpectralType::Class spectralClass = SpectralType::UnknownClass;
+    SpectralType::Luminosity luminosity = SpectralType::UnknownLuminosity;
+    if (!typeBoxFilter(trimmed, spectralClass, luminosity))
+        return;
+
+    // Ctrl lägger till eller tar bort ur urvalet (OR), annars ersätts det.
+    // En klass och en luminositetsklass kombineras (AND), t.ex. K + Giant.
+    const bool add = QGuiApplication::keyboardModifiers() & Qt::ControlModifier;
+    if (spectralClass != SpectralType::UnknownClass)
+        toggleTypeFilter(m_typeClasses, spectralClass, add);
+    else
+        toggleTypeFilter(m_typeLuminosities, luminosity, add);
+
+    // Visa filtret som platshållare så att samma val kan göras igen
+    ui->typeBox->setCurrentIndex(-1);
+
     // Nollställ eventuell ID‑sökning
     ui->searchLineEdit->clear();
 
     // Kör filtreringen direkt
-    searchByType(trimmed);
+    searchByType();
+}
+
+/*
+Function to toggle one value of the type filter
+
+Input:
+- QVector with the chosen values
+- value that was chosen in typeBox
+- bool, true to add it to the others, false to make it the only one
+
+Output:
+- none, a value that was the only one chosen is removed instead
+*/
+template <typename Value>
+void ActivityBox::toggleTypeFilter(QVector<Value> &values, Value value, bool add)
+{
+    if (add) {
+        if (!values.removeOne(value))
+            values.append(value);
+    } else if (values.size() == 1 && values.first() == value) {
+        values.clear();
+    } else {
+        values = { value };
+    }
+}
+
+// Texterna i typeBox och vad de betyder
+static const struct {
+    const char *text;
+    SpectralType::Class spectralClass;
+    SpectralType::Luminosity luminosity;
+} TYPE_BOX_ITEMS[] = {
+    { "O", SpectralType::O, SpectralType::UnknownLuminosity },
+    { "B", SpectralType::B, SpectralType::UnknownLuminosity },
+    { "A", SpectralType::A, SpectralType::UnknownLuminosity },
+    { "F", SpectralType::F, SpectralType::UnknownLuminosity },
+    { "G", SpectralType::G, SpectralType::UnknownLuminosity },
+    { "K", SpectralType::K, SpectralType::UnknownLuminosity },
+    { "M", SpectralType::M, SpectralType::UnknownLuminosity },
+    { "Supergiant", SpectralType::UnknownClass, SpectralType::Supergiant },
+    { "Bright Giant", SpectralType::UnknownClass, SpectralType::BrightGiant },
+    { "Giant", SpectralType::UnknownClass, SpectralType::Giant },
+    { "Subgiant", SpectralType::UnknownClass, SpectralType::Subgiant },
+    { "Dwarf Star", SpectralType::UnknownClass, SpectralType::Dwarf },
+    { "Subdwarf", SpectralType::UnknownClass, SpectralType::Subdwarf },
+    { "White Dwarf", SpectralType::UnknownClass, SpectralType::WhiteDwarf },
+};
+
+bool ActivityBox::typeBoxFilter(const QString &text, SpectralType::Class &spectralClass, SpectralType::Luminosity &luminosity)
+{
+    for (const auto &item : TYPE_BOX_ITEMS) {
+        if (text == QLatin1String(item.text)) {
+            spectralClass = item.spectralClass;
+            luminosity = item.luminosity;
+            return true;
+        }
+    }
+    return false;
+}
+
+QString ActivityBox::typeBoxText(SpectralType::Class spectralClass, SpectralType::Luminosity luminosity)
+{
+    for (const auto &item : TYPE_BOX_ITEMS) {
+        if (item.spectralClass == spectralClass && item.luminosity == luminosity)
+            return QString::fromLatin1(item.text);
+    }
+    return QString();
 }
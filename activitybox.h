@@ -10,6 +10,10 @@
 #include <QListWidget>
 #include <QVector3D>
 #include <QPushButton>
+#include <QCompleter>
+#include <QStringListModel>
+#include "starcatalog.h"
+#include "staridindex.h"
 
 namespace Ui {
 class ActivityBox;
@@ -24,6 +28,9 @@ signals:
 
     void toggleCameraMode(); // Signal to toggle camera mode
 
+    // Stars matching the type filter, empty when the filter is cleared
+    void typeMatched(const StarBitmap &stars);
+
 
 public:
     explicit ActivityBox(QWidget *parent = nullptr);
@@ -31,6 +38,7 @@ public:
     void userLogin(bool user, QString username); // Updated method to accept username
     bool isAdminUser(const QString& username);
     void setCurrentStarId(const QString& starId);
+    void setCatalog(const StarCatalog *catalog);
 
     void updateCameraModeButton(int mode);
     void setButtonImage(QPushButton* button, const QString& normalPath, const QString& pressedPath);
@@ -38,6 +46,13 @@ public:
 
 
 
+public slots:
+    // Index the catalog's ids again for the suggestions, after a load or an edit
+    void rebuildIdIndex();
+
+    // Forget the indexed ids, e.g. when a reload starts
+    void clearIdIndex();
+
 private slots:
     void onSearchButtonClicked();
     void onFavoriteButtonClicked();
@@ -55,13 +70,14 @@ private slots:
     void onSunButtonClicked();
     void onTypeBoxChanged(const QString &text);
     void onSearchResultsDoubleClicked(QListWidgetItem* item);
+    void onSearchTextEdited(const QString &text);
 
     void onToggleCameraModeClicked(); // Handle camera mode toggle button click
     void onFavoriteItemSingleClicked(QListWidgetItem* item);
     void showWidgets(const QList<QWidget*>& widgets);
     void hideWidgets(const QList<QWidget*>& widgets);
     void setMenuButtonPressed(QPushButton* pressedButton);
-    void searchByType(const QString &typeLetter);
+    void searchByType();
 
 private:
     Ui::ActivityBox *ui;
@@ -69,8 +85,28 @@ private:
     QList<QString> favoritesList;
 
     static QSqlDatabase m_starsDb;
+    const StarCatalog *m_catalog = nullptr;
 
     void searchById(const QString &id);
+
+    // Type filter chosen in typeBox: any of the classes and any of the luminosity classes
+    QVector<SpectralType::Class> m_typeClasses;
+    QVector<SpectralType::Luminosity> m_typeLuminosities;
+
+    // Id suggestions in searchLineEdit
+    StarIdIndex m_idIndex;
+    int m_idIndexGeneration = 0;
+    QCompleter *m_idCompleter;
+    QStringListModel *m_idSuggestions;
+    static const int MAX_ID_SUGGESTIONS = 10;
+
+    // More matches than this are highlighted but not listed
+    static const int MAX_TYPE_RESULTS = 500;
+
+    template <typename Value>
+    static void toggleTypeFilter(QVector<Value> &values, Value value, bool add);
+    static bool typeBoxFilter(const QString &text, SpectralType::Class &spectralClass, SpectralType::Luminosity &luminosity);
+    static QString typeBoxText(SpectralType::Class spectralClass, SpectralType::Luminosity luminosity);
     QString loggedInUsername;  // Store the username
     QListWidget *usersList;
 
@@ -0,0 +1,83 @@
+#include "animationengine.h"
+#include "perfmonitor.h"
+
+// Longest first frame after being idle, the frame time then covers the idle time too
+static const float WAKE_FRAME_TIME = 1.0f / 60.0f;
+
+AnimationEngine::AnimationEngine(Qt3DCore::QEntity *rootEntity, QObject *parent)
+    : QObject(parent)
+    , m_frameAction(new Qt3DLogic::QFrameAction())
+    , m_nextId(1)
+    , m_waking(true)
+{
+    connect(m_frameAction, &Qt3DLogic::QFrameAction::triggered, this, &AnimationEngine::onFrame);
+    m_frameAction->setEnabled(false);
+    rootEntity->addComponent(m_frameAction);
+}
+
+int AnimationEngine::run(const Step &step)
+{
+    const int id = m_nextId++;
+    m_steps.insert(id, QSharedPointer<Step>::create(step));
+    setActive(true);
+    return id;
+}
+
+int AnimationEngine::animate(float duration,
+                             const QEasingCurve &easing,
+                             const std::function<void(float)> &update,
+                             const std::function<void()> &finished)
+{
+    float elapsed = 0.0f;
+    return run([=](float dt) mutable {
+        elapsed += dt * 1000.0f;
+        const float progress = duration > 0.0f ? qMin(elapsed / duration, 1.0f) : 1.0f;
+        update(progress < 1.0f ? float(easing.valueForProgress(progress)) : 1.0f);
+        if (progress < 1.0f)
+            return true;
+        if (finished)
+            finished();
+        return false;
+    });
+}
+
+void AnimationEngine::stop(int id)
+{
+    if (m_steps.remove(id) > 0 && m_steps.isEmpty())
+        setActive(false);
+}
+
+void AnimationEngine::onFrame(float dt)
+{
+    PerfTimer timer(PerfMonitor::Camera);
+    if (m_waking) {
+        m_waking = false;
+        dt = qMin(dt, WAKE_FRAME_TIME);
+    }
+
+    // Steps may start or stop animations, so walk a copy of the ids
+    const QList<int> ids = m_steps.keys();
+    for (int id : ids) {
+        auto it = m_steps.find(id);
+        if (it == m_steps.end())
+            continue;
+
+        // Held here as well, the step may stop itself and drop the stored one
+        const QSharedPointer<Step> step = it.value();
+        if (!(*step)(dt))
+            m_steps.remove(id);
+    }
+
+    if (m_steps.isEmpty())
+        setActive(false);
+}
+
+void AnimationEngine::setActive(bool active)
+{
+    if (m_frameAction->isEnabled() == active)
+        return;
+
+    m_frameAction->setEnabled(active);
+    m_waking = active;
+    emit activeChanged(active);
+}
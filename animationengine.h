@@ -0,0 +1,64 @@
+#ifndef ANIMATIONENGINE_H
+#define ANIMATIONENGINE_H
+
+#include <QObject>
+#include <QMap>
+#include <QSharedPointer>
+#include <QEasingCurve>
+#include <Qt3DCore/QEntity>
+#include <Qt3DLogic/QFrameAction>
+#include <functional>
+
+/*
+ * Runs camera animations once per rendered frame.
+ *
+ * Every running animation is a step called with the real time since
+ * the last frame, so a flight takes as long on a 144 Hz display as on a
+ * 60 Hz one. The frame action is only enabled while a step is running,
+ * when nothing moves there are no wakeups at all.
+ *
+ * Both camera controllers share one engine, owned by CameraManager.
+ */
+class AnimationEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Called every frame with the frame time in seconds, returns false when done
+    using Step = std::function<bool(float dt)>;
+
+    explicit AnimationEngine(Qt3DCore::QEntity *rootEntity, QObject *parent = nullptr);
+
+    // Run a step from the next frame on, returns an id for stop()
+    int run(const Step &step);
+
+    // Tween progress from 0 to 1 through the easing curve over duration milliseconds.
+    // update gets the eased progress, 1 on the last frame, then finished is called.
+    int animate(float duration,
+                const QEasingCurve &easing,
+                const std::function<void(float)> &update,
+                const std::function<void()> &finished = {});
+
+    // Safe to call with an id that already finished, and from inside a step
+    void stop(int id);
+    bool isRunning(int id) const { return m_steps.contains(id); }
+
+    int runningCount() const { return m_steps.size(); }
+
+signals:
+    // The engine started or stopped needing frames
+    void activeChanged(bool active);
+
+private slots:
+    void onFrame(float dt);
+
+private:
+    void setActive(bool active);
+
+    Qt3DLogic::QFrameAction *m_frameAction;
+    QMap<int, QSharedPointer<Step>> m_steps;
+    int m_nextId;
+    bool m_waking;
+};
+
+#endif // ANIMATIONENGINE_H
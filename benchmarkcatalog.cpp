@@ -0,0 +1,207 @@
+#include "benchmarkcatalog.h"
+#include "spectraltype.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QJsonDocument>
+#include <QFile>
+#include <QtMath>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static const char *SPECTRAL_TYPES[] = {
+    "O9V", "B2IV", "A0V", "F5V", "G2V", "K1III", "M2V", "M1Iab", "G8III", "K5V", "B8Ia", "A1II", "DA2", ""
+};
+
+/*
+Function to read the peak resident set size of the process
+
+Input:
+- none
+
+Output:
+- qint64 with the peak RSS in kilobytes
+*/
+qint64 peakRssKilobytes() {
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return qint64(counters.PeakWorkingSetSize / 1024);
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(Q_OS_MACOS)
+    return qint64(usage.ru_maxrss / 1024);  // Bytes on macOS
+#else
+    return qint64(usage.ru_maxrss);
+#endif
+#endif
+}
+
+/*
+Function for the radius of a synthetic catalog, it keeps the density of
+the local catalog whatever the star count
+
+Input:
+- int with the number of stars
+
+Output:
+- float with the radius in database units
+*/
+float catalogRadius(int stars) {
+    return 10.0f * std::cbrt(stars / 1000.0f);
+}
+
+/*
+Function to generate a synthetic catalog. The same seed gives the same stars
+
+Input:
+- int with the number of stars
+- quint32 seed
+
+Output:
+- QVector<StarRecord> with the derived values filled in, as the loader thread does
+*/
+QVector<StarRecord> generateCatalog(int stars, quint32 seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> type(0, int(sizeof(SPECTRAL_TYPES) / sizeof(SPECTRAL_TYPES[0])) - 1);
+
+    const float radius = catalogRadius(stars);
+
+    QVector<StarRecord> catalog;
+    catalog.reserve(stars);
+    for (int i = 0; i < stars; ++i) {
+        QVector3D position;
+        do {
+            position = QVector3D(unit(random), unit(random), unit(random));
+        } while (position.lengthSquared() > 1.0f);
+
+        StarRecord star;
+        star.id = QStringLiteral("BENCH %1").arg(i);
+        star.position = position * radius;
+        star.rightAscension = qRadiansToDegrees(std::atan2(star.position.y(), star.position.x())) + 180.0;
+        star.declination = qRadiansToDegrees(std::asin(position.z() / qMax(position.length(), 1e-6f)));
+        star.parallax = 1000.0 / qMax(star.position.length(), 0.01f);
+        star.spType = QString::fromLatin1(SPECTRAL_TYPES[type(random)]);
+
+        star.spectral = SpectralType::parse(star.spType);
+        star.radius = star.spectral.radius();
+        star.color = star.spectral.color();
+        catalog.append(star);
+    }
+    return catalog;
+}
+
+/*
+Function to write a catalog to a stars table in a new SQLite file
+
+Input:
+- QString with the database file name
+- QVector<StarRecord> with the stars
+
+Output:
+- bool, true if the table was written
+*/
+bool writeDatabase(const QString &fileName, const QVector<StarRecord> &catalog) {
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "benchmarkConnection");
+        db.setDatabaseName(fileName);
+        if (!db.open()) {
+            qWarning() << "Could not create" << fileName << db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            query.exec("CREATE TABLE stars (MAIN_ID TEXT, RA REAL, DEC REAL, PLX_VALUE REAL, "
+                       "x_koord REAL, y_koord REAL, z_koord REAL, SP_TYPE TEXT)");
+
+            db.transaction();
+            query.prepare("INSERT INTO stars VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+            ok = true;
+            for (const StarRecord &star : catalog) {
+                query.addBindValue(star.id);
+                query.addBindValue(star.rightAscension);
+                query.addBindValue(star.declination);
+                query.addBindValue(star.parallax);
+                query.addBindValue(star.position.x());
+                query.addBindValue(star.position.y());
+                query.addBindValue(star.position.z());
+                query.addBindValue(star.spType);
+                if (!query.exec()) {
+                    qWarning() << "Insert failed:" << query.lastError().text();
+                    ok = false;
+                    break;
+                }
+            }
+            ok = db.commit() && ok;
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase("benchmarkConnection");
+    return ok;
+}
+
+/*
+Function for summary statistics of a list of samples
+
+Input:
+- QVector<double> with the samples
+
+Output:
+- QJsonObject with mean, p50, p95 and max, or null values without samples
+*/
+QJsonObject summarize(QVector<double> samples) {
+    QJsonObject summary;
+    if (samples.isEmpty()) {
+        summary["mean"] = QJsonValue::Null;
+        summary["p50"] = QJsonValue::Null;
+        summary["p95"] = QJsonValue::Null;
+        summary["max"] = QJsonValue::Null;
+        return summary;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double total = 0.0;
+    for (double sample : samples)
+        total += sample;
+
+    auto at = [&samples](double fraction) { return samples.at(int(fraction * (samples.size() - 1) + 0.5)); };
+    summary["mean"] = total / samples.size();
+    summary["p50"] = at(0.50);
+    summary["p95"] = at(0.95);
+    summary["max"] = samples.last();
+    return summary;
+}
+
+/*
+Function to write a benchmark report
+
+Input:
+- QJsonObject with the report
+- QString with the file name, empty for stdout
+
+Output:
+- bool, true if it was written
+*/
+bool writeReport(const QJsonObject &report, const QString &fileName) {
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    QFile file(fileName);
+    const bool opened = fileName.isEmpty() ? file.open(stdout, QIODevice::WriteOnly)
+                                           : file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!opened || file.write(json) != json.size()) {
+        qWarning() << "Could not write" << (fileName.isEmpty() ? QStringLiteral("stdout") : fileName);
+        return false;
+    }
+    return true;
+}
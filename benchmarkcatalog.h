@@ -0,0 +1,33 @@
+#ifndef BENCHMARKCATALOG_H
+#define BENCHMARKCATALOG_H
+
+#include <QVector>
+#include <QString>
+#include <QJsonObject>
+#include "starcatalog.h"
+
+/*
+ * Synthetic catalogs and reporting shared by the benchmark targets.
+ * Stars are spread evenly through a sphere that grows with the count,
+ * so every size has the density of the local catalog.
+ */
+
+// Stars with the derived values filled in, the same seed gives the same stars
+QVector<StarRecord> generateCatalog(int stars, quint32 seed);
+
+// Radius in database units of the sphere generateCatalog() fills
+float catalogRadius(int stars);
+
+// Write the stars to a new stars table in an SQLite file
+bool writeDatabase(const QString &fileName, const QVector<StarRecord> &catalog);
+
+// Peak resident set size of the process in kilobytes
+qint64 peakRssKilobytes();
+
+// Mean, p50, p95 and max of the samples, nulls without samples
+QJsonObject summarize(QVector<double> samples);
+
+// Indented JSON to the file, or to stdout when fileName is empty
+bool writeReport(const QJsonObject &report, const QString &fileName);
+
+#endif // BENCHMARKCATALOG_H
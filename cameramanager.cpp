@@ -5,12 +5,16 @@ CameraManager::CameraManager(Qt3DRender::QCamera *camera, Qt3DCore::QEntity *roo
     : QObject(parent),
     m_camera(camera),
     m_cameraMode(ThirdPersonMode),
-    m_currentStarTransform(nullptr),
+    m_hasCurrentStar(false),
     m_isViewingSun(false)
 {
+    // One frame-driven engine runs the flights of both controllers.
+    // Created first so it is destroyed before them.
+    m_animator = new AnimationEngine(rootEntity, this);
+
     // Create both controllers
-    m_firstPersonController = new FirstPersonCameraController(camera, rootEntity, bgMusic, this);
-    m_thirdPersonController = new ThirdPersonCameraController(camera, rootEntity, bgMusic, this);
+    m_firstPersonController = new FirstPersonCameraController(camera, rootEntity, bgMusic, m_animator, this);
+    m_thirdPersonController = new ThirdPersonCameraController(camera, rootEntity, bgMusic, m_animator, this);
 
     // Initially set to third-person mode (default)
     m_firstPersonController->setEnabled(false);
@@ -72,38 +76,13 @@ void CameraManager::setCameraMode(CameraMode mode)
         m_firstPersonController->setEnabled(true);
 
         // If we were already looking at a star, maintain focus by simulating a click
-        if (m_currentStarTransform) {
-            m_firstPersonController->handleStarClick(m_currentStarTransform);
+        if (m_hasCurrentStar) {
+            m_firstPersonController->handleStarClick(m_currentStarPosition);
         } else if (m_isViewingSun) {
-
-            Qt3DCore::QEntity* rootEntity = m_camera->parentEntity()->parentEntity();
-            if (rootEntity) {
-                for (QObject* child : rootEntity->children()) {
-                    Qt3DCore::QEntity* entity = qobject_cast<Qt3DCore::QEntity*>(child);
-                    if (!entity) continue;
-
-                    bool isSun = false;
-                    Qt3DCore::QTransform* transform = nullptr;
-
-                    for (Qt3DCore::QComponent* comp : entity->components()) {
-                        if (auto tr = qobject_cast<Qt3DCore::QTransform*>(comp)) {
-                            if (tr->translation() == QVector3D(0, 0, 0)) {
-                                transform = tr;
-                                isSun = true;
-                                break;
-                            }
-                        }
-                    }
-
-                    if (isSun && transform) {
-                        m_firstPersonController->handleSunClick(transform);
-                        break;
-                    }
-                }
-            }
+            // The Sun sits at the origin of the scene
+            m_firstPersonController->handleSunClick(QVector3D(0, 0, 0));
         } else if (!m_currentStarId.isEmpty()) {
-
-            m_firstPersonController->teleportToStar(QVector3D(0, 0, 0), m_currentStarId);
+            m_firstPersonController->teleportToStar(currentStarPosition(), m_currentStarId);
         }
     } else { // ThirdPersonMode
         // Disable first-person first to avoid controller conflicts
@@ -111,43 +90,26 @@ void CameraManager::setCameraMode(CameraMode mode)
         m_thirdPersonController->setEnabled(true);
 
         // If we were already looking at a star, maintain focus by simulating a click
-        if (m_currentStarTransform) {
-            m_thirdPersonController->handleStarClick(m_currentStarTransform);
+        if (m_hasCurrentStar) {
+            m_thirdPersonController->handleStarClick(m_currentStarPosition);
         } else if (m_isViewingSun) {
-
-            Qt3DCore::QEntity* rootEntity = m_camera->parentEntity()->parentEntity();
-            if (rootEntity) {
-                for (QObject* child : rootEntity->children()) {
-                    Qt3DCore::QEntity* entity = qobject_cast<Qt3DCore::QEntity*>(child);
-                    if (!entity) continue;
-
-                    bool isSun = false;
-                    Qt3DCore::QTransform* transform = nullptr;
-
-                    for (Qt3DCore::QComponent* comp : entity->components()) {
-                        if (auto tr = qobject_cast<Qt3DCore::QTransform*>(comp)) {
-                            if (tr->translation() == QVector3D(0, 0, 0)) {
-                                transform = tr;
-                                isSun = true;
-                                break;
-                            }
-                        }
-                    }
-
-                    if (isSun && transform) {
-                        m_thirdPersonController->handleSunClick(transform);
-                        break;
-                    }
-                }
-            }
+            // The Sun sits at the origin of the scene
+            m_thirdPersonController->handleSunClick(QVector3D(0, 0, 0));
         } else if (!m_currentStarId.isEmpty()) {
-            m_thirdPersonController->teleportToStar(QVector3D(0, 0, 0), m_currentStarId);
+            m_thirdPersonController->teleportToStar(currentStarPosition(), m_currentStarId);
         }
     }
 
     emit cameraModeChanged(mode);
 }
 
+// Scene position of the star we teleported to, the origin if it isn't in the catalog
+QVector3D CameraManager::currentStarPosition() const
+{
+    int row = m_catalog ? m_catalog->indexOf(m_currentStarId) : -1;
+    return row >= 0 ? m_catalog->scenePosition(row) : QVector3D(0, 0, 0);
+}
+
 void CameraManager::toggleCameraMode()
 {
     setCameraMode(m_cameraMode == FirstPersonMode ? ThirdPersonMode : FirstPersonMode);
@@ -158,7 +120,7 @@ void CameraManager::teleportToStar(const QVector3D &coordinates, const QString &
     // Store star info for mode switching
     m_currentStarId = starId;
     m_isViewingSun = (starId.toLower() == "sun");
-    m_currentStarTransform = nullptr; // Reset transform since we're teleporting
+    m_hasCurrentStar = false; // Reset clicked star since we're teleporting
 
     // Forward the call to the active controller
     if (m_cameraMode == FirstPersonMode) {
@@ -168,16 +130,17 @@ void CameraManager::teleportToStar(const QVector3D &coordinates, const QString &
     }
 }
 
-void CameraManager::handleStarClick(Qt3DCore::QTransform *starTransform)
+void CameraManager::handleStarClick(const QVector3D &starPosition)
 {
-    // Store the star transform for mode switching
-    m_currentStarTransform = starTransform;
+    // Store the star position for mode switching
+    m_currentStarPosition = starPosition;
+    m_hasCurrentStar = true;
     m_isViewingSun = false;
 
     // Forward the call to the active controller
     if (m_cameraMode == FirstPersonMode) {
-        m_firstPersonController->handleStarClick(starTransform);
+        m_firstPersonController->handleStarClick(starPosition);
     } else {
-        m_thirdPersonController->handleStarClick(starTransform);
+        m_thirdPersonController->handleStarClick(starPosition);
     }
 }
@@ -8,6 +8,8 @@
 #include "firstpersoncameracontroller.h"
 #include "thirdpersoncameracontroller.h"
 #include "music.h"
+#include "animationengine.h"
+#include "starcatalog.h"
 
 class CameraManager : public QObject
 {
@@ -27,12 +29,18 @@ public:
     void setCameraMode(CameraMode mode);
     CameraMode cameraMode() const { return m_cameraMode; }
 
+    // Shared by both controllers, idle unless a flight or look-around is running
+    AnimationEngine *animator() const { return m_animator; }
+
+    // Used to find the current star again when the mode changes
+    void setCatalog(const StarCatalog *catalog) { m_catalog = catalog; }
+
 public slots:
     void toggleCameraMode();
 
     // Forward relevant signals to the active controller
     void teleportToStar(const QVector3D &coordinates, const QString &starId = QString());
-    void handleStarClick(Qt3DCore::QTransform *starTransform);
+    void handleStarClick(const QVector3D &starPosition);
 
 signals:
     void cameraModeChanged(CameraMode mode);
@@ -41,14 +49,19 @@ signals:
 
 private:
     Qt3DRender::QCamera *m_camera;
+    AnimationEngine *m_animator;
     FirstPersonCameraController *m_firstPersonController;
     ThirdPersonCameraController *m_thirdPersonController;
     CameraMode m_cameraMode;
 
-    // Track the currently focused star/entity
-    Qt3DCore::QTransform *m_currentStarTransform;
+    // Track the currently focused star
+    QVector3D m_currentStarPosition;
+    bool m_hasCurrentStar;
     QString m_currentStarId;
     bool m_isViewingSun;
+    const StarCatalog *m_catalog = nullptr;
+
+    QVector3D currentStarPosition() const;
 };
 
 #endif // CAMERAMANAGER_H
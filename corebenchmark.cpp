@@ -0,0 +1,233 @@
+/*
+ * Microbenchmarks of the astronav_core kernels.
+ *
+ * Links nothing but the core library, so the catalog and index code can
+ * be profiled without a window, a GL context or Qt 3D. For every catalog
+ * size a synthetic stars table is read back through StarCatalogReader,
+ * and the index builds, frustum and nearest-neighbour queries and the
+ * searches are timed over a number of repetitions. The results are
+ * written as JSON, to stdout or to --output.
+ */
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMatrix4x4>
+#include <QtMath>
+#include <QDebug>
+#include <functional>
+#include <random>
+#include "starcatalog.h"
+#include "starcatalogreader.h"
+#include "staroctree.h"
+#include "starbvh.h"
+#include "starsearch.h"
+#include "staridindex.h"
+#include "spectraltype.h"
+#include "benchmarkcatalog.h"
+
+/*
+Function to time a kernel
+
+Input:
+- int with the number of repetitions
+- std::function with the kernel, called once per repetition
+
+Output:
+- QJsonObject with the summary of the times in milliseconds
+*/
+QJsonObject timeKernel(int repetitions, const std::function<void(int)> &kernel) {
+    QVector<double> times;
+    times.reserve(repetitions);
+
+    QElapsedTimer timer;
+    for (int i = 0; i < repetitions; ++i) {
+        timer.start();
+        kernel(i);
+        times.append(double(timer.nsecsElapsed()) / 1.0e6);
+    }
+    return summarize(times);
+}
+
+/*
+Function to run the kernels for one catalog size
+
+Input:
+- int with the number of stars
+- int with the number of repetitions of the slow kernels (load and builds)
+- int with the number of repetitions of the queries
+
+Output:
+- QJsonObject with the results for this size
+*/
+QJsonObject runSize(int stars, int repetitions, int queries) {
+    QJsonObject result;
+    result["stars"] = stars;
+
+    const QVector<StarRecord> records = generateCatalog(stars, 1234u + quint32(stars));
+    QTemporaryDir directory;
+    const QString databaseFile = directory.filePath("local_stars.db");
+    if (!writeDatabase(databaseFile, records)) {
+        result["error"] = "could not write the database";
+        return result;
+    }
+
+    // Catalog load: the loader thread's read and the GUI thread's append, here on one thread
+    StarCatalog catalog;
+    result["catalog_load_ms"] = timeKernel(repetitions, [&](int) {
+        QAtomicInt generation(1);
+        StarCatalogReader reader(&generation);
+        catalog.clear();
+        QObject::connect(&reader, &StarCatalogReader::batchRead, [&catalog](int, const QVector<StarRecord> &batch) {
+            for (const StarRecord &star : batch)
+                catalog.append(star);
+        });
+        reader.read(databaseFile, 1);
+    });
+
+    result["spectral_type_ms"] = timeKernel(repetitions, [&](int) {
+        float total = 0.0f;
+        for (int row = 0; row < catalog.count(); ++row) {
+            const SpectralType spectral = SpectralType::parse(catalog.spectralType(row));
+            total += spectral.radius();
+            total += qRed(spectral.rgb());
+        }
+        Q_UNUSED(total);
+    });
+
+    // Index builds over the scene positions, as the renderer and picker do
+    QVector<QVector3D> positions(catalog.count());
+    QVector<float> radii(catalog.count());
+    for (int row = 0; row < catalog.count(); ++row) {
+        positions[row] = catalog.scenePosition(row);
+        radii[row] = catalog.spectral(row).radius();
+    }
+
+    StarOctree octree;
+    result["octree_build_ms"] = timeKernel(repetitions, [&](int) {
+        octree.build(positions, radii);
+    });
+
+    StarBvh bvh;
+    result["bvh_build_ms"] = timeKernel(repetitions, [&](int) {
+        bvh.build(positions, radii);
+    });
+
+    result["id_index_build_ms"] = timeKernel(repetitions, [&](int) {
+        StarCatalog copy;
+        for (const StarRecord &star : records)
+            copy.append(star);
+    });
+
+    StarIdIndex idIndex;
+    result["id_prefix_build_ms"] = timeKernel(repetitions, [&](int) {
+        idIndex.build(catalog.ids());
+    });
+
+    // Queries from random points inside the catalog
+    std::mt19937 random(7);
+    const float radius = catalogRadius(stars) * StarCatalog::SCENE_SCALE;
+    std::uniform_real_distribution<float> coordinate(-radius, radius);
+    std::uniform_int_distribution<int> row(0, catalog.count() - 1);
+    QVector<QVector3D> points(queries);
+    QVector<int> rows(queries);
+    for (int i = 0; i < queries; ++i) {
+        points[i] = QVector3D(coordinate(random), coordinate(random), coordinate(random));
+        rows[i] = row(random);
+    }
+
+    QVector<int> visibleLeaves;
+    result["frustum_query_ms"] = timeKernel(queries, [&](int i) {
+        QMatrix4x4 projection;
+        projection.perspective(45.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+        QMatrix4x4 view;
+        view.lookAt(points[i], QVector3D(0, 0, 0), QVector3D(0, 1, 0));
+        octree.queryFrustum(StarFrustum(projection * view), visibleLeaves);
+    });
+
+    result["pick_ray_ms"] = timeKernel(queries, [&](int i) {
+        const QVector3D direction = (positions[rows[i]] - points[i]).normalized();
+        bvh.closestHit(points[i], direction, [&](int star) {
+            // Same ray-sphere test as the picker
+            const QVector3D toStar = positions[star] - points[i];
+            const float along = QVector3D::dotProduct(toStar, direction);
+            const float missSquared = toStar.lengthSquared() - along * along;
+            return missSquared <= radii[star] * radii[star] ? along : -1.0f;
+        });
+    });
+
+    result["nearest_8_ms"] = timeKernel(queries, [&](int i) {
+        StarSearch::nearest(catalog, octree, points[i], 8);
+    });
+
+    result["search_id_ms"] = timeKernel(queries, [&](int i) {
+        catalog.indexOf(catalog.id(rows[i]));
+    });
+
+    // One keystroke of search-as-you-type, prefixes of a random id from one character up
+    result["id_complete_ms"] = timeKernel(queries, [&](int i) {
+        const QString &id = catalog.id(rows[i]);
+        idIndex.complete(id.left(1 + i % id.size()), 10);
+    });
+
+    const struct {
+        SpectralType::Class spectralClass;
+        SpectralType::Luminosity luminosity;
+    } typeFilters[] = {
+        { SpectralType::K, SpectralType::UnknownLuminosity },
+        { SpectralType::UnknownClass, SpectralType::Giant },
+        { SpectralType::O, SpectralType::UnknownLuminosity },
+        { SpectralType::UnknownClass, SpectralType::Subgiant },
+    };
+    result["search_type_ms"] = timeKernel(repetitions * 4, [&](int i) {
+        const auto &filter = typeFilters[i % 4];
+        StarSearch::byType(catalog, filter.spectralClass, filter.luminosity);
+    });
+
+    // Combined filters on the bitmaps alone, without listing the rows
+    result["type_bitmap_ms"] = timeKernel(queries, [&](int i) {
+        const StarBitmap matches = i % 2
+            ? catalog.spectralIndex().match({ SpectralType::K }, { SpectralType::Giant })
+            : catalog.spectralIndex().match({ SpectralType::O, SpectralType::B }, { SpectralType::Dwarf });
+        const int matched = matches.count();
+        Q_UNUSED(matched);
+    });
+
+    result["peak_rss_kb"] = peakRssKilobytes();
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma separated catalog sizes.", "list", "1000,10000,100000,1000000");
+    QCommandLineOption repetitionsOption("repetitions", "Runs of the loads and builds per size.", "count", "5");
+    QCommandLineOption queriesOption("queries", "Runs of the queries per size.", "count", "200");
+    QCommandLineOption outputOption("output", "Write the JSON here instead of stdout.", "file");
+    parser.addOption(sizesOption);
+    parser.addOption(repetitionsOption);
+    parser.addOption(queriesOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    QJsonArray results;
+    const QStringList sizes = parser.value(sizesOption).split(',', Qt::SkipEmptyParts);
+    for (const QString &size : sizes) {
+        const int stars = size.trimmed().toInt();
+        if (stars <= 0)
+            continue;
+
+        qInfo() << "benchmarking" << stars << "stars";
+        results.append(runSize(stars, parser.value(repetitionsOption).toInt(), parser.value(queriesOption).toInt()));
+    }
+
+    QJsonObject report;
+    report["benchmark"] = "core";
+    report["qt_version"] = QString::fromLatin1(qVersion());
+    report["results"] = results;
+    return writeReport(report, parser.value(outputOption)) ? 0 : 1;
+}
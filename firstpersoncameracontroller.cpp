@@ -4,31 +4,29 @@
 #include <Qt3DRender/QObjectPicker>
 #include <Qt3DCore/QEntity>
 #include <QtMath>
-#include <QTimer>
 #include <Qt3DInput/QKeyEvent>
 
 
 FirstPersonCameraController::FirstPersonCameraController(Qt3DRender::QCamera *camera,
                                                          Qt3DCore::QEntity  *rootEntity,
                                                          BackgroundMusic    *bgMusic,
+                                                         AnimationEngine    *animator,
                                                          QObject *parent)
     : QObject(parent)
     , m_camera(camera)
     , m_rootEntity(rootEntity)
     , m_bgMusic(bgMusic)
-    , m_cameraTimer(new QTimer(this))
-    , m_focusTimer(new QTimer(this))
+    , m_animator(animator)
+    , m_flight(0)
+    , m_look(0)
+    , m_holdFocus(false)
     , m_isAnimating(false)
-    , m_elapsedTime(0.0f)
     , m_duration(2000.0f)
     , m_easingCurve(QEasingCurve::OutCubic )
     , m_previousStarPosition(0, 0, 0)
     , m_hasPreviousStar(false)
-    , m_currentInsideStar(nullptr)
-    , m_currentInsidePicker(nullptr)
     , m_mouseDevice(nullptr)
     , m_mouseHandler(nullptr)
-    , m_frameAction(nullptr)
     , m_isInsideViewMode(false)
     , m_leftMouseButtonPressed(false)
     , m_pitch(0.0f)
@@ -38,12 +36,9 @@ FirstPersonCameraController::FirstPersonCameraController(Qt3DRender::QCamera *ca
 {
 
 
-    // Connect camera animation updates
-    m_cameraTimer->setInterval(16);
-    connect(m_cameraTimer, &QTimer::timeout, this, &FirstPersonCameraController::updateCameraPosition);
-
-    m_focusTimer->setInterval(16);
-    connect(m_focusTimer, &QTimer::timeout,  this, &FirstPersonCameraController::updateFocus);
+    // The focus is only put back when something moved the view center, no polling
+    if (m_camera)
+        connect(m_camera, &Qt3DRender::QCamera::viewCenterChanged, this, &FirstPersonCameraController::updateFocus);
 
 
 
@@ -103,25 +98,33 @@ FirstPersonCameraController::FirstPersonCameraController(Qt3DRender::QCamera *ca
     m_filterStrength = 0.7f;  //  0.0 (no filtering) and 0.95 (heavy filtering)
     m_deltaTimer.start();
 
-
-    // Create a frame action for smooth velocity-based updates
-    m_frameAction = new Qt3DLogic::QFrameAction(m_rootEntity);
-    connect(m_frameAction, &Qt3DLogic::QFrameAction::triggered,
-            this, &FirstPersonCameraController::onFrameUpdate);
-
-    m_rootEntity->addComponent(m_frameAction);
-
 }
 
+FirstPersonCameraController::~FirstPersonCameraController()
+{
+    // Running steps would call back into this controller
+    if (m_animator) {
+        m_animator->stop(m_flight);
+        m_animator->stop(m_look);
+    }
+}
 
+// Start the look-around step if it isn't running
+void FirstPersonCameraController::wakeLook()
+{
+    if (!m_isEnabled || !m_isInsideViewMode || m_animator->isRunning(m_look))
+        return;
 
+    m_deltaTimer.restart();
+    m_look = m_animator->run([this](float dt) { return updateLook(dt); });
+}
 
 //  the frame update method:
 
-void FirstPersonCameraController::onFrameUpdate(float dt)
+bool FirstPersonCameraController::updateLook(float dt)
 {
     if (!m_camera || !m_isEnabled || !m_isInsideViewMode)
-        return;
+        return false;
 
     if (dt <= 0.0f) {
         dt = m_deltaTimer.elapsed() / 1000.0f;
@@ -193,9 +196,17 @@ void FirstPersonCameraController::onFrameUpdate(float dt)
         -cosf(yawRad) * cosf(pitchRad)
         );
 
-    // Set new view direction
-    m_camera->setViewCenter(m_camera->position() + direction);
-    m_focusPoint = m_camera->viewCenter();
+    // Set new view direction, the focus first so updateFocus() doesn't undo it
+    m_focusPoint = m_camera->position() + direction;
+    m_camera->setViewCenter(m_focusPoint);
+
+    // Keep getting frames while a key or the mouse button is held, or the rotation is settling
+    if (arrowKeysActive || m_leftMouseButtonPressed
+        || m_filteredRotationVelocity.lengthSquared() >= 0.0001f) {
+        return true;
+    }
+    m_filteredRotationVelocity = QVector2D(0.0f, 0.0f);
+    return false;
 }
 
 
@@ -222,18 +233,14 @@ void FirstPersonCameraController::setEnabled(bool enabled)
             m_yaw = qRadiansToDegrees(atan2f(-dir.x(), -dir.z()));
         }
     } else {
-        //
-        enablePickingOnCurrentStar();
-
         // Reset view mode
         m_isInsideViewMode = false;
 
-        // Stop any active timers
-        if (m_cameraTimer->isActive())
-            m_cameraTimer->stop();
-
-        if (m_focusTimer->isActive())
-            m_focusTimer->stop();
+        // Stop any running animation
+        m_animator->stop(m_flight);
+        m_animator->stop(m_look);
+        m_isAnimating = false;
+        m_holdFocus = false;
     }
 }
 
@@ -289,41 +296,40 @@ void FirstPersonCameraController::animateCameraToPosition(const QVector3D &targe
     m_rotationVelocity = QVector2D(0.0f, 0.0f);
     m_filteredRotationVelocity = QVector2D(0.0f, 0.0f);
 
-    m_elapsedTime = 0.0f;
     m_isAnimating = true;
+    m_focusPoint = targetViewCenter;
 
     emit animationStarted();
-    m_cameraTimer->start();
 
-    m_focusPoint = targetViewCenter;
+    // Driven by the frame time, a flight takes m_duration ms at any refresh rate
+    m_animator->stop(m_flight);
+    m_flight = m_animator->animate(m_duration, m_easingCurve,
+                                   [this](float t) { updateCameraPosition(t); },
+                                   [this]() { finishAnimation(); });
 }
 
 
 
-void FirstPersonCameraController::updateCameraPosition()
+void FirstPersonCameraController::updateCameraPosition(float t)
 {
-    m_elapsedTime += 16.0f; // each tick ~16ms
-    float t = m_easingCurve.valueForProgress(m_elapsedTime / m_duration);
-
-    if (t >= 1.0f) {
-        t = 1.0f;
-        m_cameraTimer->stop();
-        m_isAnimating = false;
-        m_camera->setViewCenter(m_targetViewCenter);
-
-        m_focusTimer->start();
-        emit animationFinished();
-    }
-
     QVector3D newPos = m_startPosition   * (1.0f - t) + m_targetPosition   * t;
     QVector3D newCtr = m_startViewCenter * (1.0f - t) + m_targetViewCenter * t;
     m_camera->setPosition(newPos);
     m_camera->setViewCenter(newCtr);
 }
 
+void FirstPersonCameraController::finishAnimation()
+{
+    m_isAnimating = false;
+    m_camera->setViewCenter(m_targetViewCenter);
+
+    m_holdFocus = true;
+    emit animationFinished();
+}
+
 void FirstPersonCameraController::updateFocus()
 {
-    if (!m_isAnimating && m_isEnabled) {
+    if (m_holdFocus && !m_isAnimating && m_isEnabled && m_camera->viewCenter() != m_focusPoint) {
         // Force camera to keep looking at the final focus point
         m_camera->setViewCenter(m_focusPoint);
     }
@@ -351,6 +357,7 @@ void FirstPersonCameraController::mousePressed(Qt3DInput::QMouseEvent *event)
 
         // Update last mouse position
         m_lastMousePosition = QPoint(event->x(), event->y());
+        wakeLook();
     }
 }
 
@@ -381,6 +388,7 @@ void FirstPersonCameraController::mouseMoved(Qt3DInput::QMouseEvent *event)
 
     // Update the raw velocity based on mouse movement
     m_rotationVelocity = QVector2D(delta.x(), delta.y()) * scaleFactor;
+    wakeLook();
 }
 
 
@@ -406,22 +414,18 @@ void FirstPersonCameraController::adjustCameraForImmersion(bool inside)
     }
 }
 
-void FirstPersonCameraController::handleStarClick(Qt3DCore::QTransform *starTransform)
+void FirstPersonCameraController::handleStarClick(const QVector3D &starPosition)
 {
-    if (!m_camera || !starTransform || !m_isEnabled)
+    if (!m_camera || !m_isEnabled)
         return;
 
-    // Re-enable picking on the old star
-    enablePickingOnCurrentStar();
-
-
     if (m_bgMusic) {
         m_bgMusic->playSoundEffect(nullptr,
                                    QStringLiteral("qrc:/BackgroundMusic/star_click.wav"));
     }
 
 
-    QVector3D starPos = starTransform->translation();
+    QVector3D starPos = starPosition;
 
     // Update previous star position if we have one
     if (m_isInsideViewMode) {
@@ -430,22 +434,12 @@ void FirstPersonCameraController::handleStarClick(Qt3DCore::QTransform *starTran
         m_hasPreviousStar = true;
     }
 
-    // Identify the star entity
-    Qt3DCore::QEntity* starEntity = nullptr;
-    for (QObject* parent = starTransform->parent(); parent; parent = parent->parent()) {
-        if ((starEntity = qobject_cast<Qt3DCore::QEntity*>(parent))) {
-            break;
-        }
-    }
-
-    // disable picking so that star doesn't block future picks
-    if (starEntity) {
-        disablePickingOnStar(starEntity);
-    }
+    // The star picker ignores the star the camera is inside,
+    // so the star doesn't block future picks
 
     // "inside" a star => can rotate in place
     m_isInsideViewMode = true;
-    m_focusTimer->stop();  // Stop the timer so it won't reset the view
+    m_holdFocus = false;  // So updateFocus() won't reset the view
 
     // Adjust clipping
     adjustCameraForImmersion(true);
@@ -457,19 +451,17 @@ void FirstPersonCameraController::handleStarClick(Qt3DCore::QTransform *starTran
     animateCameraToPosition(starPos, starPos + viewDirection);
 }
 
-void FirstPersonCameraController::handleSunClick(Qt3DCore::QTransform *sunTransform)
+void FirstPersonCameraController::handleSunClick(const QVector3D &sunPosition)
 {
-    if (!m_camera || !sunTransform || !m_isEnabled)
+    if (!m_camera || !m_isEnabled)
         return;
 
-    enablePickingOnCurrentStar();
-
     if (m_bgMusic) {
         m_bgMusic->playSoundEffect(nullptr,
                                    QStringLiteral("qrc:/BackgroundMusic/star_click.wav"));
     }
 
-    QVector3D sunPos = sunTransform->translation();
+    QVector3D sunPos = sunPosition;
 
     // Update previous star position if we have one
     if (m_isInsideViewMode) {
@@ -478,17 +470,6 @@ void FirstPersonCameraController::handleSunClick(Qt3DCore::QTransform *sunTransf
         m_hasPreviousStar = true;
     }
 
-    Qt3DCore::QEntity* sunEntity = nullptr;
-    for (QObject* parent = sunTransform->parent(); parent; parent = parent->parent()) {
-        if ((sunEntity = qobject_cast<Qt3DCore::QEntity*>(parent))) {
-            break;
-        }
-    }
-
-    if (sunEntity) {
-        disablePickingOnStar(sunEntity);
-    }
-
     // We are now inside the sun
     m_isInsideViewMode = true;
 
@@ -502,52 +483,19 @@ void FirstPersonCameraController::handleSunClick(Qt3DCore::QTransform *sunTransf
     emit starSelected(QStringLiteral("Sun"), sunPos);
 }
 
-// Remove star's picker
-void FirstPersonCameraController::disablePickingOnStar(Qt3DCore::QEntity* starEntity)
-{
-    if (!starEntity) return;
-
-    m_currentInsideStar   = starEntity;
-    m_currentInsidePicker = nullptr;
-
-    const auto comps = starEntity->components();
-    for (Qt3DCore::QComponent* c : comps) {
-        if (auto picker = qobject_cast<Qt3DRender::QObjectPicker*>(c)) {
-            starEntity->removeComponent(picker);
-            m_currentInsidePicker = picker;
-            break;
-        }
-    }
-}
-
-// Re-add the removed picker
-void FirstPersonCameraController::enablePickingOnCurrentStar()
-{
-    if (!m_currentInsideStar) return;
-
-    if (m_currentInsidePicker) {
-        m_currentInsideStar->addComponent(m_currentInsidePicker);
-        m_currentInsidePicker = nullptr;
-    }
-    m_currentInsideStar = nullptr;
-}
-
 
 void FirstPersonCameraController::teleportToStar(const QVector3D &coordinates,
                                                  const QString &starId)
 {
     if (!m_camera || !m_isEnabled) return;
 
-    // Not inside star => re-enable picking on old star
-    enablePickingOnCurrentStar();
-
     if (m_bgMusic) {
         m_bgMusic->playSoundEffect(nullptr,
                                    QStringLiteral("qrc:/BackgroundMusic/star_click.wav"));
     }
 
-    const float scaleFactor = 10.0f;
-    QVector3D scaled = coordinates * scaleFactor;
+    // Coordinates come from the star catalog, already in scene units
+    const QVector3D &starPosition = coordinates;
 
     // Update previous star position if we have one
     if (m_isInsideViewMode) {
@@ -556,44 +504,18 @@ void FirstPersonCameraController::teleportToStar(const QVector3D &coordinates,
         m_hasPreviousStar = true;
     }
 
-    // Find that star entity
-    Qt3DCore::QEntity* starEntity = nullptr;
-    if (m_camera->parentEntity()) {
-        Qt3DCore::QEntity* rootEntity =
-            qobject_cast<Qt3DCore::QEntity*>(m_camera->parentEntity()->parentEntity());
-        if (rootEntity) {
-            for (QObject* child : rootEntity->children()) {
-                Qt3DCore::QEntity* e = qobject_cast<Qt3DCore::QEntity*>(child);
-                if (!e) continue;
-                for (Qt3DCore::QComponent* comp : e->components()) {
-                    if (auto tr = qobject_cast<Qt3DCore::QTransform*>(comp)) {
-                        if (tr->translation() == scaled) {
-                            starEntity = e;
-                            break;
-                        }
-                    }
-                }
-                if (starEntity) break;
-            }
-        }
-    }
-
-    if (starEntity) {
-        disablePickingOnStar(starEntity);
-    }
-
     // We're now inside view mode again
     m_isInsideViewMode = true;
     adjustCameraForImmersion(true);
 
     // Calculate view direction based on previous star
-    QVector3D viewDirection = calculateViewDirection(scaled);
+    QVector3D viewDirection = calculateViewDirection(starPosition);
 
     // Animate camera there, looking in the direction away from previous star
-    animateCameraToPosition(scaled, scaled + viewDirection);
+    animateCameraToPosition(starPosition, starPosition + viewDirection);
 
     if (!starId.isEmpty()) {
-        emit starTeleported(starId, scaled);
+        emit starTeleported(starId, starPosition);
     }
 }
 
@@ -614,6 +536,7 @@ void FirstPersonCameraController::onKeyPressed(Qt3DInput::QKeyEvent *event)
         // Just set the key as pressed and accept the event
         m_keysPressed[event->key()] = true;
         event->setAccepted(true);
+        wakeLook();
         break;
     default:
         break;
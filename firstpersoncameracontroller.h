@@ -2,7 +2,8 @@
 #define FIRSTPERSONCAMERACONTROLLER_H
 
 #include <QObject>
-#include <QTimer>
+#include <QPointer>
+#include <QElapsedTimer>
 #include <QVector3D>
 #include <QEasingCurve>
 #include <Qt3DRender/QCamera>
@@ -12,6 +13,7 @@
 #include <Qt3DInput/QMouseHandler>
 #include <Qt3DLogic/QFrameAction>
 #include "music.h"
+#include "animationengine.h"
 #include <Qt3DInput/QKeyboardDevice>
 #include <Qt3DInput/QKeyboardHandler>
 #include <QKeyEvent>
@@ -27,28 +29,23 @@ public:
     explicit FirstPersonCameraController(Qt3DRender::QCamera *camera,
                                          Qt3DCore::QEntity  *rootEntity,
                                          BackgroundMusic   *bgMusic,
+                                         AnimationEngine   *animator,
                                          QObject *parent = nullptr);
+    ~FirstPersonCameraController();
 
     // Animate camera from current position to the target
     void animateCameraToPosition(const QVector3D &targetPosition,
                                  const QVector3D &targetViewCenter);
 
-    // Remove the picker from the star so it no longer blocks picking
-    void disablePickingOnStar(Qt3DCore::QEntity* starEntity);
-
-    // Re-add the picker so the star is clickable again
-    void enablePickingOnCurrentStar();
-
     // Enable/disable this controller
     void setEnabled(bool enabled);
     bool isEnabled() const { return m_isEnabled; }
 
 public slots:
-    void handleStarClick(Qt3DCore::QTransform *starTransform);
-    void handleSunClick(Qt3DCore::QTransform *sunTransform);
+    void handleStarClick(const QVector3D &starPosition);
+    void handleSunClick(const QVector3D &sunPosition);
     void teleportToStar(const QVector3D &coordinates,
                         const QString &starId = QString());
-    void onFrameUpdate(float dt);
 
 
 signals:
@@ -59,7 +56,6 @@ signals:
     void animationFinished();
 
 private slots:
-    void updateCameraPosition();
     void updateFocus();
 
     // Mouse event handlers
@@ -70,7 +66,12 @@ private slots:
 
 
 private:
+    void updateCameraPosition(float t);
+    void finishAnimation();
 
+    // Look-around rotation, run by the animation engine only while there is input
+    bool updateLook(float dt);
+    void wakeLook();
 
     bool anyArrowKeyPressed() const;
     void adjustCameraForImmersion(bool inside);
@@ -82,11 +83,12 @@ private:
     Qt3DCore::QEntity     *m_rootEntity;
     BackgroundMusic       *m_bgMusic;
 
-    QTimer               *m_cameraTimer;
-    QTimer               *m_focusTimer;
+    QPointer<AnimationEngine> m_animator;
+    int                   m_flight;
+    int                   m_look;
+    bool                  m_holdFocus;  // Keep looking at m_focusPoint once a flight is done
 
     bool                  m_isAnimating;
-    float                 m_elapsedTime;
     float                 m_duration;
     QEasingCurve          m_easingCurve;
 
@@ -100,11 +102,6 @@ private:
     QVector3D             m_previousStarPosition;
     bool                  m_hasPreviousStar;
 
-    // Which star we are currently "inside"
-    Qt3DCore::QEntity    *m_currentInsideStar;
-    // The picker we removed from that star
-    Qt3DRender::QObjectPicker *m_currentInsidePicker;
-
     // ---- Mouse-based rotation members ----
     Qt3DInput::QMouseDevice   *m_mouseDevice;
     Qt3DInput::QMouseHandler  *m_mouseHandler;
@@ -122,8 +119,6 @@ private:
 
 
     // For velocity-based rotation
-    Qt3DLogic::QFrameAction* m_frameAction;
-
     QVector2D m_rotationVelocity;
     QVector2D m_filteredRotationVelocity; // Filtered velocity
     float m_velocityDamping;
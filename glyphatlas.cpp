@@ -0,0 +1,79 @@
+#include "glyphatlas.h"
+#include <QPainter>
+#include <QtMath>
+
+// Empty pixels around every glyph so linear filtering doesn't bleed
+static const int GLYPH_PADDING = 2;
+
+GlyphAtlas::GlyphAtlas(const QFont &font, int size, Qt3DCore::QNode *parent)
+    : Qt3DRender::QPaintedTextureImage(parent)
+    , m_font(font)
+    , m_metrics(font)
+    , m_image(size, size, QImage::Format_ARGB32_Premultiplied)
+    , m_missing{ QRectF(), QSizeF(), 0.0f }
+    , m_lineHeight(float(m_metrics.height()))
+    , m_cursorX(0)
+    , m_cursorY(0)
+    , m_rowHeight(0)
+{
+    m_image.fill(Qt::transparent);
+    setSize(QSize(size, size));
+
+    // Unknown characters fall back to '?' once the atlas is full
+    if (addGlyph(u'?'))
+        m_missing = m_glyphs.value(u'?');
+}
+
+const GlyphAtlas::Glyph &GlyphAtlas::glyph(QChar character)
+{
+    auto it = m_glyphs.constFind(character.unicode());
+    if (it != m_glyphs.constEnd())
+        return it.value();
+
+    if (!addGlyph(character.unicode()))
+        return m_missing;
+
+    update();
+    return m_glyphs[character.unicode()];
+}
+
+bool GlyphAtlas::addGlyph(char16_t character)
+{
+    const QString text(QChar{character});
+    const float advance = float(m_metrics.horizontalAdvance(text));
+    const int width = qCeil(advance) + 2 * GLYPH_PADDING;
+    const int height = qCeil(m_lineHeight) + 2 * GLYPH_PADDING;
+
+    // Next shelf when the row is full, give up when the image is
+    if (m_cursorX + width > m_image.width()) {
+        m_cursorX = 0;
+        m_cursorY += m_rowHeight;
+        m_rowHeight = 0;
+    }
+    if (m_cursorY + height > m_image.height() || width > m_image.width())
+        return false;
+
+    QPainter painter(&m_image);
+    painter.setFont(m_font);
+    painter.setPen(Qt::white);
+    painter.drawText(QPointF(m_cursorX + GLYPH_PADDING, m_cursorY + GLYPH_PADDING + m_metrics.ascent()), text);
+    painter.end();
+
+    const QRectF cell(m_cursorX, m_cursorY, width, height);
+    m_glyphs.insert(character, Glyph{
+        QRectF(cell.x() / m_image.width(), cell.y() / m_image.height(),
+               cell.width() / m_image.width(), cell.height() / m_image.height()),
+        cell.size(),
+        advance
+    });
+
+    m_cursorX += width;
+    m_rowHeight = qMax(m_rowHeight, height);
+    return true;
+}
+
+void GlyphAtlas::paint(QPainter *painter)
+{
+    painter->setCompositionMode(QPainter::CompositionMode_Source);
+    painter->drawImage(0, 0, m_image);
+}
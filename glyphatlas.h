@@ -0,0 +1,57 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <Qt3DRender/QPaintedTextureImage>
+#include <QFont>
+#include <QFontMetricsF>
+#include <QImage>
+#include <QHash>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+
+/*
+ * One texture holding every glyph the star labels have used so far.
+ *
+ * Glyphs are rasterised once into a CPU side image with a simple shelf
+ * packer and the texture is repainted from that image when it changes.
+ * Every label is drawn from this single texture, so labels share one
+ * material and can go into one vertex buffer.
+ */
+class GlyphAtlas : public Qt3DRender::QPaintedTextureImage
+{
+public:
+    struct Glyph {
+        QRectF texCoords;   // Normalised, image rows top to bottom
+        QSizeF size;        // Cell size in atlas pixels
+        float advance;      // Pen advance in atlas pixels
+    };
+
+    explicit GlyphAtlas(const QFont &font, int size = 512, Qt3DCore::QNode *parent = nullptr);
+
+    // Looks up a glyph, rasterising it on first use
+    const Glyph &glyph(QChar character);
+
+    // Height of one line of text in atlas pixels
+    float lineHeight() const { return m_lineHeight; }
+
+    int glyphCount() const { return m_glyphs.size(); }
+
+protected:
+    void paint(QPainter *painter) override;
+
+private:
+    bool addGlyph(char16_t character);
+
+    QFont m_font;
+    QFontMetricsF m_metrics;
+    QImage m_image;
+    QHash<char16_t, Glyph> m_glyphs;
+    Glyph m_missing;
+    float m_lineHeight;
+    int m_cursorX;
+    int m_cursorY;
+    int m_rowHeight;
+};
+
+#endif // GLYPHATLAS_H
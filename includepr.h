@@ -7,8 +7,32 @@
 #include "databasehandler.h"
 #include "music.h"
 #include "starcreator.h"
+#include "instancedstarrenderer.h"
+#include "starpicker.h"
+#include "starlightbudget.h"
+#include "staroctree.h"
+#include "starbvh.h"
+#include "starlabelrenderer.h"
+#include "starprojection.h"
+#include "starcatalog.h"
+#include "starcatalogreader.h"
+#include "spectraltype.h"
+#include "spectralindex.h"
+#include "starbitmap.h"
+#include "starsearch.h"
+#include "staridindex.h"
+#include "starcatalogcache.h"
+#include "starloader.h"
+#include "starchunkstore.h"
+#include "starchunkstreamer.h"
+#include "textureloader.h"
+#include "skyboxentity.h"
 #include "qtmanager.h"
 #include "databasehandler.h"
+#include "animationengine.h"
+#include "renderscheduler.h"
+#include "perfmonitor.h"
+#include "perfoverlay.h"
 #include "cameramanager.h"
 
 #include "firstpersoncameracontroller.h"
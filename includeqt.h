@@ -21,5 +21,7 @@
 #include <string>
 #include <QIcon>
 #include <QSoundEffect>
+#include <QCommandLineParser>
+#include <QShortcut>
 
 #endif // INCLUDEQT_H
\ No newline at end of file
@@ -36,6 +36,22 @@ void InfoBox::setStarInfo(const QString& id, const QString& x, const QString& y,
     ui->spTypeLabel->setText("<b>Spectral Type:</b> " + spType);
 }
 
+void InfoBox::setCatalog(const StarCatalog *catalog) {
+    m_catalog = catalog;
+}
+
+void InfoBox::showStar(int row) {
+    if (!m_catalog || row < 0 || row >= m_catalog->count())
+        return;
+
+    QVector3D position = m_catalog->scenePosition(row);
+    setStarInfo(m_catalog->id(row),
+                QString::number(position.x()),
+                QString::number(position.y()),
+                QString::number(position.z()),
+                m_catalog->spectralType(row));
+}
+
 QString InfoBox::getStarId(){
     return ui->ID_label->text();
 }
@@ -78,7 +94,7 @@ void InfoBox::on_editSaveButton_clicked() {
         if (!query.exec()) {
             QMessageBox::warning(this, "Update Failed", "Failed to update star info: " + query.lastError().text());
         } else {
-            emit requestReload();
+            emit starEdited(oldName, newName, newSpType);
             ui->ID_label->setText(newName);
             ui->spTypeLabel->setText("<b>Spectral Type:</b> " + newSpType);
             toggleEditMode(false);
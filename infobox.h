@@ -3,6 +3,7 @@
 
 #include <QWidget>
 #include <QKeyEvent>
+#include "starcatalog.h"
 
 namespace Ui {
 class InfoBox;
@@ -19,11 +20,16 @@ public:
     // Method to update the displayed star information
     void setStarInfo(const QString& id, const QString& x, const QString& y, const QString& z, const QString& spType);
 
+    // Shows a star from the catalog, no database query
+    void showStar(int row);
+    void setCatalog(const StarCatalog *catalog);
+
     QString getStarId();
     void setEditButtonVisibleForAdmin(bool isAdmin);
 
 signals:
-    void requestReload();
+    // The star was saved with a new id and/or spectral type
+    void starEdited(const QString &oldId, const QString &newId, const QString &spType);
 
 private slots:
     void on_editSaveButton_clicked();
@@ -32,6 +38,7 @@ private:
     Ui::InfoBox *ui;
     void toggleEditMode(bool enabled);
     bool editMode = false;
+    const StarCatalog *m_catalog = nullptr;
 };
 
 #endif // INFOBOX_H
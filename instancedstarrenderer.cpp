@@ -0,0 +1,660 @@
+#include "instancedstarrenderer.h"
+#include "shadermaterial.h"
+#include "textureloader.h"
+#include "perfmonitor.h"
+#include <Qt3DExtras/QSphereGeometry>
+#include <Qt3DRender/QCameraLens>
+#include <Qt3DRender/QMaterial>
+#include <Qt3DRender/QPointSize>
+#include <Qt3DRender/QBlendEquation>
+#include <Qt3DRender/QBlendEquationArguments>
+#include <Qt3DRender/QNoDepthMask>
+#include <Qt3DLogic/QFrameAction>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+Q_LOGGING_CATEGORY(lcStarCulling, "astronav.culling", QtWarningMsg)
+
+// Per-star layout: vec4(position, radius) followed by vec4(color, highlight scale)
+static const int FLOATS_PER_INSTANCE = 8;
+static const int INSTANCE_STRIDE = FLOATS_PER_INSTANCE * sizeof(float);
+
+// Default distance inside which stars are drawn as real spheres
+static const float DEFAULT_NEAR_DISTANCE = 40.0f;
+
+// Texture drawn on every glow billboard
+static const char *GLOW_TEXTURE = "qrc:/glow/starLight2.png";
+
+// Glow quads reach at most three radii from the star, bounds must cover them
+static const float GLOW_EXTENT = 3.0f;
+
+// Stars per octree leaf, small so the near and label queries test few extra stars
+static const int STARS_PER_LEAF = 64;
+
+// Most stars per chunk, i.e. per point and glow draw. A million stars are a
+// few hundred draws, and culling still skips most of them from inside the catalog.
+static const int STARS_PER_CHUNK = 4096;
+
+static Qt3DCore::QAttribute *createStarAttribute(const QString &name,
+                                                 int byteOffset,
+                                                 uint divisor,
+                                                 Qt3DCore::QBuffer *buffer,
+                                                 Qt3DCore::QNode *parent)
+{
+    auto *attribute = new Qt3DCore::QAttribute(parent);
+    attribute->setName(name);
+    attribute->setAttributeType(Qt3DCore::QAttribute::VertexAttribute);
+    attribute->setVertexBaseType(Qt3DCore::QAttribute::Float);
+    attribute->setVertexSize(4);
+    attribute->setByteOffset(byteOffset);
+    attribute->setByteStride(INSTANCE_STRIDE);
+    attribute->setDivisor(divisor);
+    attribute->setBuffer(buffer);
+    return attribute;
+}
+
+InstancedStarRenderer::InstancedStarRenderer(Qt3DCore::QNode *parent)
+    : Qt3DCore::QEntity(parent)
+    , m_committedCount(0)
+    , m_uploadedCount(0)
+    , m_bufferSize(0)
+    , m_pendingChunk(nullptr)
+    , m_pendingBounds(nullptr)
+    , m_pendingMin(QVector3D(1.0f, 1.0f, 1.0f) * std::numeric_limits<float>::max())
+    , m_pendingMax(-m_pendingMin)
+    , m_camera(nullptr)
+    , m_nearDistance(DEFAULT_NEAR_DISTANCE)
+    , m_lodDirty(false)
+    , m_cullDirty(false)
+    , m_culledCount(0)
+{
+    // Near batch: one unit sphere shared by every instance, scaled in the vertex shader
+    m_sphereEntity = new Qt3DCore::QEntity(this);
+
+    auto *sphere = new Qt3DExtras::QSphereGeometry(m_sphereEntity);
+    sphere->setRadius(1.0f);
+    sphere->setRings(16);
+    sphere->setSlices(16);
+
+    m_nearBuffer = new Qt3DCore::QBuffer(sphere);
+    m_nearPositionAttribute = createStarAttribute(QStringLiteral("instancePosition"), 0, 1,
+                                                  m_nearBuffer, sphere);
+    m_nearColorAttribute = createStarAttribute(QStringLiteral("instanceColor"), 4 * sizeof(float), 1,
+                                               m_nearBuffer, sphere);
+    sphere->addAttribute(m_nearPositionAttribute);
+    sphere->addAttribute(m_nearColorAttribute);
+
+    m_sphereMesh = new Qt3DRender::QGeometryRenderer();
+    m_sphereMesh->setGeometry(sphere);
+    m_sphereMesh->setPrimitiveType(Qt3DRender::QGeometryRenderer::Triangles);
+    m_sphereMesh->setInstanceCount(0);
+
+    // The geometry only describes the unit sphere, so the extents of the
+    // whole catalog are given explicitly to keep the batch from being culled
+    m_sphereBounds = new Qt3DCore::QBoundingVolume();
+
+    m_sphereEntity->addComponent(m_sphereMesh);
+    m_sphereEntity->addComponent(m_sphereBounds);
+    m_sphereEntity->addComponent(createShaderMaterial(QStringLiteral("qrc:/shaders/instancedstar.vert"),
+                                                      QStringLiteral("qrc:/shaders/instancedstar.frag"),
+                                                      {}, m_sphereEntity));
+
+    // Far batch: one point per star read straight from the star buffer.
+    // The geometry is shared, each chunk draws its own vertex range.
+    m_pointGeometry = new Qt3DCore::QGeometry(this);
+    m_starBuffer = new Qt3DCore::QBuffer(m_pointGeometry);
+    m_pointPositionAttribute = createStarAttribute(QStringLiteral("starPosition"), 0, 0,
+                                                   m_starBuffer, m_pointGeometry);
+    m_pointColorAttribute = createStarAttribute(QStringLiteral("starColor"), 4 * sizeof(float), 0,
+                                                m_starBuffer, m_pointGeometry);
+    m_pointGeometry->addAttribute(m_pointPositionAttribute);
+    m_pointGeometry->addAttribute(m_pointColorAttribute);
+
+    // The vertex shader sets gl_PointSize from the projected star radius
+    auto *pointSize = new Qt3DRender::QPointSize();
+    pointSize->setSizeMode(Qt3DRender::QPointSize::Programmable);
+
+    m_impostorMaterial = createShaderMaterial(QStringLiteral("qrc:/shaders/starimpostor.vert"),
+                                              QStringLiteral("qrc:/shaders/starimpostor.frag"),
+                                              { pointSize }, this);
+    m_nearDistanceParameter = new Qt3DRender::QParameter(QStringLiteral("nearDistance"), m_nearDistance);
+    m_impostorMaterial->addParameter(m_nearDistanceParameter);
+
+    // Glow batch: one camera-facing quad per star, instanced over the star buffer
+    const float corners[] = { -1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, 1.0f,  1.0f, 1.0f };
+    m_cornerBuffer = new Qt3DCore::QBuffer(this);
+    m_cornerBuffer->setData(QByteArray(reinterpret_cast<const char *>(corners), sizeof(corners)));
+
+    // Alpha blended like the old QTextureMaterial, without writing depth
+    auto *blendEquation = new Qt3DRender::QBlendEquation();
+    blendEquation->setBlendFunction(Qt3DRender::QBlendEquation::Add);
+    auto *blendArguments = new Qt3DRender::QBlendEquationArguments();
+    blendArguments->setSourceRgba(Qt3DRender::QBlendEquationArguments::SourceAlpha);
+    blendArguments->setDestinationRgba(Qt3DRender::QBlendEquationArguments::OneMinusSourceAlpha);
+
+    m_glowMaterial = createShaderMaterial(QStringLiteral("qrc:/shaders/starglow.vert"),
+                                          QStringLiteral("qrc:/shaders/starglow.frag"),
+                                          { blendEquation, blendArguments, new Qt3DRender::QNoDepthMask() },
+                                          this);
+
+    // A starLight2.ktx/.dds is used if there is one, otherwise the PNG is decoded off the GUI thread.
+    // The cache hands every glow material the same texture.
+    Qt3DRender::QAbstractTexture *glowTexture = TextureCache::instance()->texture2D(QString::fromLatin1(GLOW_TEXTURE));
+    m_glowMaterial->addParameter(new Qt3DRender::QParameter(QStringLiteral("glowTexture"), glowTexture));
+
+    // Camera moves only mark the batches dirty, they are rebuilt once per frame
+    Qt3DLogic::QFrameAction *frameAction = new Qt3DLogic::QFrameAction();
+    connect(frameAction, &Qt3DLogic::QFrameAction::triggered, this, [this](float) {
+        if (m_lodDirty && m_camera) {
+            updateLod(m_camera->position());
+        }
+        if (m_cullDirty && m_camera) {
+            updateCulling();
+        }
+    });
+    addComponent(frameAction);
+}
+
+int InstancedStarRenderer::addStar(const QVector3D &position, float radius, const QColor &color)
+{
+    m_positions.append(position);
+    m_radii.append(radius);
+    m_colors.append(color);
+    m_highlighted.append(false);
+    m_scales.append(scaleOf(m_positions.size() - 1));
+    m_nearSlots.append(-1);
+
+    // New stars go last until the next commit sorts them into the octree
+    int index = m_positions.size() - 1;
+    m_slots.append(index);
+    m_instanceData.resize(m_positions.size() * INSTANCE_STRIDE);
+    writeInstance(index);
+    return index;
+}
+
+void InstancedStarRenderer::clear()
+{
+    m_positions.clear();
+    m_radii.clear();
+    m_colors.clear();
+    m_scales.clear();
+    m_highlighted.clear();
+    m_marked = StarBitmap();
+    m_nearSlots.clear();
+    m_slots.clear();
+    m_instanceData.clear();
+    commit();
+}
+
+void InstancedStarRenderer::reserve(int stars)
+{
+    m_positions.reserve(stars);
+    m_radii.reserve(stars);
+    m_colors.reserve(stars);
+    m_scales.reserve(stars);
+    m_highlighted.reserve(stars);
+    m_nearSlots.reserve(stars);
+    m_slots.reserve(stars);
+    m_instanceData.reserve(stars * INSTANCE_STRIDE);
+}
+
+void InstancedStarRenderer::commit()
+{
+    // Sort the star buffer by octree leaf so every leaf is one range
+    m_octree.build(m_positions, m_radii, octreePadding(), STARS_PER_LEAF);
+    applyOctree();
+}
+
+void InstancedStarRenderer::commit(const StarOctree &octree)
+{
+    // Only a tree over exactly these stars can be reused
+    if (octree.starCount() != count()) {
+        commit();
+        return;
+    }
+
+    m_octree = octree;
+    applyOctree();
+}
+
+/*
+ * Appends the stars added since the last upload to the star buffer and
+ * draws everything after the octree as one batch. The buffer grows in
+ * doubling steps and only the new range is sent otherwise, so a whole
+ * load uploads every star a bounded number of times.
+ */
+void InstancedStarRenderer::uploadPending()
+{
+    const int stars = m_positions.size();
+    if (stars == m_uploadedCount)
+        return;
+
+    if (m_instanceData.size() > m_bufferSize) {
+        m_bufferSize = qMax(int(m_instanceData.size()), 2 * m_bufferSize);
+        QByteArray data = m_instanceData;
+        data.resize(m_bufferSize);
+        m_starBuffer->setData(data);
+    } else {
+        const int offset = m_uploadedCount * INSTANCE_STRIDE;
+        m_starBuffer->updateData(offset, m_instanceData.mid(offset));
+    }
+    m_pointPositionAttribute->setCount(stars);
+    m_pointColorAttribute->setCount(stars);
+
+    for (int i = m_uploadedCount; i < stars; ++i)
+        growPendingBounds(i);
+    m_uploadedCount = stars;
+
+    // One entity is cheaper to replace than to keep in step with the range
+    delete m_pendingChunk;
+    m_pendingChunk = createChunk(m_committedCount, stars - m_committedCount,
+                                 m_pendingMin, m_pendingMax, &m_pendingBounds);
+
+    // New stars near the camera join the sphere batch on the next frame
+    QVector3D minPoint = m_pendingMin;
+    QVector3D maxPoint = m_pendingMax;
+    if (!m_octree.isEmpty()) {
+        for (int axis = 0; axis < 3; ++axis) {
+            minPoint[axis] = qMin(minPoint[axis], m_octree.nodes().first().minPoint[axis]);
+            maxPoint[axis] = qMax(maxPoint[axis], m_octree.nodes().first().maxPoint[axis]);
+        }
+    }
+    m_sphereBounds->setMinPoint(minPoint);
+    m_sphereBounds->setMaxPoint(maxPoint);
+    m_lodDirty = true;
+}
+
+void InstancedStarRenderer::growPendingBounds(int index)
+{
+    const float padding = m_radii[index] * octreePadding();
+    for (int axis = 0; axis < 3; ++axis) {
+        m_pendingMin[axis] = qMin(m_pendingMin[axis], m_positions[index][axis] - padding);
+        m_pendingMax[axis] = qMax(m_pendingMax[axis], m_positions[index][axis] + padding);
+    }
+}
+
+float InstancedStarRenderer::octreePadding()
+{
+    return qMax(qMax(HIGHLIGHT_SCALE, MARK_SCALE), GLOW_EXTENT);
+}
+
+void InstancedStarRenderer::applyOctree()
+{
+    const int stars = m_positions.size();
+
+    const QVector<int> &order = m_octree.order();
+    for (int slot = 0; slot < order.size(); ++slot)
+        m_slots[order[slot]] = slot;
+    for (int i = 0; i < stars; ++i)
+        writeInstance(i);
+
+    m_starBuffer->setData(m_instanceData);
+    m_pointPositionAttribute->setCount(stars);
+    m_pointColorAttribute->setCount(stars);
+    m_bufferSize = m_instanceData.size();
+
+    // Every star is in a leaf now, the pending batch starts over empty
+    m_committedCount = stars;
+    m_uploadedCount = stars;
+    delete m_pendingChunk;
+    m_pendingChunk = nullptr;
+    m_pendingBounds = nullptr;
+    m_pendingMin = QVector3D(1.0f, 1.0f, 1.0f) * std::numeric_limits<float>::max();
+    m_pendingMax = -m_pendingMin;
+
+    // The root node bounds the whole catalog, including the glow quads
+    if (!m_octree.isEmpty()) {
+        m_sphereBounds->setMinPoint(m_octree.nodes().first().minPoint);
+        m_sphereBounds->setMaxPoint(m_octree.nodes().first().maxPoint);
+    }
+
+    rebuildChunks();
+    updateLod(m_camera ? m_camera->position() : m_cameraPosition);
+    if (m_camera)
+        updateCulling();
+
+    emit committed();
+}
+
+/*
+ * One entity drawing stars first .. first + count - 1 of the buffer.
+ * Points draw that vertex range of the shared geometry. The glow quads
+ * are instanced, and instanced draws with a base instance need OpenGL
+ * 4.2, so each chunk gets its own instance attribute starting at its
+ * offset instead.
+ */
+Qt3DCore::QEntity *InstancedStarRenderer::createChunk(int first, int count,
+                                                      const QVector3D &minPoint, const QVector3D &maxPoint,
+                                                      Qt3DCore::QBoundingVolume **bounds)
+{
+    auto *chunk = new Qt3DCore::QEntity(this);
+    *bounds = new Qt3DCore::QBoundingVolume(chunk);
+    (*bounds)->setMinPoint(minPoint);
+    (*bounds)->setMaxPoint(maxPoint);
+
+    auto *pointEntity = new Qt3DCore::QEntity(chunk);
+    auto *pointMesh = new Qt3DRender::QGeometryRenderer();
+    pointMesh->setGeometry(m_pointGeometry);
+    pointMesh->setPrimitiveType(Qt3DRender::QGeometryRenderer::Points);
+    pointMesh->setFirstVertex(first);
+    pointMesh->setVertexCount(count);
+    pointEntity->addComponent(pointMesh);
+    pointEntity->addComponent(*bounds);
+    pointEntity->addComponent(m_impostorMaterial);
+
+    auto *glowEntity = new Qt3DCore::QEntity(chunk);
+    auto *glowQuad = new Qt3DCore::QGeometry(glowEntity);
+
+    auto *cornerAttribute = new Qt3DCore::QAttribute(glowQuad);
+    cornerAttribute->setName(Qt3DCore::QAttribute::defaultPositionAttributeName());
+    cornerAttribute->setAttributeType(Qt3DCore::QAttribute::VertexAttribute);
+    cornerAttribute->setVertexBaseType(Qt3DCore::QAttribute::Float);
+    cornerAttribute->setVertexSize(2);
+    cornerAttribute->setByteStride(2 * sizeof(float));
+    cornerAttribute->setCount(4);
+    cornerAttribute->setBuffer(m_cornerBuffer);
+
+    auto *glowPositionAttribute = createStarAttribute(QStringLiteral("instancePosition"),
+                                                      first * INSTANCE_STRIDE, 1,
+                                                      m_starBuffer, glowQuad);
+    glowPositionAttribute->setCount(count);
+    glowQuad->addAttribute(cornerAttribute);
+    glowQuad->addAttribute(glowPositionAttribute);
+
+    auto *glowMesh = new Qt3DRender::QGeometryRenderer();
+    glowMesh->setGeometry(glowQuad);
+    glowMesh->setPrimitiveType(Qt3DRender::QGeometryRenderer::TriangleStrip);
+    glowMesh->setVertexCount(4);
+    glowMesh->setInstanceCount(count);
+    glowEntity->addComponent(glowMesh);
+    glowEntity->addComponent(*bounds);
+    glowEntity->addComponent(m_glowMaterial);
+
+    return chunk;
+}
+
+/*
+ * Cuts the octree into chunks: the highest nodes holding at most
+ * STARS_PER_CHUNK stars, or leaves that couldn't be split further.
+ * Chunks are kept in buffer order so a slot finds its chunk by a binary
+ * search.
+ */
+void InstancedStarRenderer::rebuildChunks()
+{
+    qDeleteAll(m_chunks);
+    m_chunks.clear();
+    m_chunkBounds.clear();
+    m_chunkNodes.clear();
+
+    const QVector<StarOctree::Node> &nodes = m_octree.nodes();
+    QVector<int> stack;
+    if (!nodes.isEmpty())
+        stack.append(0);
+    while (!stack.isEmpty()) {
+        const int index = stack.takeLast();
+        const StarOctree::Node &node = nodes[index];
+        if (node.count == 0)
+            continue;
+        if (node.firstChild >= 0 && node.count > STARS_PER_CHUNK) {
+            for (int child = 0; child < node.childCount; ++child)
+                stack.append(node.firstChild + child);
+            continue;
+        }
+        m_chunkNodes.append(index);
+    }
+    std::sort(m_chunkNodes.begin(), m_chunkNodes.end(), [&nodes](int a, int b) {
+        return nodes[a].first < nodes[b].first;
+    });
+
+    for (int index : std::as_const(m_chunkNodes)) {
+        const StarOctree::Node &node = nodes[index];
+        Qt3DCore::QBoundingVolume *bounds = nullptr;
+        m_chunks.append(createChunk(node.first, node.count, node.minPoint, node.maxPoint, &bounds));
+        m_chunkBounds.append(bounds);
+    }
+
+    m_chunkVisible.fill(true, m_chunks.size());
+    m_culledCount = 0;
+}
+
+/*
+ * Frustum test against the chunk boxes, chunks outside are disabled so
+ * Qt3D skips their draws entirely. There are only a few hundred, so they
+ * are tested directly. Runs at most once per frame.
+ */
+void InstancedStarRenderer::updateCulling()
+{
+    PerfTimer timer(PerfMonitor::Culling);
+    m_cullDirty = false;
+    if (!m_camera)
+        return;
+
+    const StarFrustum frustum(m_camera->lens()->projectionMatrix() * m_camera->viewMatrix());
+
+    int visibleStars = 0;
+    int visibleChunks = 0;
+    for (int i = 0; i < m_chunks.size(); ++i) {
+        const StarOctree::Node &node = m_octree.nodes().at(m_chunkNodes[i]);
+        const bool visible = frustum.classify(node.minPoint, node.maxPoint) != StarFrustum::Outside;
+        if (visible) {
+            visibleStars += node.count;
+            ++visibleChunks;
+        }
+        if (m_chunkVisible[i] != visible) {
+            m_chunkVisible[i] = visible;
+            m_chunks[i]->setEnabled(visible);
+        }
+    }
+
+    m_culledCount = m_committedCount - visibleStars;
+    qCDebug(lcStarCulling) << "culled" << m_culledCount << "of" << count() << "stars,"
+                           << visibleChunks << "of" << m_chunks.size() << "chunks drawn";
+    emit cullingUpdated(visibleStars, m_culledCount);
+}
+
+void InstancedStarRenderer::setHighlighted(int index, bool highlighted)
+{
+    if (index < 0 || index >= m_scales.size())
+        return;
+
+    m_highlighted[index] = highlighted;
+    const float scale = scaleOf(index);
+    if (m_scales[index] == scale)
+        return;
+
+    m_scales[index] = scale;
+    writeInstance(index);
+    uploadInstance(index);
+}
+
+void InstancedStarRenderer::setMarked(const StarBitmap &stars)
+{
+    const StarBitmap changed = m_marked ^ stars;
+    m_marked = stars;
+
+    int rewritten = 0;
+    changed.forEach([this, &rewritten](int index) {
+        if (index >= m_scales.size())
+            return;
+        const float scale = scaleOf(index);
+        if (m_scales[index] != scale) {
+            m_scales[index] = scale;
+            writeInstance(index);
+            ++rewritten;
+        }
+    });
+    if (rewritten == 0)
+        return;
+
+    // Many stars change at once, one upload of the whole buffer is cheaper than one per star
+    m_starBuffer->setData(m_instanceData);
+    m_bufferSize = m_instanceData.size();
+    updateLod(m_cameraPosition);
+    emit markedChanged();
+}
+
+float InstancedStarRenderer::scaleOf(int index) const
+{
+    if (m_highlighted[index])
+        return HIGHLIGHT_SCALE;
+    return m_marked.test(index) ? MARK_SCALE : 1.0f;
+}
+
+void InstancedStarRenderer::updateStar(int index, const QVector3D &position, float radius, const QColor &color)
+{
+    if (index < 0 || index >= m_positions.size())
+        return;
+
+    // A star that moved may belong in another leaf, sort again
+    if (m_positions[index] != position) {
+        m_positions[index] = position;
+        m_radii[index] = radius;
+        m_colors[index] = color;
+        commit();
+        return;
+    }
+
+    m_radii[index] = radius;
+    m_colors[index] = color;
+    writeInstance(index);
+    uploadInstance(index);
+
+    // A star after the octree only widens the pending batch
+    if (m_slots[index] >= m_committedCount) {
+        growPendingBounds(index);
+        if (m_pendingBounds) {
+            m_pendingBounds->setMinPoint(m_pendingMin);
+            m_pendingBounds->setMaxPoint(m_pendingMax);
+        }
+        emit starUpdated(index);
+        return;
+    }
+
+    // Grow the boxes down to the star's leaf so a larger star isn't culled
+    // early, the chunk holding it is one of the nodes on the way
+    const int slot = m_slots[index];
+    if (m_octree.grow(slot, position, radius * octreePadding()) >= 0) {
+        auto startsAfter = [this](int value, int chunkNode) { return value < m_octree.nodes().at(chunkNode).first; };
+        const int chunk = int(std::upper_bound(m_chunkNodes.constBegin(), m_chunkNodes.constEnd(), slot, startsAfter)
+                              - m_chunkNodes.constBegin()) - 1;
+        if (chunk >= 0) {
+            const StarOctree::Node &node = m_octree.nodes().at(m_chunkNodes[chunk]);
+            m_chunkBounds[chunk]->setMinPoint(node.minPoint);
+            m_chunkBounds[chunk]->setMaxPoint(node.maxPoint);
+        }
+    }
+    if (!m_octree.isEmpty()) {
+        m_sphereBounds->setMinPoint(m_octree.nodes().first().minPoint);
+        m_sphereBounds->setMaxPoint(m_octree.nodes().first().maxPoint);
+    }
+    m_cullDirty = true;
+
+    emit starUpdated(index);
+}
+
+void InstancedStarRenderer::setNearDistance(float distance)
+{
+    if (m_nearDistance == distance)
+        return;
+
+    m_nearDistance = distance;
+    m_nearDistanceParameter->setValue(distance);
+    updateLod(m_cameraPosition);
+}
+
+void InstancedStarRenderer::setCamera(Qt3DRender::QCamera *camera)
+{
+    if (m_camera) {
+        disconnect(m_camera, nullptr, this, nullptr);
+        disconnect(m_camera->lens(), nullptr, this, nullptr);
+    }
+
+    m_camera = camera;
+    if (!m_camera)
+        return;
+
+    connect(m_camera, &Qt3DRender::QCamera::positionChanged, this, [this]() {
+        m_lodDirty = true;
+        m_cullDirty = true;
+    });
+    connect(m_camera, &Qt3DRender::QCamera::viewCenterChanged, this, [this]() { m_cullDirty = true; });
+    connect(m_camera, &Qt3DRender::QCamera::upVectorChanged, this, [this]() { m_cullDirty = true; });
+    connect(m_camera->lens(), &Qt3DRender::QCameraLens::projectionMatrixChanged, this, [this]() { m_cullDirty = true; });
+    updateLod(m_camera->position());
+    updateCulling();
+}
+
+/*
+ * Collects the stars inside the near distance into the sphere batch.
+ * The impostor shader skips exactly these stars, using the same test.
+ * Candidates come from the octree, the stars of the pending batch are
+ * tested one by one.
+ */
+void InstancedStarRenderer::updateLod(const QVector3D &cameraPosition)
+{
+    m_cameraPosition = cameraPosition;
+    m_lodDirty = false;
+
+    for (int index : std::as_const(m_nearStars)) {
+        if (index < m_nearSlots.size())
+            m_nearSlots[index] = -1;
+    }
+    m_nearStars.clear();
+
+    const float nearSquared = m_nearDistance * m_nearDistance;
+    m_octree.forEachInSphere(cameraPosition, m_nearDistance, [this, &cameraPosition, nearSquared](int i) {
+        if ((m_positions[i] - cameraPosition).lengthSquared() < nearSquared) {
+            m_nearSlots[i] = m_nearStars.size();
+            m_nearStars.append(i);
+        }
+    });
+    for (int i = m_committedCount; i < m_uploadedCount; ++i) {
+        if ((m_positions[i] - cameraPosition).lengthSquared() < nearSquared) {
+            m_nearSlots[i] = m_nearStars.size();
+            m_nearStars.append(i);
+        }
+    }
+
+    // The sphere batch uses the same layout, so whole entries are copied
+    m_nearData.resize(m_nearStars.size() * INSTANCE_STRIDE);
+    for (int slot = 0; slot < m_nearStars.size(); ++slot) {
+        std::memcpy(m_nearData.data() + slot * INSTANCE_STRIDE,
+                    m_instanceData.constData() + m_slots[m_nearStars[slot]] * INSTANCE_STRIDE,
+                    INSTANCE_STRIDE);
+    }
+
+    m_nearBuffer->setData(m_nearData);
+    m_nearPositionAttribute->setCount(m_nearStars.size());
+    m_nearColorAttribute->setCount(m_nearStars.size());
+    m_sphereMesh->setInstanceCount(m_nearStars.size());
+}
+
+void InstancedStarRenderer::writeInstance(int index)
+{
+    const QVector3D &position = m_positions[index];
+    const QColor &color = m_colors[index];
+
+    const float instance[FLOATS_PER_INSTANCE] = {
+        position.x(), position.y(), position.z(), m_radii[index],
+        float(color.redF()), float(color.greenF()), float(color.blueF()), m_scales[index]
+    };
+    std::memcpy(m_instanceData.data() + m_slots[index] * INSTANCE_STRIDE, instance, INSTANCE_STRIDE);
+}
+
+// Sends one star to whichever batches hold it
+void InstancedStarRenderer::uploadInstance(int index)
+{
+    const int offset = m_slots[index] * INSTANCE_STRIDE;
+    const QByteArray entry = m_instanceData.mid(offset, INSTANCE_STRIDE);
+
+    // A star not uploaded yet goes up with the next uploadPending()
+    if (m_slots[index] < m_uploadedCount)
+        m_starBuffer->updateData(offset, entry);
+
+    const int slot = m_nearSlots[index];
+    if (slot >= 0) {
+        std::memcpy(m_nearData.data() + slot * INSTANCE_STRIDE, entry.constData(), INSTANCE_STRIDE);
+        m_nearBuffer->updateData(slot * INSTANCE_STRIDE, entry);
+    }
+}
@@ -0,0 +1,208 @@
+#ifndef INSTANCEDSTARRENDERER_H
+#define INSTANCEDSTARRENDERER_H
+
+#include <Qt3DCore/QEntity>
+#include <Qt3DCore/QBuffer>
+#include <Qt3DCore/QAttribute>
+#include <Qt3DCore/QGeometry>
+#include <Qt3DCore/QBoundingVolume>
+#include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DRender/QParameter>
+#include <Qt3DRender/QCamera>
+#include <Qt3DRender/QMaterial>
+#include <QVector>
+#include <QVector3D>
+#include <QColor>
+#include <QByteArray>
+#include <QLoggingCategory>
+#include "staroctree.h"
+#include "starbitmap.h"
+
+Q_DECLARE_LOGGING_CATEGORY(lcStarCulling)
+
+/*
+ * Draws the whole star catalog in three batches.
+ *
+ * Every star is one entry in a shared buffer holding position, radius,
+ * spectral colour and a highlight scale. Stars beyond the near distance
+ * are drawn from that buffer as point sprites, one vertex per star, with
+ * a ray-cast sphere impostor shader. Stars inside the near distance are
+ * copied into a small instance buffer and drawn as real instanced
+ * spheres. The glow billboards are one instanced quad batch over the
+ * star buffer, turned towards the camera in the vertex shader, so a
+ * camera move costs nothing on the CPU.
+ *
+ * The star buffer is stored in octree order, so every octree node is one
+ * range of it. The tree is cut into chunks of up to a few thousand stars,
+ * each with its own point and glow draw over its range, and chunks
+ * outside the camera frustum are disabled once per frame.
+ *
+ * While a catalog streams in, uploadPending() appends the new stars to
+ * the end of the buffer and draws them as one extra batch that isn't
+ * culled, so sorting them into the octree waits for a single commit.
+ *
+ * Stars are addressed by their catalog index, i.e. the order they were
+ * added in, which is the same order as the rows of the StarCatalog.
+ */
+class InstancedStarRenderer : public Qt3DCore::QEntity
+{
+    Q_OBJECT
+
+public:
+    // Hovered stars are drawn and picked this much larger
+    static constexpr float HIGHLIGHT_SCALE = 1.5f;
+
+    // Stars marked by a search, smaller than a hovered star so hovering still shows
+    static constexpr float MARK_SCALE = 1.3f;
+
+    explicit InstancedStarRenderer(Qt3DCore::QNode *parent = nullptr);
+
+    // Append a star and return its catalog index
+    int addStar(const QVector3D &position, float radius, const QColor &color);
+
+    // Remove all stars
+    void clear();
+
+    // Make room for this many stars before adding them
+    void reserve(int stars);
+
+    // Upload the star buffer after stars have been added or removed
+    void commit();
+
+    // Same, with an octree built earlier for exactly these stars (e.g. from the
+    // catalog cache) instead of building it again
+    void commit(const StarOctree &octree);
+
+    // Upload the stars added since the last commit without sorting them into
+    // the octree. They are drawn unculled until the next commit.
+    void uploadPending();
+
+    // Star radii are multiplied by this for the octree bounds
+    static float octreePadding();
+
+    int count() const { return m_positions.size(); }
+    QVector3D position(int index) const { return m_positions.at(index); }
+    float radius(int index) const { return m_radii.at(index); }
+    QColor color(int index) const { return m_colors.at(index); }
+    const QVector<QVector3D> &positions() const { return m_positions; }
+    const QVector<float> &radii() const { return m_radii; }
+    const QVector<QColor> &colors() const { return m_colors; }
+
+    // Radius including the current highlight scale, used for picking
+    float pickRadius(int index) const { return m_radii.at(index) * m_scales.at(index); }
+
+    // Enlarge a star without touching the shared sphere geometry
+    void setHighlighted(int index, bool highlighted);
+
+    // Enlarge every star set in stars, e.g. the result of a type search.
+    // Replaces the previous marks, an empty bitmap removes them.
+    void setMarked(const StarBitmap &stars);
+    const StarBitmap &marked() const { return m_marked; }
+
+    // Change one committed star in place. Only a moved star commits again.
+    void updateStar(int index, const QVector3D &position, float radius, const QColor &color);
+
+    // Stars closer to the camera than this are drawn as real spheres
+    void setNearDistance(float distance);
+    float nearDistance() const { return m_nearDistance; }
+
+    // Follow this camera and refresh the sphere batch when it moves
+    void setCamera(Qt3DRender::QCamera *camera);
+
+    // Rebuild the sphere batch for the given camera position
+    void updateLod(const QVector3D &cameraPosition);
+
+    // Number of stars currently drawn as spheres
+    int nearCount() const { return m_nearStars.size(); }
+
+    // Spatial index over the committed stars, shared with culling and labels
+    const StarOctree &octree() const { return m_octree; }
+
+    // Enable only the chunks that intersect the camera frustum
+    void updateCulling();
+
+    // Stars skipped by the last culling pass
+    int culledCount() const { return m_culledCount; }
+
+signals:
+    void cullingUpdated(int visibleStars, int culledStars);
+
+    // Stars were added or removed and the buffers uploaded
+    void committed();
+
+    // One star's radius or colour changed in place
+    void starUpdated(int index);
+
+    // The marked stars changed
+    void markedChanged();
+
+private:
+    float scaleOf(int index) const;
+    void writeInstance(int index);
+    void uploadInstance(int index);
+    Qt3DCore::QEntity *createChunk(int first, int count, const QVector3D &minPoint, const QVector3D &maxPoint,
+                                   Qt3DCore::QBoundingVolume **bounds);
+    void rebuildChunks();
+    void applyOctree();
+    void growPendingBounds(int index);
+
+    Qt3DCore::QEntity *m_sphereEntity;
+    Qt3DRender::QGeometryRenderer *m_sphereMesh;
+    Qt3DCore::QBuffer *m_nearBuffer;
+    Qt3DCore::QAttribute *m_nearPositionAttribute;
+    Qt3DCore::QAttribute *m_nearColorAttribute;
+    Qt3DCore::QBoundingVolume *m_sphereBounds;
+
+    Qt3DCore::QGeometry *m_pointGeometry;
+    Qt3DCore::QBuffer *m_starBuffer;
+    Qt3DCore::QAttribute *m_pointPositionAttribute;
+    Qt3DCore::QAttribute *m_pointColorAttribute;
+    Qt3DRender::QMaterial *m_impostorMaterial;
+    Qt3DRender::QParameter *m_nearDistanceParameter;
+
+    Qt3DCore::QBuffer *m_cornerBuffer;
+    Qt3DRender::QMaterial *m_glowMaterial;
+
+    // One entity per chunk, holding its point and glow draws, and the octree
+    // node it draws. Sorted by the node's range of the buffer.
+    QVector<Qt3DCore::QEntity *> m_chunks;
+    QVector<Qt3DCore::QBoundingVolume *> m_chunkBounds;
+    QVector<int> m_chunkNodes;
+    QVector<bool> m_chunkVisible;
+
+    // Stars in the octree, the ones after them are drawn by the pending batch
+    int m_committedCount;
+    int m_uploadedCount;
+    int m_bufferSize;
+    Qt3DCore::QEntity *m_pendingChunk;
+    Qt3DCore::QBoundingVolume *m_pendingBounds;
+    QVector3D m_pendingMin;
+    QVector3D m_pendingMax;
+
+    Qt3DRender::QCamera *m_camera;
+    QVector3D m_cameraPosition;
+    float m_nearDistance;
+    bool m_lodDirty;
+    bool m_cullDirty;
+    int m_culledCount;
+
+    StarOctree m_octree;
+
+    QVector<QVector3D> m_positions;
+    QVector<float> m_radii;
+    QVector<QColor> m_colors;
+    QVector<float> m_scales;
+    QVector<bool> m_highlighted;
+    StarBitmap m_marked;
+
+    // Entries in octree order, m_slots maps a catalog index to its entry
+    QVector<int> m_slots;
+    QByteArray m_instanceData;
+
+    // Catalog indices drawn as spheres and the slot of each star in that batch (-1 if far)
+    QVector<int> m_nearStars;
+    QVector<int> m_nearSlots;
+    QByteArray m_nearData;
+};
+
+#endif // INSTANCEDSTARRENDERER_H
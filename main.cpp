@@ -3,37 +3,6 @@
 #include <functional>
 #include <Qt3DInput/QInputAspect>
 
-/*
-Function to initialize the database and run a query to the star data
-
-Input:
-- QString with the path to the database
-
-Output:
-- QSqlQuery with the star data
-*/
-QSqlQuery getStars (const QString &database_path) {
-
-    //fixing clumped stars (körs bara en gång, kommenteras bort efter det)
-    //SeparateStars(database_path.toStdString());
-
-    QSqlDatabase database = openDatabase(database_path.toStdString());
-    if (!database.isOpen()) {
-        QMessageBox::critical(nullptr, "Fatal Error", "Could not open stars database.");
-        return QSqlQuery(); // Returnera tom query om misslyckad anslutning
-    }
-
-    QSqlQuery db_query(database);  // Använd rätt databas
-    if (!db_query.exec("SELECT MAIN_ID, x_koord, y_koord, z_koord, SP_TYPE FROM stars")) {
-        qWarning() << "Error: Query failed:" << db_query.lastError().text();
-        QMessageBox::critical(nullptr, "Query Error", "Failed to retrieve star data from the database.");
-        return QSqlQuery();
-    }
-
-    return db_query;
-}
-
-
 /*
 Function to load background music
 
@@ -104,9 +73,9 @@ Output:
 - none (void function)
 */
 void createSkybox(Qt3DCore::QEntity *rootEntity) {
-    Qt3DExtras::QSkyboxEntity *skybox = new Qt3DExtras::QSkyboxEntity(rootEntity);
-    skybox->setBaseName("qrc:/textures/skybox");
-    skybox->setExtension(".png");
+    // Uses textures/skybox.ktx or .dds if there is one, otherwise the
+    // six PNG faces are decoded on worker threads
+    SkyboxEntity *skybox = new SkyboxEntity("qrc:/textures/skybox", ".png", rootEntity);
     Qt3DCore::QTransform *skyboxTransform = new Qt3DCore::QTransform();
     skyboxTransform->setScale(2500.0f);
     skybox->addComponent(skyboxTransform);
@@ -127,104 +96,38 @@ void handleFirstPersonCameraInput(QWidget *container, Qt3DExtras::Qt3DWindow *vi
     container->setFocus();
 }
 
-/*
-Function to reload star info from updated database
-*/
-void reloadStars(Qt3DCore::QEntity *rootEntity,
-                 Qt3DRender::QCamera *camera,
-                 QVector<Qt3DCore::QEntity *> &starEntities,
-                 QVector<Qt3DExtras::QPhongMaterial *> &starMaterials,
-                 QVector<QString> &starIds,
-                 QVector<Qt3DExtras::QText2DEntity *> &starLabels,
-                 const QString &databasePath,
-                 InfoBox *topPanel,
-                 ActivityBox *bottomPanel,
-                 CameraManager *cameraManager,
-                 Qt3DExtras::Qt3DWindow *view)
-{
-    // Rensa gamla stjäror från scenen
-    for (auto *entity : starEntities) {
-        delete entity;
+int main(int argc, char *argv[]) {
+    // The star shaders are written for the OpenGL renderer
+    if (!qEnvironmentVariableIsSet("QT3D_RENDERER")) {
+        qputenv("QT3D_RENDERER", "opengl");
     }
-    starEntities.clear();
-    starMaterials.clear();
-    starIds.clear();
-    starLabels.clear();
-
-    QSqlQuery query = getStars(databasePath);
 
-    while (query.next()) {
-        StarCreator::createStar(&starEntities, &starMaterials, &starIds, &starLabels, &query, rootEntity, camera);
-    }
+    QApplication app(argc, argv);
 
-    auto updateLabels = [view, &starEntities, &starLabels]() {
-        StarCreator::updateLabels(view, starEntities, starLabels);
-    };
-
-    for (int j = 0; j < starEntities.size(); ++j) {
-        Qt3DCore::QEntity *starEntity = starEntities[j];
-        Qt3DCore::QTransform *starTransform = nullptr;
-        Qt3DExtras::QSphereMesh *starMesh = nullptr;
-
-        for (Qt3DCore::QComponent *component : starEntity->components()) {
-            if (auto mesh = qobject_cast<Qt3DExtras::QSphereMesh *>(component)) {
-                starMesh = mesh;
-            } else if (auto transform = qobject_cast<Qt3DCore::QTransform *>(component)) {
-                starTransform = transform;
-            }
+    // Large catalogs are split into a chunk file once and streamed from it
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption chunksOption("chunks", "Stream extra stars from a chunk file.", "file");
+    QCommandLineOption buildChunksOption("build-chunks",
+                                         "Split the stars table of a database into the --chunks file and exit.",
+                                         "database");
+    QCommandLineOption chunkBudgetOption("chunk-budget", "Megabytes of streamed stars kept in memory.", "MB", "256");
+    QCommandLineOption continuousOption("continuous", "Render every frame instead of only when the scene changes.");
+    QCommandLineOption perfHudOption("perf-hud", "Show the performance HUD from the start (F3 toggles it).");
+    parser.addOption(chunksOption);
+    parser.addOption(buildChunksOption);
+    parser.addOption(chunkBudgetOption);
+    parser.addOption(continuousOption);
+    parser.addOption(perfHudOption);
+    parser.process(app);
+
+    if (parser.isSet(buildChunksOption)) {
+        if (!parser.isSet(chunksOption)) {
+            qWarning() << "--build-chunks needs --chunks with the file to write";
+            return 1;
         }
-
-        Qt3DExtras::QPhongMaterial *starMaterial = starMaterials[j];
-
-        Qt3DRender::QObjectPicker *picker = new Qt3DRender::QObjectPicker(starEntity);
-        picker->setHoverEnabled(true);
-        picker->setDragEnabled(false);
-
-        QObject::connect(picker, &Qt3DRender::QObjectPicker::clicked,
-                         [cameraManager, starTransform, bottomPanel, topPanel, starId = starIds[j]](Qt3DRender::QPickEvent *pick) {
-                             if (pick->button() == Qt3DRender::QPickEvent::LeftButton) {
-                                 if (topPanel->getStarId() == starId) {
-                                     cameraManager->handleStarClick(starTransform);
-                                 }
-                                 bottomPanel->setCurrentStarId(starId);
-                                 bottomPanel->updateFavoriteButtonIcon();
-
-                                 QVector3D position = starTransform->translation();
-                                 QSqlQuery query(QSqlDatabase::database("starsConnection"));
-                                 query.prepare("SELECT SP_TYPE FROM stars WHERE MAIN_ID = ?");
-                                 query.addBindValue(starId);
-                                 if (query.exec() && query.next()) {
-                                     QString spType = query.value(0).toString();
-                                     topPanel->setStarInfo(starId,
-                                                           QString::number(position.x()),
-                                                           QString::number(position.y()),
-                                                           QString::number(position.z()),
-                                                           spType);
-                                 }
-                             }
-                         });
-
-        QObject::connect(picker, &Qt3DRender::QObjectPicker::entered,
-                         [starMesh, &starEntities, &starMaterials, starMaterial, starLabel = starLabels[j], updateLabels]() {
-                             StarCreator::hoverStar(starMesh, starEntities, starMaterials, starMaterial, starLabel);
-                             if (starLabel) {
-                                 starLabel->setEnabled(true);
-                                 QTimer::singleShot(0, updateLabels);
-                             }
-                         });
-
-        QObject::connect(picker, &Qt3DRender::QObjectPicker::exited,
-                         [starMesh, &starEntities, &starMaterials, starMaterial, starLabel = starLabels[j]]() {
-                             StarCreator::resetStar(starMesh, starEntities, starMaterials, starMaterial, starLabel);
-                         });
-
-        starEntity->addComponent(picker);
+        return StarChunkStore::build(parser.value(buildChunksOption), parser.value(chunksOption)) ? 0 : 1;
     }
-}
-
-
-int main(int argc, char *argv[]) {
-    QApplication app(argc, argv);
 
     // Load background music
     BackgroundMusic *bgMusic = loadMusic(&app, "BackgroundMusic", 0.3f);
@@ -323,6 +226,18 @@ int main(int argc, char *argv[]) {
     // Create camera manager to manage both camera modes
     CameraManager *cameraManager = new CameraManager(view->camera(), rootEntity, bgMusic);
 
+    // Frames are only rendered when something changed, --continuous renders all of them.
+    // Flights need every frame while they run.
+    RenderScheduler *renderScheduler = new RenderScheduler(view->renderSettings(), rootEntity, &app);
+    renderScheduler->setContinuous(parser.isSet(continuousOption));
+    QObject::connect(cameraManager->animator(), &AnimationEngine::activeChanged, [renderScheduler, cameraManager](bool active) {
+        renderScheduler->setBusy(cameraManager->animator(), active);
+    });
+    QObject::connect(camera, &Qt3DRender::QCamera::positionChanged, renderScheduler, &RenderScheduler::requestFrame);
+    QObject::connect(camera, &Qt3DRender::QCamera::viewCenterChanged, renderScheduler, &RenderScheduler::requestFrame);
+    QObject::connect(TextureCache::instance(), &TextureCache::statisticsChanged,
+                     renderScheduler, &RenderScheduler::requestFrame);
+
     // Set initial camera mode to ThirdPersonMode when program starts
     cameraManager->setCameraMode(CameraManager::ThirdPersonMode);
 
@@ -344,104 +259,132 @@ int main(int argc, char *argv[]) {
     QObject::connect(bottomPanel, &ActivityBox::teleportToStar,
                      cameraManager, &CameraManager::teleportToStar);
 
-    // Database operations: get stars (now med SP_TYPE)
-    QSqlQuery query = getStars(argv[0]);
+    // The GUI thread's connection, InfoBox writes edits through it
+    openDatabase(std::string(argv[0]));
+
+    // Every star is read once into the catalog, clicks and searches
+    // look them up there instead of in SQLite
+    StarCatalog catalog;
+    bottomPanel->setCatalog(&catalog);
+    topPanel->setCatalog(&catalog);
+    cameraManager->setCatalog(&catalog);
+
+    // All stars are drawn by one instanced renderer.
+    // Stars further away than the near distance are drawn as point sprites.
+    InstancedStarRenderer *starRenderer = new InstancedStarRenderer(rootEntity);
+    starRenderer->setNearDistance(40.0f);
+    starRenderer->setCamera(camera);
+
+    // One pass per frame projects every star, labels and lights read from it
+    StarProjection *projection = new StarProjection(rootEntity, camera, starRenderer, &app);
+
+    // All labels are drawn from one glyph atlas, only the shown ones get quads.
+    // Stars drawn as spheres show their name without being hovered.
+    StarLabelRenderer *labelRenderer = new StarLabelRenderer(starRenderer, rootEntity);
+    labelRenderer->setCamera(camera);
+    labelRenderer->setProjection(projection);
+    labelRenderer->setLabelRadius(starRenderer->nearDistance());
+
+    // A fixed pool of point lights follows the stars nearest the camera
+    new StarLightBudget(rootEntity, projection, starRenderer, 8, &app);
+
+    // Stars are read on a worker thread and stream into the scene a few
+    // milliseconds per frame, the window is usable right away
+    StarLoader *starLoader = new StarLoader(rootEntity, &catalog, starRenderer, labelRenderer, &app);
+    QObject::connect(starLoader, &StarLoader::finished, [](bool ok) {
+        if (!ok) {
+            QMessageBox::critical(nullptr, "Query Error", "Failed to retrieve star data from the database.");
+        }
 
-    // Create stars from database
-    QVector<Qt3DCore::QEntity *> starEntities;
-    QVector<Qt3DExtras::QPhongMaterial *> starMaterials;
-    QVector<QString> starIds;
-    QVector<Qt3DExtras::QText2DEntity *> starLabels;
+        // The whole catalog should share one glow texture
+        const TextureCache *textures = TextureCache::instance();
+        qCInfo(lcTextures) << textures->count() << "textures," << textures->hits() << "hits,"
+                           << textures->misses() << "misses," << textures->residentBytes() << "bytes";
+    });
 
-    while (query.next()) {
-        
-        // StarCreator::createStar använder nu även spType för att räkna ut rätt radie
-        StarCreator::createStar(&starEntities, &starMaterials, &starIds, &starLabels, &query, rootEntity,camera);
+    // Catalogs too large for memory stream in chunk by chunk around the camera.
+    // A teleport loads the chunks at the destination while the camera flies there.
+    if (parser.isSet(chunksOption)) {
+        StarChunkStreamer *chunkStreamer = new StarChunkStreamer(parser.value(chunksOption), rootEntity);
+        chunkStreamer->setCamera(camera);
+        chunkStreamer->setMemoryBudget(parser.value(chunkBudgetOption).toLongLong() * 1024 * 1024);
+        QObject::connect(bottomPanel, &ActivityBox::teleportToStar,
+                         chunkStreamer, &StarChunkStreamer::prefetch);
+        QObject::connect(chunkStreamer, &StarChunkStreamer::residencyChanged,
+                         renderScheduler, &RenderScheduler::requestFrame);
+    }
 
+    // Stars stream in a few per frame, keep frames coming until they are all in
+    QObject::connect(starLoader, &StarLoader::loadingChanged, [renderScheduler, starLoader](bool loading) {
+        renderScheduler->setBusy(starLoader, loading);
+    });
+    QObject::connect(starRenderer, &InstancedStarRenderer::committed, renderScheduler, &RenderScheduler::requestFrame);
+    QObject::connect(starRenderer, &InstancedStarRenderer::starUpdated, renderScheduler, &RenderScheduler::requestFrame);
+    QObject::connect(starRenderer, &InstancedStarRenderer::markedChanged, renderScheduler, &RenderScheduler::requestFrame);
+
+    // Stars matching the type filter are enlarged in the 3D view
+    QObject::connect(bottomPanel, &ActivityBox::typeMatched, starRenderer, &InstancedStarRenderer::setMarked);
+
+    // Performance HUD over the 3D view, F3 shows it and F4 writes the frame history to CSV
+    PerfMonitor::instance()->attach(rootEntity);
+    PerfMonitor::instance()->watch(starRenderer, labelRenderer);
+    PerfOverlay *perfOverlay = new PerfOverlay(container, rootEntity, &mainWindow);
+    QShortcut *perfToggle = new QShortcut(QKeySequence(Qt::Key_F3), &mainWindow);
+    perfToggle->setContext(Qt::ApplicationShortcut);
+    QObject::connect(perfToggle, &QShortcut::activated, perfOverlay, &PerfOverlay::toggle);
+    QShortcut *perfDump = new QShortcut(QKeySequence(Qt::Key_F4), &mainWindow);
+    perfDump->setContext(Qt::ApplicationShortcut);
+    QObject::connect(perfDump, &QShortcut::activated, perfOverlay, &PerfOverlay::dumpCsv);
+    if (parser.isSet(perfHudOption)) {
+        perfOverlay->show();
     }
 
-    // Define the label update lambda
-    auto updateLabels = [view, starEntities, starLabels]() {
-        StarCreator::updateLabels(view, starEntities, starLabels);
-    };
+    // An edit only updates the star it touched, nothing is reloaded
+    QObject::connect(topPanel, &InfoBox::starEdited, starLoader, &StarLoader::reconcileStar);
 
-    QObject::connect(topPanel, &InfoBox::requestReload, [&]() {
-        reloadStars(rootEntity, camera, starEntities, starMaterials, starIds, starLabels,
-                    argv[0], topPanel, bottomPanel, cameraManager, view);
+    // Id suggestions follow the catalog, after a load and after a rename
+    QObject::connect(starLoader, &StarLoader::loadingChanged, bottomPanel, [bottomPanel](bool loading) {
+        if (loading)
+            bottomPanel->clearIdIndex();
     });
+    QObject::connect(starLoader, &StarLoader::finished, bottomPanel, &ActivityBox::rebuildIdIndex);
+    QObject::connect(topPanel, &InfoBox::starEdited, bottomPanel, &ActivityBox::rebuildIdIndex);
+
+    // One picker ray casts against the whole catalog, signals carry the star index
+    StarPicker *starPicker = new StarPicker(view, starRenderer, &app);
+
+    // Connect picker to camera manager and InfoBox
+    QObject::connect(starPicker, &StarPicker::clicked,
+                     [cameraManager, starRenderer, bottomPanel, topPanel, &catalog](int index) {
+                         const QString &starId = catalog.id(index);
+                         QVector3D position = starRenderer->position(index);
+
+                         if(topPanel->getStarId()==starId){
+                             cameraManager->handleStarClick(position);
+                         }
+                         bottomPanel->setCurrentStarId(starId);
+                         bottomPanel->updateFavoriteButtonIcon();
+
+                         // Renderarens index är samma rad i katalogen
+                         topPanel->showStar(index);
+                     });
 
-    // Connect camera movements to update labels
-    QObject::connect(view->camera(), &Qt3DRender::QCamera::positionChanged, updateLabels);
-    QObject::connect(view->camera(), &Qt3DRender::QCamera::viewCenterChanged, updateLabels);
-
-    // Sätt upp pickers och anslut händelser för alla stjärnor
-    for (int j = 0; j < starEntities.size(); ++j) {
-        Qt3DCore::QEntity *starEntity = starEntities[j];
-        Qt3DCore::QTransform *starTransform = nullptr;
-        Qt3DExtras::QSphereMesh *starMesh = nullptr;
-
-        // Hämta komponenter
-        for (Qt3DCore::QComponent *component : starEntity->components()) {
-            if (auto mesh = qobject_cast<Qt3DExtras::QSphereMesh *>(component)) {
-                starMesh = mesh;
-            } else if (auto transform = qobject_cast<Qt3DCore::QTransform *>(component)) {
-                starTransform = transform;
-            }
-        }
+    QObject::connect(starPicker, &StarPicker::entered,
+                     [starRenderer, labelRenderer, renderScheduler](int index) {
+                         // Shows the label regardless of camera position
+                         StarCreator::hoverStar(starRenderer, index, labelRenderer);
+                         renderScheduler->requestFrame();
+                     });
 
-        //Qt3DExtras::QPhongMaterial *starMaterial = starMaterials[j];
-
-        Qt3DRender::QObjectPicker *picker = new Qt3DRender::QObjectPicker(starEntity);
-        picker->setHoverEnabled(true);
-        picker->setDragEnabled(false);
-
-        // Connect picker to camera manager and InfoBox
-        QObject::connect(picker, &Qt3DRender::QObjectPicker::clicked,
-                         [cameraManager, starTransform, bottomPanel, topPanel, starId = starIds[j]](Qt3DRender::QPickEvent *pick) {
-                             if (pick->button() == Qt3DRender::QPickEvent::LeftButton) {
-                                if(topPanel->getStarId()==starId){
-                                    cameraManager->handleStarClick(starTransform);
-                                 }
-                                 bottomPanel->setCurrentStarId(starId);
-                                 bottomPanel->updateFavoriteButtonIcon();
-                                
-                                 QVector3D position = starTransform->translation();
-                                 QSqlQuery query(QSqlDatabase::database("starsConnection"));
-
-                                 query.prepare("SELECT SP_TYPE FROM stars WHERE MAIN_ID = ?");
-                                 query.addBindValue(starId);
-                                 if (query.exec() && query.next()) {
-                                     QString spType = query.value(0).toString();
-                                     topPanel->setStarInfo(starId,
-                                                           QString::number(position.x()),
-                                                           QString::number(position.y()),
-                                                           QString::number(position.z()),
-                                                           spType);
-                                 }
-                             }
-                         });
-
-        QObject::connect(picker, &Qt3DRender::QObjectPicker::entered,
-                         [starMesh, &starEntities, &starMaterials, starMaterial = starMaterials[j], starLabel = starLabels[j], &updateLabels]() {
-                             StarCreator::hoverStar(starMesh, starEntities, starMaterials, starMaterial, starLabel);
-                             // Force show label regardless of camera position
-                             if (starLabel) {
-                                 starLabel->setEnabled(true);
-                                 // Force immediate update
-                                 QTimer::singleShot(0, updateLabels);
-                             }
-                         });
-
-        QObject::connect(picker, &Qt3DRender::QObjectPicker::exited,
-                         [starMesh, &starEntities, &starMaterials, starMaterial = starMaterials[j], starLabel = starLabels[j]]() {
-                             StarCreator::resetStar(starMesh, starEntities, starMaterials, starMaterial, starLabel);
-                         });
-
-        starEntity->addComponent(picker);
-    }
+    QObject::connect(starPicker, &StarPicker::exited,
+                     [starRenderer, labelRenderer, renderScheduler](int index) {
+                         StarCreator::resetStar(starRenderer, index, labelRenderer);
+                         renderScheduler->requestFrame();
+                     });
 
 
     view->setRootEntity(rootEntity);
+    starLoader->start(argv[0]);
 
     return app.exec();
 }
@@ -0,0 +1,157 @@
+#include "perfmonitor.h"
+#include "instancedstarrenderer.h"
+#include "starlabelrenderer.h"
+#include <Qt3DLogic/QFrameAction>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+#include <algorithm>
+
+// Longer than this between two ticks the window was idle, not slow
+static const float IDLE_GAP = 0.5f;
+
+PerfMonitor *PerfMonitor::instance()
+{
+    static PerfMonitor monitor;
+    return &monitor;
+}
+
+void PerfMonitor::attach(Qt3DCore::QEntity *rootEntity)
+{
+    m_clock.start();
+
+    Qt3DLogic::QFrameAction *frameAction = new Qt3DLogic::QFrameAction();
+    connect(frameAction, &Qt3DLogic::QFrameAction::triggered, this, &PerfMonitor::onFrame);
+    rootEntity->addComponent(frameAction);
+}
+
+void PerfMonitor::watch(const InstancedStarRenderer *starRenderer, const StarLabelRenderer *labelRenderer)
+{
+    m_labelRenderer = labelRenderer;
+
+    connect(starRenderer, &InstancedStarRenderer::cullingUpdated, this, [this](int visibleStars, int culledStars) {
+        m_visibleStars = visibleStars;
+        m_culledStars = culledStars;
+    });
+}
+
+void PerfMonitor::addTime(Section section, qint64 nanoseconds)
+{
+    m_pending[section] += nanoseconds;
+}
+
+void PerfMonitor::onFrame(float dt)
+{
+    if (dt > IDLE_GAP) {
+        // Work done while waking up still belongs to the next frame
+        return;
+    }
+
+    Frame frame;
+    frame.time = m_clock.elapsed();
+    frame.frameTime = dt * 1000.0f;
+    for (int i = 0; i < SectionCount; ++i) {
+        frame.sections[i] = m_pending[i] / 1.0e6f;
+        m_pending[i] = 0;
+    }
+    frame.visibleStars = m_visibleStars;
+    frame.culledStars = m_culledStars;
+    frame.labels = m_labelRenderer ? m_labelRenderer->visibleLabelCount() : 0;
+
+    if (m_frames.size() < HISTORY) {
+        m_frames.append(frame);
+    } else {
+        m_frames[m_next] = frame;
+    }
+    m_next = (m_next + 1) % HISTORY;
+
+    emit frameRecorded();
+}
+
+QVector<PerfMonitor::Frame> PerfMonitor::history() const
+{
+    if (m_frames.size() < HISTORY)
+        return m_frames;
+
+    // Full ring, the oldest frame is the one to be overwritten next
+    QVector<Frame> frames;
+    frames.reserve(HISTORY);
+    frames += m_frames.mid(m_next);
+    frames += m_frames.mid(0, m_next);
+    return frames;
+}
+
+const PerfMonitor::Frame &PerfMonitor::lastFrame() const
+{
+    Q_ASSERT(!m_frames.isEmpty());
+    return m_frames.at((m_next + m_frames.size() - 1) % m_frames.size());
+}
+
+float PerfMonitor::percentile(float fraction) const
+{
+    if (m_frames.isEmpty())
+        return 0.0f;
+
+    QVector<float> times;
+    times.reserve(m_frames.size());
+    for (const Frame &frame : m_frames)
+        times.append(frame.frameTime);
+
+    const int rank = qBound(0, int(fraction * (times.size() - 1) + 0.5f), times.size() - 1);
+    std::nth_element(times.begin(), times.begin() + rank, times.end());
+    return times.at(rank);
+}
+
+float PerfMonitor::fps() const
+{
+    float total = 0.0f;
+    for (const Frame &frame : m_frames)
+        total += frame.frameTime;
+    return total > 0.0f ? m_frames.size() * 1000.0f / total : 0.0f;
+}
+
+float PerfMonitor::averageTime(Section section) const
+{
+    if (m_frames.isEmpty())
+        return 0.0f;
+
+    float total = 0.0f;
+    for (const Frame &frame : m_frames)
+        total += frame.sections[section];
+    return total / m_frames.size();
+}
+
+QString PerfMonitor::sectionName(Section section)
+{
+    switch (section) {
+    case Projection: return QStringLiteral("projection");
+    case Culling:    return QStringLiteral("culling");
+    case Labels:     return QStringLiteral("labels");
+    case Camera:     return QStringLiteral("camera");
+    default:         return QString();
+    }
+}
+
+bool PerfMonitor::writeCsv(const QString &fileName) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        qWarning() << "Could not write" << fileName << file.errorString();
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "time_ms,frame_ms";
+    for (int i = 0; i < SectionCount; ++i)
+        out << ',' << sectionName(Section(i)) << "_ms";
+    out << ",visible_stars,culled_stars,labels\n";
+
+    const QVector<Frame> frames = history();
+    for (const Frame &frame : frames) {
+        out << frame.time << ',' << frame.frameTime;
+        for (int i = 0; i < SectionCount; ++i)
+            out << ',' << frame.sections[i];
+        out << ',' << frame.visibleStars << ',' << frame.culledStars << ',' << frame.labels << '\n';
+    }
+    return out.status() == QTextStream::Ok;
+}
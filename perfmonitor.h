@@ -0,0 +1,121 @@
+#ifndef PERFMONITOR_H
+#define PERFMONITOR_H
+
+#include <QObject>
+#include <QVector>
+#include <QString>
+#include <QElapsedTimer>
+#include <Qt3DCore/QEntity>
+
+class InstancedStarRenderer;
+class StarLabelRenderer;
+
+/*
+ * Rolling history of frame times and of where the time of each frame went.
+ *
+ * A frame action on the root entity closes one frame per tick: the time
+ * since the last tick, the time spent in each instrumented section
+ * since then, and the star and label counts of the watched renderers.
+ * The last HISTORY frames are kept. Gaps longer than IDLE_GAP are not
+ * frames, the window was idle with on-demand rendering, and are left out.
+ *
+ * Sections are timed with a PerfTimer at the top of the function.
+ */
+class PerfMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Section {
+        Projection,     // StarProjection::update()
+        Culling,        // InstancedStarRenderer::updateCulling()
+        Labels,         // StarLabelRenderer rebuild
+        Camera,         // Flights and first person look, AnimationEngine steps
+        SectionCount
+    };
+
+    struct Frame {
+        qint64 time;        // Milliseconds since the monitor started
+        float frameTime;    // Milliseconds since the previous frame
+        float sections[SectionCount];
+        int visibleStars;
+        int culledStars;
+        int labels;
+    };
+
+    static const int HISTORY = 600;
+
+    static PerfMonitor *instance();
+
+    // Count frames from the frame action on this entity
+    void attach(Qt3DCore::QEntity *rootEntity);
+
+    // Read the star and label counts of every frame from these
+    void watch(const InstancedStarRenderer *starRenderer, const StarLabelRenderer *labelRenderer);
+
+    void addTime(Section section, qint64 nanoseconds);
+
+    // Oldest first
+    QVector<Frame> history() const;
+    int frameCount() const { return m_frames.size(); }
+    const Frame &lastFrame() const;
+
+    // Frame time in milliseconds below which this fraction of the history lies
+    float percentile(float fraction) const;
+    float fps() const;
+
+    // Mean milliseconds per frame spent in the section over the history
+    float averageTime(Section section) const;
+
+    static QString sectionName(Section section);
+
+    // One row per frame in the history, returns false if the file couldn't be written
+    bool writeCsv(const QString &fileName) const;
+
+signals:
+    void frameRecorded();
+
+private slots:
+    void onFrame(float dt);
+
+private:
+    PerfMonitor() = default;
+
+    const StarLabelRenderer *m_labelRenderer = nullptr;
+    int m_visibleStars = 0;
+    int m_culledStars = 0;
+
+    QElapsedTimer m_clock;
+    qint64 m_pending[SectionCount] = {};
+
+    // Ring buffer, m_next is where the next frame goes
+    QVector<Frame> m_frames;
+    int m_next = 0;
+};
+
+/*
+ * Adds the time until it goes out of scope to a section of the current frame.
+ */
+class PerfTimer
+{
+public:
+    explicit PerfTimer(PerfMonitor::Section section)
+        : m_section(section)
+    {
+        m_timer.start();
+    }
+
+    ~PerfTimer()
+    {
+        PerfMonitor::instance()->addTime(m_section, m_timer.nsecsElapsed());
+    }
+
+    PerfTimer(const PerfTimer &) = delete;
+    PerfTimer &operator=(const PerfTimer &) = delete;
+
+private:
+    PerfMonitor::Section m_section;
+    QElapsedTimer m_timer;
+};
+
+#endif // PERFMONITOR_H
@@ -0,0 +1,143 @@
+#include "perfoverlay.h"
+#include "starpicker.h"
+#include <Qt3DRender/QObjectPicker>
+#include <QApplication>
+#include <QVBoxLayout>
+#include <QDateTime>
+#include <QDir>
+#include <QEvent>
+#include <QFontDatabase>
+#include <QDebug>
+
+// The text is rebuilt this often while shown
+static const int REFRESH_INTERVAL = 250;
+
+PerfOverlay::PerfOverlay(QWidget *view, Qt3DCore::QEntity *rootEntity, QWidget *parent)
+    : QWidget(parent, Qt::Tool | Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint
+                          | Qt::WindowTransparentForInput | Qt::WindowDoesNotAcceptFocus)
+    , m_view(view)
+    , m_rootEntity(rootEntity)
+    , m_text(new QLabel(this))
+    , m_reshow(false)
+{
+    setAttribute(Qt::WA_TranslucentBackground);
+    setAttribute(Qt::WA_ShowWithoutActivating);
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+
+    QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    font.setPointSize(9);
+    m_text->setFont(font);
+    m_text->setStyleSheet("background-color: rgba(0, 0, 0, 160); color: rgb(173, 216, 230); padding: 6px;");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(m_text);
+
+    // Follow the view when the main window moves or the layout resizes it
+    m_view->installEventFilter(this);
+    m_view->window()->installEventFilter(this);
+
+    m_refreshTimer.setInterval(REFRESH_INTERVAL);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &PerfOverlay::refresh);
+}
+
+void PerfOverlay::toggle()
+{
+    setVisible(!isVisible());
+}
+
+QString PerfOverlay::dumpCsv()
+{
+    const QString fileName = QDir::current().absoluteFilePath(
+        "astronav-perf-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".csv");
+
+    if (!PerfMonitor::instance()->writeCsv(fileName))
+        return QString();
+
+    qInfo() << "Wrote" << PerfMonitor::instance()->frameCount() << "frames to" << fileName;
+    return fileName;
+}
+
+bool PerfOverlay::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::Move:
+    case QEvent::Resize:
+        if (isVisible())
+            followView();
+        break;
+    case QEvent::Hide:
+        // The HUD is not hidden for good, only while the main window is
+        if (watched == m_view->window() && isVisible()) {
+            QWidget::hide();
+            m_reshow = true;
+        }
+        break;
+    case QEvent::Show:
+        if (watched == m_view->window() && m_reshow) {
+            m_reshow = false;
+            show();
+        }
+        break;
+    default:
+        break;
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void PerfOverlay::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    refresh();
+    followView();
+    m_refreshTimer.start();
+}
+
+void PerfOverlay::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    m_refreshTimer.stop();
+}
+
+void PerfOverlay::followView()
+{
+    if (m_view)
+        move(m_view->mapToGlobal(QPoint(10, 10)));
+}
+
+void PerfOverlay::refresh()
+{
+    const PerfMonitor *monitor = PerfMonitor::instance();
+
+    // Walking the object trees is too slow for every frame, it is done per refresh
+    const int sceneObjects = m_rootEntity->findChildren<QObject *>().size() + 1;
+    const int appObjects = qApp->findChildren<QObject *>().size() + 1;
+    const int entities = m_rootEntity->findChildren<Qt3DCore::QEntity *>().size() + 1;
+    const int pickers = m_rootEntity->findChildren<Qt3DRender::QObjectPicker *>().size()
+                        + qApp->findChildren<StarPicker *>().size();
+
+    QStringList lines;
+    if (monitor->frameCount() == 0) {
+        lines << "no frames yet";
+    } else {
+        const PerfMonitor::Frame &frame = monitor->lastFrame();
+        lines << QString("fps %1  (%2 frames)").arg(monitor->fps(), 0, 'f', 1).arg(monitor->frameCount());
+        lines << QString("frame p50 %1  p95 %2  p99 %3 ms")
+                     .arg(monitor->percentile(0.50f), 0, 'f', 2)
+                     .arg(monitor->percentile(0.95f), 0, 'f', 2)
+                     .arg(monitor->percentile(0.99f), 0, 'f', 2);
+        for (int i = 0; i < PerfMonitor::SectionCount; ++i) {
+            const auto section = PerfMonitor::Section(i);
+            lines << QString("%1 %2 ms").arg(PerfMonitor::sectionName(section), -11)
+                         .arg(monitor->averageTime(section), 0, 'f', 3);
+        }
+        lines << QString("stars %1 visible  %2 culled").arg(frame.visibleStars).arg(frame.culledStars);
+        lines << QString("labels %1").arg(frame.labels);
+    }
+    lines << QString("pickers %1").arg(pickers);
+    lines << QString("entities %1  objects %2").arg(entities).arg(sceneObjects + appObjects);
+    lines << "F3 hide  F4 dump csv";
+
+    m_text->setText(lines.join('\n'));
+    adjustSize();
+}
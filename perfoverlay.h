@@ -0,0 +1,51 @@
+#ifndef PERFOVERLAY_H
+#define PERFOVERLAY_H
+
+#include <QWidget>
+#include <QLabel>
+#include <QTimer>
+#include <QPointer>
+#include <Qt3DCore/QEntity>
+#include "perfmonitor.h"
+
+/*
+ * Performance HUD drawn over the top left corner of the 3D view.
+ *
+ * The 3D view is a native window, widgets can't be stacked on it, so
+ * the HUD is a frameless tool window that follows the view around and
+ * lets all input through. It shows what PerfMonitor recorded plus the
+ * object counts of the scene, refreshed a few times a second while
+ * shown.
+ */
+class PerfOverlay : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit PerfOverlay(QWidget *view, Qt3DCore::QEntity *rootEntity, QWidget *parent = nullptr);
+
+public slots:
+    void toggle();
+
+    // Write the frame history to a CSV file in the working directory, returns its name
+    QString dumpCsv();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    void refresh();
+    void followView();
+
+    QPointer<QWidget> m_view;
+    Qt3DCore::QEntity *m_rootEntity;
+    QLabel *m_text;
+
+    // Hidden along with the main window, shown again with it
+    bool m_reshow;
+    QTimer m_refreshTimer;
+};
+
+#endif // PERFOVERLAY_H
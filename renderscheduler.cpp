@@ -0,0 +1,70 @@
+#include "renderscheduler.h"
+#include <QMetaObject>
+
+RenderScheduler::RenderScheduler(Qt3DRender::QRenderSettings *renderSettings,
+                                 Qt3DCore::QEntity *rootEntity,
+                                 QObject *parent)
+    : QObject(parent)
+    , m_renderSettings(renderSettings)
+    , m_continuous(false)
+    , m_requestPending(false)
+    , m_beat(false)
+    , m_requestedFrames(0)
+{
+    // Nothing is drawn with it, changing it only marks the scene dirty
+    auto *heartbeatEntity = new Qt3DCore::QEntity(rootEntity);
+    m_heartbeat = new Qt3DCore::QTransform();
+    heartbeatEntity->addComponent(m_heartbeat);
+
+    updatePolicy();
+}
+
+void RenderScheduler::setContinuous(bool continuous)
+{
+    m_continuous = continuous;
+    updatePolicy();
+}
+
+bool RenderScheduler::isRenderingContinuously() const
+{
+    return m_continuous || !m_busy.isEmpty();
+}
+
+void RenderScheduler::requestFrame()
+{
+    if (m_requestPending || isRenderingContinuously())
+        return;
+
+    m_requestPending = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        m_requestPending = false;
+        m_beat = !m_beat;
+        m_heartbeat->setTranslation(QVector3D(m_beat ? 1.0f : 0.0f, 0.0f, 0.0f));
+        ++m_requestedFrames;
+    }, Qt::QueuedConnection);
+}
+
+void RenderScheduler::setBusy(QObject *source, bool busy)
+{
+    if (busy) {
+        if (!m_busy.contains(source)) {
+            m_busy.insert(source);
+            connect(source, &QObject::destroyed, this, [this, source]() { setBusy(source, false); });
+        }
+    } else {
+        if (!m_busy.remove(source))
+            return;
+        disconnect(source, &QObject::destroyed, this, nullptr);
+
+        // The last busy frame may not have been drawn yet
+        requestFrame();
+    }
+    updatePolicy();
+}
+
+void RenderScheduler::updatePolicy()
+{
+    m_renderSettings->setRenderPolicy(isRenderingContinuously()
+                                          ? Qt3DRender::QRenderSettings::Always
+                                          : Qt3DRender::QRenderSettings::OnDemand);
+}
@@ -0,0 +1,61 @@
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QObject>
+#include <QSet>
+#include <Qt3DCore/QEntity>
+#include <Qt3DCore/QTransform>
+#include <Qt3DRender/QRenderSettings>
+
+/*
+ * Renders frames only when something changed.
+ *
+ * The window runs with QRenderSettings::OnDemand. Qt 3D already draws a
+ * frame after any node changes, requestFrame() is for the things that
+ * need one without that, and nudges a hidden transform to get it.
+ * Requests made in the same event loop pass give one frame.
+ *
+ * Work that needs every frame for a while (flights, streaming the
+ * catalog in) marks itself busy, and the window renders continuously
+ * until no source is busy. setContinuous() forces continuous rendering,
+ * e.g. for benchmarks.
+ */
+class RenderScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RenderScheduler(Qt3DRender::QRenderSettings *renderSettings,
+                             Qt3DCore::QEntity *rootEntity,
+                             QObject *parent = nullptr);
+
+    // Always render, whatever changed
+    void setContinuous(bool continuous);
+    bool isContinuous() const { return m_continuous; }
+
+    // True while frames are drawn every vsync, forced or because a source is busy
+    bool isRenderingContinuously() const;
+
+    // Frames asked for with requestFrame(), after coalescing
+    int requestedFrames() const { return m_requestedFrames; }
+
+public slots:
+    // Mark the next frame dirty
+    void requestFrame();
+
+    // Render continuously while any source is busy
+    void setBusy(QObject *source, bool busy);
+
+private:
+    void updatePolicy();
+
+    Qt3DRender::QRenderSettings *m_renderSettings;
+    Qt3DCore::QTransform *m_heartbeat;
+    QSet<QObject *> m_busy;
+    bool m_continuous;
+    bool m_requestPending;
+    bool m_beat;
+    int m_requestedFrames;
+};
+
+#endif // RENDERSCHEDULER_H
@@ -0,0 +1,271 @@
+/*
+ * Headless benchmark of building and navigating the star scene.
+ *
+ * Runs on the offscreen platform with software OpenGL, so no GPU or
+ * display is needed. For every catalog size a synthetic stars table is
+ * written to a temporary database, and the scene build, the label and
+ * projection work per camera move, pick latency, a reload from the
+ * database and from the star cache, and the peak RSS are measured.
+ * The results are written as JSON, to stdout or to --output.
+ */
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QThreadPool>
+#include <Qt3DExtras/Qt3DWindow>
+#include <Qt3DRender/QCamera>
+#include <QtMath>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include "starcreator.h"
+#include "starcatalog.h"
+#include "instancedstarrenderer.h"
+#include "starprojection.h"
+#include "starlabelrenderer.h"
+#include "starpicker.h"
+#include "starloader.h"
+#include "perfmonitor.h"
+#include "benchmarkcatalog.h"
+
+// Longest wait for one frame before the renderer is taken to be stuck
+static const int FRAME_TIMEOUT = 5000;
+
+// Longest wait for a reload
+static const int RELOAD_TIMEOUT = 600000;
+
+/*
+Function to wait for the next frame recorded by PerfMonitor
+
+Input:
+- none
+
+Output:
+- bool, false if no frame came within FRAME_TIMEOUT
+*/
+bool waitForFrame() {
+    QEventLoop loop;
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    QObject::connect(&timeout, &QTimer::timeout, &loop, [&loop]() { loop.exit(1); });
+    QObject::connect(PerfMonitor::instance(), &PerfMonitor::frameRecorded, &loop, [&loop]() { loop.exit(0); });
+    timeout.start(FRAME_TIMEOUT);
+    return loop.exec() == 0;
+}
+
+/*
+Function to run the benchmark for one catalog size
+
+Input:
+- int with the number of stars
+- int with the number of camera moves
+- int with the number of picks
+
+Output:
+- QJsonObject with the results for this size
+*/
+QJsonObject runSize(int stars, int moves, int picks) {
+    QJsonObject result;
+    result["stars"] = stars;
+
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<StarRecord> catalog = generateCatalog(stars, 1234u + quint32(stars));
+    result["generate_ms"] = double(timer.nsecsElapsed()) / 1.0e6;
+
+    // getDatabasePath() takes an executable path two levels below the database
+    QTemporaryDir directory;
+    const QString databaseFile = directory.filePath("local_stars.db");
+    const QString executablePath = directory.filePath("bin/SimpleShape");
+    if (!writeDatabase(databaseFile, catalog)) {
+        result["error"] = "could not write the database";
+        return result;
+    }
+
+    Qt3DExtras::Qt3DWindow *view = new Qt3DExtras::Qt3DWindow();
+    view->resize(1280, 720);
+    Qt3DCore::QEntity *rootEntity = new Qt3DCore::QEntity();
+
+    Qt3DRender::QCamera *camera = view->camera();
+    camera->lens()->setPerspectiveProjection(45.0f, 16.0f / 9.0f, 0.1f, 1000.0f);
+    camera->setPosition(QVector3D(0, 10, 10));
+    camera->setViewCenter(QVector3D(0, 0, 0));
+
+    // Same setup as the application
+    InstancedStarRenderer *starRenderer = new InstancedStarRenderer(rootEntity);
+    starRenderer->setNearDistance(40.0f);
+    starRenderer->setCamera(camera);
+    StarProjection *projection = new StarProjection(rootEntity, camera, starRenderer);
+    StarLabelRenderer *labelRenderer = new StarLabelRenderer(starRenderer, rootEntity);
+    labelRenderer->setCamera(camera);
+    labelRenderer->setProjection(projection);
+    labelRenderer->setLabelRadius(starRenderer->nearDistance());
+    StarPicker *starPicker = new StarPicker(view, starRenderer);
+    PerfMonitor::instance()->attach(rootEntity);
+    PerfMonitor::instance()->watch(starRenderer, labelRenderer);
+
+    // Scene build, the part of a load that runs on the GUI thread
+    StarCatalog sceneCatalog;
+    timer.restart();
+    starRenderer->reserve(stars);
+    for (const StarRecord &star : catalog) {
+        sceneCatalog.append(star);
+        StarCreator::createStar(starRenderer, star);
+    }
+    const double createMs = double(timer.nsecsElapsed()) / 1.0e6;
+    starRenderer->commit();
+    labelRenderer->setLabelTexts(sceneCatalog.ids());
+    result["create_star_ms"] = createMs;
+    result["build_ms"] = double(timer.nsecsElapsed()) / 1.0e6;
+
+    view->setRootEntity(rootEntity);
+    view->show();
+
+    // The first frames upload the buffers, they are not part of a move
+    bool rendering = true;
+    for (int i = 0; i < 10 && rendering; ++i)
+        rendering = waitForFrame();
+    result["rendering"] = rendering;
+
+    // Orbit the camera through the catalog, one frame per move
+    QVector<double> frameTimes, labelTimes, projectionTimes, cullingTimes, labelCounts;
+    const float orbit = catalogRadius(stars);
+    for (int i = 0; i < moves && rendering; ++i) {
+        const float angle = qDegreesToRadians(360.0f * i / moves);
+        camera->setPosition(QVector3D(std::cos(angle) * orbit, 0.3f * orbit, std::sin(angle) * orbit));
+        camera->setViewCenter(QVector3D(0, 0, 0));
+
+        if (!(rendering = waitForFrame()))
+            break;
+
+        const PerfMonitor::Frame &frame = PerfMonitor::instance()->lastFrame();
+        frameTimes.append(frame.frameTime);
+        labelTimes.append(frame.sections[PerfMonitor::Labels]);
+        projectionTimes.append(frame.sections[PerfMonitor::Projection]);
+        cullingTimes.append(frame.sections[PerfMonitor::Culling]);
+        labelCounts.append(frame.labels);
+    }
+    result["frame_ms"] = summarize(frameTimes);
+    result["labels_ms"] = summarize(labelTimes);
+    result["projection_ms"] = summarize(projectionTimes);
+    result["culling_ms"] = summarize(cullingTimes);
+    result["labels_shown"] = summarize(labelCounts);
+
+    // Pick latency over random window positions
+    std::mt19937 random(99);
+    std::uniform_real_distribution<float> x(0.0f, view->width());
+    std::uniform_real_distribution<float> y(0.0f, view->height());
+    QVector<double> pickTimes;
+    int hits = 0;
+    for (int i = 0; i < picks; ++i) {
+        const QPointF position(x(random), y(random));
+        timer.restart();
+        const int star = starPicker->pickStar(position);
+        pickTimes.append(double(timer.nsecsElapsed()) / 1.0e3);
+        if (star >= 0)
+            ++hits;
+    }
+    result["pick_us"] = summarize(pickTimes);
+    result["pick_hits"] = hits;
+
+    // reloadStars: from the database first, that writes the cache the second one maps
+    StarCatalog loaderCatalog;
+    StarLoader *starLoader = new StarLoader(rootEntity, &loaderCatalog, starRenderer, labelRenderer);
+    starLoader->setFrameBudget(16);
+    QJsonObject reload;
+    for (const char *source : { "database", "cache" }) {
+        const bool cachePass = std::strcmp(source, "cache") == 0;
+        if (cachePass) {
+            // The database pass writes the cache on a worker thread, it has to be on disk first
+            QThreadPool::globalInstance()->waitForDone();
+            QCoreApplication::processEvents();
+        }
+
+        QEventLoop loop;
+        QTimer timeout;
+        timeout.setSingleShot(true);
+        QObject::connect(&timeout, &QTimer::timeout, &loop, [&loop]() { loop.exit(1); });
+        QObject::connect(starLoader, &StarLoader::finished, &loop, [&loop](bool ok) { loop.exit(ok ? 0 : 2); });
+        timeout.start(RELOAD_TIMEOUT);
+
+        timer.restart();
+        starLoader->start(executablePath);
+
+        // A reload from the cache finishes inside start(), a miss reads the database and doesn't count
+        bool ok = !starLoader->isLoading() || loop.exec() == 0;
+        if (cachePass && !starLoader->fromCache()) {
+            qWarning() << "The cache pass read the database, no cache was written";
+            ok = false;
+        }
+        reload[QString::fromLatin1(source) + "_ms"] = ok ? QJsonValue(double(timer.nsecsElapsed()) / 1.0e6)
+                                                         : QJsonValue(QJsonValue::Null);
+    }
+    result["reload"] = reload;
+    result["peak_rss_kb"] = peakRssKilobytes();
+
+    // No cache write may outlive the temporary directory
+    QThreadPool::globalInstance()->waitForDone();
+    QCoreApplication::processEvents();
+
+    delete starLoader;
+    delete starPicker;
+    delete projection;
+    view->close();
+    view->setRootEntity(nullptr);
+    delete rootEntity;
+    delete view;
+
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    // No display or GPU needed
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    if (!qEnvironmentVariableIsSet("QT3D_RENDERER")) {
+        qputenv("QT3D_RENDERER", "opengl");
+    }
+    if (!qEnvironmentVariableIsSet("LIBGL_ALWAYS_SOFTWARE")) {
+        qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+    }
+    QApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma separated catalog sizes.", "list", "1000,10000,100000,1000000");
+    QCommandLineOption movesOption("moves", "Camera moves per size.", "count", "120");
+    QCommandLineOption picksOption("picks", "Picks per size.", "count", "1000");
+    QCommandLineOption outputOption("output", "Write the JSON here instead of stdout.", "file");
+    parser.addOption(sizesOption);
+    parser.addOption(movesOption);
+    parser.addOption(picksOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    QJsonArray results;
+    const QStringList sizes = parser.value(sizesOption).split(',', Qt::SkipEmptyParts);
+    for (const QString &size : sizes) {
+        const int stars = size.trimmed().toInt();
+        if (stars <= 0)
+            continue;
+
+        qInfo() << "benchmarking" << stars << "stars";
+        results.append(runSize(stars, parser.value(movesOption).toInt(), parser.value(picksOption).toInt()));
+    }
+
+    QJsonObject report;
+    report["benchmark"] = "scene";
+    report["qt_version"] = QString::fromLatin1(qVersion());
+    report["platform"] = QGuiApplication::platformName();
+    report["results"] = results;
+    return writeReport(report, parser.value(outputOption)) ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#include "shadermaterial.h"
+#include <Qt3DRender/QEffect>
+#include <Qt3DRender/QTechnique>
+#include <Qt3DRender/QRenderPass>
+#include <Qt3DRender/QShaderProgram>
+#include <Qt3DRender/QFilterKey>
+#include <Qt3DRender/QGraphicsApiFilter>
+#include <QUrl>
+
+Qt3DRender::QMaterial *createShaderMaterial(const QString &vertexShader,
+                                            const QString &fragmentShader,
+                                            const QList<Qt3DRender::QRenderState *> &renderStates,
+                                            Qt3DCore::QNode *parent)
+{
+    auto *material = new Qt3DRender::QMaterial(parent);
+    auto *effect = new Qt3DRender::QEffect(material);
+    auto *technique = new Qt3DRender::QTechnique(effect);
+
+    technique->graphicsApiFilter()->setApi(Qt3DRender::QGraphicsApiFilter::OpenGL);
+    technique->graphicsApiFilter()->setProfile(Qt3DRender::QGraphicsApiFilter::CoreProfile);
+    technique->graphicsApiFilter()->setMajorVersion(3);
+    technique->graphicsApiFilter()->setMinorVersion(2);
+
+    // QForwardRenderer only draws techniques tagged with this key
+    auto *filterKey = new Qt3DRender::QFilterKey(technique);
+    filterKey->setName(QStringLiteral("renderingStyle"));
+    filterKey->setValue(QStringLiteral("forward"));
+    technique->addFilterKey(filterKey);
+
+    auto *shader = new Qt3DRender::QShaderProgram(technique);
+    shader->setVertexShaderCode(Qt3DRender::QShaderProgram::loadSource(QUrl(vertexShader)));
+    shader->setFragmentShaderCode(Qt3DRender::QShaderProgram::loadSource(QUrl(fragmentShader)));
+
+    auto *pass = new Qt3DRender::QRenderPass(technique);
+    pass->setShaderProgram(shader);
+    for (Qt3DRender::QRenderState *state : renderStates) {
+        pass->addRenderState(state);
+    }
+    technique->addRenderPass(pass);
+
+    effect->addTechnique(technique);
+    material->setEffect(effect);
+    return material;
+}
@@ -0,0 +1,28 @@
+#ifndef SHADERMATERIAL_H
+#define SHADERMATERIAL_H
+
+#include <QString>
+#include <QList>
+#include <Qt3DCore/QNode>
+#include <Qt3DRender/QMaterial>
+#include <Qt3DRender/QRenderState>
+
+/*
+Function to create a material running custom GLSL 1.50 shaders in the
+forward pass of the default frame graph
+
+Input:
+- QString with the qrc url of the vertex shader
+- QString with the qrc url of the fragment shader
+- QList with render states for the pass (blending, point size, ...)
+- QNode pointer (parent)
+
+Output:
+- Qt3DRender::QMaterial pointer
+*/
+Qt3DRender::QMaterial *createShaderMaterial(const QString &vertexShader,
+                                            const QString &fragmentShader,
+                                            const QList<Qt3DRender::QRenderState *> &renderStates = {},
+                                            Qt3DCore::QNode *parent = nullptr);
+
+#endif // SHADERMATERIAL_H
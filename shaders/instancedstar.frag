@@ -0,0 +1,46 @@
+#version 150 core
+
+// Same light uniforms as the Qt 3D built-in materials
+const int MAX_LIGHTS = 8;
+const int TYPE_POINT = 0;
+
+struct Light {
+    int type;
+    vec3 position;
+    vec3 color;
+    float intensity;
+    vec3 direction;
+    float constantAttenuation;
+    float linearAttenuation;
+    float quadraticAttenuation;
+    float cutOffAngle;
+};
+uniform Light lights[MAX_LIGHTS];
+uniform int lightCount;
+
+in vec3 worldPosition;
+in vec3 worldNormal;
+in vec3 starColor;
+
+out vec4 fragColor;
+
+void main()
+{
+    vec3 n = normalize(worldNormal);
+    vec3 diffuse = vec3(0.0);
+
+    for (int i = 0; i < lightCount; ++i) {
+        if (lights[i].type != TYPE_POINT)
+            continue;
+
+        vec3 s = lights[i].position - worldPosition;
+        float d = max(length(s), 0.0001);
+        float attenuation = 1.0 / (lights[i].constantAttenuation
+                                   + lights[i].linearAttenuation * d
+                                   + lights[i].quadraticAttenuation * d * d);
+        diffuse += lights[i].color * lights[i].intensity * attenuation * max(dot(n, s / d), 0.0);
+    }
+
+    // Ambient and diffuse both use the spectral colour, like the old QPhongMaterial
+    fragColor = vec4(clamp(starColor + starColor * diffuse, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,26 @@
+#version 150 core
+
+in vec3 vertexPosition;
+in vec3 vertexNormal;
+
+// xyz = star position in scene units, w = star radius
+in vec4 instancePosition;
+// rgb = spectral colour, a = highlight scale
+in vec4 instanceColor;
+
+out vec3 worldPosition;
+out vec3 worldNormal;
+out vec3 starColor;
+
+uniform mat4 viewProjectionMatrix;
+
+void main()
+{
+    float radius = instancePosition.w * instanceColor.a;
+
+    worldNormal = vertexNormal;
+    worldPosition = instancePosition.xyz + vertexPosition * radius;
+    starColor = instanceColor.rgb;
+
+    gl_Position = viewProjectionMatrix * vec4(worldPosition, 1.0);
+}
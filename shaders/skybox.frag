@@ -0,0 +1,12 @@
+#version 150 core
+
+in vec3 texCoord;
+
+out vec4 fragColor;
+
+uniform samplerCube skyboxTexture;
+
+void main()
+{
+    fragColor = texture(skyboxTexture, texCoord);
+}
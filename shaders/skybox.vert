@@ -0,0 +1,15 @@
+#version 150 core
+
+in vec3 vertexPosition;
+
+out vec3 texCoord;
+
+uniform mat4 modelViewProjection;
+
+void main()
+{
+    texCoord = vertexPosition;
+
+    // z = w puts every vertex on the far plane
+    gl_Position = (modelViewProjection * vec4(vertexPosition, 1.0)).xyww;
+}
@@ -0,0 +1,12 @@
+#version 150 core
+
+uniform sampler2D glowTexture;
+
+in vec2 texCoord;
+
+out vec4 fragColor;
+
+void main()
+{
+    fragColor = texture(glowTexture, texCoord);
+}
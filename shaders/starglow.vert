@@ -0,0 +1,29 @@
+#version 150 core
+
+// Quad corner in [-1, 1]
+in vec2 vertexPosition;
+// xyz = star position in scene units, w = star radius
+in vec4 instancePosition;
+
+out vec2 texCoord;
+
+uniform mat4 viewMatrix;
+uniform mat4 viewProjectionMatrix;
+uniform vec3 eyePosition;
+
+void main()
+{
+    vec3 center = instancePosition.xyz;
+
+    // Twice the star radius, scaled with the distance to the camera
+    float distanceScale = clamp(distance(eyePosition, center) * 0.1, 0.5, 3.0);
+    float halfSize = instancePosition.w * distanceScale;
+
+    // Camera right and up vectors are the first two rows of the view matrix
+    vec3 right = vec3(viewMatrix[0][0], viewMatrix[1][0], viewMatrix[2][0]);
+    vec3 up = vec3(viewMatrix[0][1], viewMatrix[1][1], viewMatrix[2][1]);
+    vec3 worldPosition = center + (right * vertexPosition.x + up * vertexPosition.y) * halfSize;
+
+    texCoord = vertexPosition * 0.5 + 0.5;
+    gl_Position = viewProjectionMatrix * vec4(worldPosition, 1.0);
+}
@@ -0,0 +1,56 @@
+#version 150 core
+
+// Same light uniforms as the Qt 3D built-in materials
+const int MAX_LIGHTS = 8;
+const int TYPE_POINT = 0;
+
+struct Light {
+    int type;
+    vec3 position;
+    vec3 color;
+    float intensity;
+    vec3 direction;
+    float constantAttenuation;
+    float linearAttenuation;
+    float quadraticAttenuation;
+    float cutOffAngle;
+};
+uniform Light lights[MAX_LIGHTS];
+uniform int lightCount;
+
+uniform mat4 inverseViewMatrix;
+
+in vec3 starCenter;
+in float starRadius;
+in vec3 color;
+
+out vec4 fragColor;
+
+void main()
+{
+    // Ray-cast the sphere inside the point sprite
+    vec2 p = gl_PointCoord * 2.0 - 1.0;
+    p.y = -p.y;
+    float r2 = dot(p, p);
+    if (r2 > 1.0)
+        discard;
+
+    vec3 viewNormal = vec3(p, sqrt(1.0 - r2));
+    vec3 n = normalize(mat3(inverseViewMatrix) * viewNormal);
+    vec3 worldPosition = starCenter + n * starRadius;
+
+    vec3 diffuse = vec3(0.0);
+    for (int i = 0; i < lightCount; ++i) {
+        if (lights[i].type != TYPE_POINT)
+            continue;
+
+        vec3 s = lights[i].position - worldPosition;
+        float d = max(length(s), 0.0001);
+        float attenuation = 1.0 / (lights[i].constantAttenuation
+                                   + lights[i].linearAttenuation * d
+                                   + lights[i].quadraticAttenuation * d * d);
+        diffuse += lights[i].color * lights[i].intensity * attenuation * max(dot(n, s / d), 0.0);
+    }
+
+    fragColor = vec4(clamp(color + color * diffuse, 0.0, 1.0), 1.0);
+}
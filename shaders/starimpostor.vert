@@ -0,0 +1,39 @@
+#version 150 core
+
+// xyz = star position in scene units, w = star radius
+in vec4 starPosition;
+// rgb = spectral colour, a = highlight scale
+in vec4 starColor;
+
+out vec3 starCenter;
+out float starRadius;
+out vec3 color;
+
+uniform mat4 viewProjectionMatrix;
+uniform mat4 projectionMatrix;
+uniform mat4 viewportMatrix;
+uniform vec3 eyePosition;
+
+// Stars closer than this are drawn as real spheres instead
+uniform float nearDistance;
+
+void main()
+{
+    vec3 toStar = starPosition.xyz - eyePosition;
+    if (dot(toStar, toStar) < nearDistance * nearDistance) {
+        // Outside the clip volume, the sphere batch draws this star
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        gl_PointSize = 0.0;
+        return;
+    }
+
+    starCenter = starPosition.xyz;
+    starRadius = starPosition.w * starColor.a;
+    color = starColor.rgb;
+
+    gl_Position = viewProjectionMatrix * vec4(starCenter, 1.0);
+
+    // Projected radius in pixels, never smaller than a couple of pixels
+    float pixelRadius = starRadius * projectionMatrix[1][1] * viewportMatrix[1][1] / gl_Position.w;
+    gl_PointSize = max(2.0 * pixelRadius, 2.0);
+}
@@ -0,0 +1,14 @@
+#version 150 core
+
+uniform sampler2D glyphAtlas;
+uniform vec4 labelColor;
+
+in vec2 texCoord;
+
+out vec4 fragColor;
+
+void main()
+{
+    // The atlas is white text, only its coverage is used
+    fragColor = vec4(labelColor.rgb, labelColor.a * texture(glyphAtlas, texCoord).a);
+}
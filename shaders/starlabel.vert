@@ -0,0 +1,27 @@
+#version 150 core
+
+// Label origin in scene units, shared by all glyph vertices of a label
+in vec3 labelAnchor;
+// Glyph corner relative to the label origin, in scene units at scale 1
+in vec2 glyphOffset;
+in vec2 glyphTexCoord;
+
+out vec2 texCoord;
+
+uniform mat4 viewMatrix;
+uniform mat4 viewProjectionMatrix;
+uniform vec3 eyePosition;
+
+void main()
+{
+    // Grows with the distance so the text keeps about the same size on screen
+    float scale = clamp(0.003 * distance(eyePosition, labelAnchor), 0.1, 1.0);
+
+    // Camera right and up vectors are the first two rows of the view matrix
+    vec3 right = vec3(viewMatrix[0][0], viewMatrix[1][0], viewMatrix[2][0]);
+    vec3 up = vec3(viewMatrix[0][1], viewMatrix[1][1], viewMatrix[2][1]);
+    vec3 worldPosition = labelAnchor + (right * glyphOffset.x + up * glyphOffset.y) * scale;
+
+    texCoord = glyphTexCoord;
+    gl_Position = viewProjectionMatrix * vec4(worldPosition, 1.0);
+}
@@ -0,0 +1,36 @@
+#include "skyboxentity.h"
+#include "shadermaterial.h"
+#include "textureloader.h"
+#include <Qt3DExtras/QCuboidMesh>
+#include <Qt3DRender/QMaterial>
+#include <Qt3DRender/QParameter>
+#include <Qt3DRender/QCullFace>
+#include <Qt3DRender/QDepthTest>
+#include <Qt3DRender/QSeamlessCubemap>
+
+SkyboxEntity::SkyboxEntity(const QString &baseName,
+                           const QString &extension,
+                           Qt3DCore::QNode *parent)
+    : Qt3DCore::QEntity(parent)
+    , m_texture(TextureCache::instance()->cubeMap(baseName, extension))
+{
+    // The camera is inside the cube, and the sky is drawn at the far plane
+    auto *cullFace = new Qt3DRender::QCullFace();
+    cullFace->setMode(Qt3DRender::QCullFace::Front);
+    auto *depthTest = new Qt3DRender::QDepthTest();
+    depthTest->setDepthFunction(Qt3DRender::QDepthTest::LessOrEqual);
+
+    Qt3DRender::QMaterial *material = createShaderMaterial(QStringLiteral("qrc:/shaders/skybox.vert"),
+                                                           QStringLiteral("qrc:/shaders/skybox.frag"),
+                                                           { cullFace, depthTest, new Qt3DRender::QSeamlessCubemap() },
+                                                           this);
+    material->addParameter(new Qt3DRender::QParameter(QStringLiteral("skyboxTexture"), m_texture));
+
+    auto *mesh = new Qt3DExtras::QCuboidMesh();
+    mesh->setXExtent(2.0f);
+    mesh->setYExtent(2.0f);
+    mesh->setZExtent(2.0f);
+
+    addComponent(mesh);
+    addComponent(material);
+}
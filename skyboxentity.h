@@ -0,0 +1,31 @@
+#ifndef SKYBOXENTITY_H
+#define SKYBOXENTITY_H
+
+#include <QString>
+#include <Qt3DCore/QEntity>
+#include <Qt3DRender/QAbstractTexture>
+
+/*
+ * Skybox drawn from a cube map texture.
+ *
+ * Works like QSkyboxEntity, but takes the texture from loadCubeMap(), so
+ * the sky can come from a pre-compressed cube map with mipmaps, or from
+ * face images decoded off the GUI thread.
+ */
+class SkyboxEntity : public Qt3DCore::QEntity
+{
+    Q_OBJECT
+
+public:
+    // Faces are <baseName>_posx<extension> ... or one <baseName>.ktx/.dds
+    explicit SkyboxEntity(const QString &baseName,
+                          const QString &extension,
+                          Qt3DCore::QNode *parent = nullptr);
+
+    Qt3DRender::QAbstractTexture *texture() const { return m_texture; }
+
+private:
+    Qt3DRender::QAbstractTexture *m_texture;
+};
+
+#endif // SKYBOXENTITY_H
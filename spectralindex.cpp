@@ -0,0 +1,62 @@
+#include "spectralindex.h"
+
+void SpectralIndex::append(SpectralType type)
+{
+    const int row = m_count++;
+    if (type.spectralClass < SpectralType::ClassCount)
+        m_classes[type.spectralClass].set(row);
+    if (type.luminosity < SpectralType::LuminosityCount)
+        m_luminosities[type.luminosity].set(row);
+}
+
+void SpectralIndex::update(int row, SpectralType oldType, SpectralType newType)
+{
+    if (row < 0 || row >= m_count)
+        return;
+
+    if (oldType.spectralClass < SpectralType::ClassCount)
+        m_classes[oldType.spectralClass].reset(row);
+    if (oldType.luminosity < SpectralType::LuminosityCount)
+        m_luminosities[oldType.luminosity].reset(row);
+
+    if (newType.spectralClass < SpectralType::ClassCount)
+        m_classes[newType.spectralClass].set(row);
+    if (newType.luminosity < SpectralType::LuminosityCount)
+        m_luminosities[newType.luminosity].set(row);
+}
+
+void SpectralIndex::clear()
+{
+    for (StarBitmap &bitmap : m_classes)
+        bitmap = StarBitmap();
+    for (StarBitmap &bitmap : m_luminosities)
+        bitmap = StarBitmap();
+    m_count = 0;
+}
+
+StarBitmap SpectralIndex::match(const QVector<SpectralType::Class> &classes,
+                                const QVector<SpectralType::Luminosity> &luminosities) const
+{
+    // Utan villkor matchar alla rader
+    StarBitmap result = ~StarBitmap(m_count);
+
+    if (!classes.isEmpty()) {
+        StarBitmap anyClass(m_count);
+        for (SpectralType::Class spectralClass : classes) {
+            if (spectralClass < SpectralType::ClassCount)
+                anyClass |= m_classes[spectralClass];
+        }
+        result &= anyClass;
+    }
+
+    if (!luminosities.isEmpty()) {
+        StarBitmap anyLuminosity(m_count);
+        for (SpectralType::Luminosity luminosity : luminosities) {
+            if (luminosity < SpectralType::LuminosityCount)
+                anyLuminosity |= m_luminosities[luminosity];
+        }
+        result &= anyLuminosity;
+    }
+
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef SPECTRALINDEX_H
+#define SPECTRALINDEX_H
+
+#include <QVector>
+#include "spectraltype.h"
+#include "starbitmap.h"
+
+/*
+ * One bitmap per spectral class and one per luminosity class over the
+ * catalog rows, kept up to date by StarCatalog.
+ *
+ * A filter such as "K giants" is the AND of two bitmaps and "O and B
+ * main sequence" is (O | B) & V, so a type search over a million stars
+ * is a few thousand word operations instead of a scan over the
+ * SP_TYPE strings.
+ *
+ * Part of astronav_core.
+ */
+class SpectralIndex
+{
+public:
+    // Index the next row
+    void append(SpectralType type);
+
+    // A row's type changed
+    void update(int row, SpectralType oldType, SpectralType newType);
+
+    void clear();
+
+    int count() const { return m_count; }
+
+    // Rows of any of the classes that also have any of the luminosity
+    // classes. An empty list places no restriction.
+    StarBitmap match(const QVector<SpectralType::Class> &classes,
+                     const QVector<SpectralType::Luminosity> &luminosities) const;
+
+private:
+    StarBitmap m_classes[SpectralType::ClassCount];
+    StarBitmap m_luminosities[SpectralType::LuminosityCount];
+    int m_count = 0;
+};
+
+#endif // SPECTRALINDEX_H
@@ -0,0 +1,71 @@
+#include "spectraltype.h"
+
+// Längre SP_TYPE finns inte i SIMBAD, resten är ändå kommentarer
+static const int MAX_SP_TYPE_LENGTH = 64;
+
+SpectralType SpectralType::parse(const QString &spType)
+{
+    // SP_TYPE is ASCII, anything else is read as a blank and skipped
+    char text[MAX_SP_TYPE_LENGTH];
+    const int length = qMin(int(spType.size()), MAX_SP_TYPE_LENGTH);
+    const QChar *chars = spType.constData();
+    for (int i = 0; i < length; ++i) {
+        const char16_t c = chars[i].unicode();
+        text[i] = c < 0x80 ? char(c) : ' ';
+    }
+    return parse(text, length);
+}
+
+// Kontroll av parsern vid kompilering
+static_assert(SpectralType::parse("G2V").spectralClass == SpectralType::G, "class letter");
+static_assert(SpectralType::parse("G2V").subclass == 20, "subclass in tenths");
+static_assert(SpectralType::parse("G2V").luminosity == SpectralType::Dwarf, "main sequence");
+static_assert(SpectralType::parse("O9.5V").subclass == 95, "decimal subclass");
+static_assert(SpectralType::parse("K1III").luminosity == SpectralType::Giant, "giant");
+static_assert(SpectralType::parse("K3II").luminosity == SpectralType::BrightGiant, "bright giant");
+static_assert(SpectralType::parse("M1Iab").luminosity == SpectralType::Supergiant, "supergiant");
+static_assert(SpectralType::parse("B8Ia+").luminosity == SpectralType::Hypergiant, "hypergiant");
+
+// IV och V innehåller I, de var förut superjättar
+static_assert(SpectralType::parse("F5IV").luminosity == SpectralType::Subgiant, "subgiant is not a supergiant");
+static_assert(SpectralType::parse("A0V").radius() == 1.8f, "dwarf keeps the class radius");
+static_assert(SpectralType::parse("G8IV-V").luminosity == SpectralType::Subgiant, "luminosity range");
+static_assert(SpectralType::parse("G8/K0III").spectralClass == SpectralType::G, "class range");
+static_assert(SpectralType::parse("G8/K0III").luminosity == SpectralType::Giant, "luminosity after a class range");
+static_assert(SpectralType::parse("K0/1III").subclass == 0, "subclass range keeps the first");
+static_assert(SpectralType::parse("K0/1III").luminosity == SpectralType::Giant, "luminosity after a subclass range");
+static_assert(SpectralType::parse("K0/1III").flags == 0, "subclass range is not an abundance note");
+static_assert(SpectralType::parse("G8-9V").luminosity == SpectralType::Dwarf, "luminosity after a subclass range");
+
+static_assert(SpectralType::parse("sdB5").spectralClass == SpectralType::B, "subdwarf prefix");
+static_assert(SpectralType::parse("sdB5").luminosity == SpectralType::Subdwarf, "subdwarf prefix");
+static_assert(SpectralType::parse("dM4.5").spectralClass == SpectralType::M, "Mount Wilson dwarf prefix");
+static_assert(SpectralType::parse("dM4.5").subclass == 45, "Mount Wilson dwarf prefix");
+static_assert(SpectralType::parse("dM4.5").luminosity == SpectralType::Dwarf, "Mount Wilson dwarf prefix");
+static_assert(SpectralType::parse("dMe").spectralClass == SpectralType::M, "Mount Wilson dwarf without subclass");
+static_assert(SpectralType::parse("dMe").luminosity == SpectralType::Dwarf, "Mount Wilson dwarf without subclass");
+static_assert(SpectralType::parse("dMe").flags == SpectralType::Emission, "Mount Wilson dwarf without subclass");
+static_assert(SpectralType::parse("DA2").luminosity == SpectralType::WhiteDwarf, "white dwarf");
+static_assert(SpectralType::parse("DA2").spectralClass == SpectralType::UnknownClass, "DA is not class A");
+static_assert(SpectralType::parse("kA2hA5mA7V").subclass == 50, "Am star uses the hydrogen type");
+static_assert(SpectralType::parse("kA2hA5mA7V").luminosity == SpectralType::Dwarf, "luminosity after the metal type");
+static_assert(SpectralType::parse("WC8").spectralClass == SpectralType::WolfRayet, "Wolf-Rayet");
+
+static_assert(SpectralType::parse("B2IVne").flags == (SpectralType::Nebulous | SpectralType::Emission), "flags");
+static_assert(SpectralType::parse("K0IIIFe-1").flags == SpectralType::Peculiar, "abundance note is not emission");
+static_assert(SpectralType::parse("G8III+A2V").luminosity == SpectralType::Giant, "companion ignored");
+static_assert(SpectralType::parse("G8III+A2V").hasFlag(SpectralType::Composite), "composite");
+static_assert(SpectralType::parse("K1(III)").luminosity == SpectralType::Giant, "luminosity in parentheses");
+static_assert(SpectralType::parse("K1(III)").flags == 0, "parentheses are not an abundance note");
+static_assert(SpectralType::parse("K2(V)").luminosity == SpectralType::Dwarf, "luminosity in parentheses");
+static_assert(SpectralType::parse("G8+V").luminosity == SpectralType::Dwarf, "subclass suffix");
+static_assert(SpectralType::parse("G8+V").flags == 0, "subclass suffix is not a companion");
+static_assert(SpectralType::parse("K4+Vk:").luminosity == SpectralType::Dwarf, "subclass suffix");
+static_assert(SpectralType::parse("K4+Vk:").flags == SpectralType::Uncertain, "subclass suffix is not a companion");
+static_assert(SpectralType::parse("F2:V:").subclass == 20, "uncertain subclass");
+static_assert(SpectralType::parse("F2:V:").luminosity == SpectralType::Dwarf, "luminosity after an uncertain subclass");
+static_assert(SpectralType::parse("F2:V:").flags == SpectralType::Uncertain, "uncertain subclass");
+static_assert(SpectralType::parse("").code() == SpectralType().code(), "empty type");
+
+static_assert(SpectralType::fromCode(SpectralType::parse("B2IVne").code()) == SpectralType::parse("B2IVne"), "code round trip");
+static_assert(sizeof(SpectralType) == 4, "packed in four bytes");
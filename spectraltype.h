@@ -0,0 +1,379 @@
+#ifndef SPECTRALTYPE_H
+#define SPECTRALTYPE_H
+
+#include <QString>
+#include <QColor>
+#include <QRgb>
+
+/*
+ * A star's SP_TYPE parsed once into four bytes: class, subclass,
+ * luminosity class and peculiarity flags. "K1IIIe" is class K,
+ * subclass 1, a giant with emission lines.
+ *
+ * Radius and colour come from constexpr tables indexed by the class and
+ * the luminosity class, so nothing after the loader looks at the string
+ * again. The parser is constexpr too, spectraltype.cpp checks it on
+ * known types at compile time.
+ *
+ * Part of astronav_core.
+ */
+struct SpectralType
+{
+    enum Class : quint8 {
+        UnknownClass,
+        O, B, A, F, G, K, M,
+        WolfRayet,      // WN, WC
+        L, T, Y,        // Brown dwarfs
+        Carbon,         // C, R, N
+        S,
+        ClassCount
+    };
+
+    enum Luminosity : quint8 {
+        UnknownLuminosity,
+        Hypergiant,     // 0, Ia+
+        Supergiant,     // I, Ia, Iab, Ib
+        BrightGiant,    // II
+        Giant,          // III
+        Subgiant,       // IV
+        Dwarf,          // V, main sequence
+        Subdwarf,       // VI, sd prefix
+        WhiteDwarf,     // VII, D prefix
+        LuminosityCount
+    };
+
+    enum Flag : quint8 {
+        Emission = 0x01,    // e
+        Metallic = 0x02,    // m
+        Nebulous = 0x04,    // n, nn: broad lines
+        Peculiar = 0x08,    // p, or abundance notes like Si, Fe-1, CN
+        Shell = 0x10,       // sh
+        Variable = 0x20,    // var
+        Uncertain = 0x40,   // : or ?
+        Composite = 0x80    // + followed by the companion's type
+    };
+
+    // Subclass is kept in tenths, 95 for O9.5
+    static constexpr quint8 NO_SUBCLASS = 0xff;
+
+    quint8 spectralClass = UnknownClass;
+    quint8 subclass = NO_SUBCLASS;
+    quint8 luminosity = UnknownLuminosity;
+    quint8 flags = 0;
+
+    static constexpr SpectralType parse(const char *text, int length);
+    static constexpr SpectralType parse(const char *text);
+    static SpectralType parse(const QString &spType);
+
+    // All four bytes as one number, e.g. to store or compare
+    constexpr quint32 code() const
+    {
+        return quint32(spectralClass) | quint32(subclass) << 8 | quint32(luminosity) << 16 | quint32(flags) << 24;
+    }
+
+    static constexpr SpectralType fromCode(quint32 code)
+    {
+        SpectralType type;
+        type.spectralClass = quint8(code);
+        type.subclass = quint8(code >> 8);
+        type.luminosity = quint8(code >> 16);
+        type.flags = quint8(code >> 24);
+        return type;
+    }
+
+    constexpr bool hasFlag(Flag flag) const { return (flags & flag) != 0; }
+
+    // O, B, A, F, G, K or M, 0 for the other classes
+    constexpr char classLetter() const
+    {
+        return spectralClass >= O && spectralClass <= M ? "OBAFGKM"[spectralClass - O] : 0;
+    }
+
+    constexpr float radius() const
+    {
+        return CLASS_RADIUS[spectralClass < ClassCount ? spectralClass : 0]
+               * LUMINOSITY_SCALE[luminosity < LuminosityCount ? luminosity : 0];
+    }
+
+    constexpr QRgb rgb() const
+    {
+        return luminosity == WhiteDwarf ? WHITE_DWARF_RGB : CLASS_RGB[spectralClass < ClassCount ? spectralClass : 0];
+    }
+
+    QColor color() const { return QColor::fromRgb(rgb()); }
+
+    constexpr bool operator==(const SpectralType &other) const { return code() == other.code(); }
+    constexpr bool operator!=(const SpectralType &other) const { return code() != other.code(); }
+
+    // Radie för standardstjärnan i varje klass, G som referens
+    static constexpr float CLASS_RADIUS[ClassCount] = {
+        1.5f,                                       // Okänd
+        2.5f, 2.0f, 1.8f, 1.6f, 1.5f, 1.3f, 1.0f,   // O B A F G K M
+        2.5f,                                       // Wolf-Rayet
+        0.8f, 0.7f, 0.6f,                           // L T Y
+        1.0f, 1.0f                                  // C S
+    };
+
+    // Jättar och superjättar skalas upp, dvärgar ner
+    static constexpr float LUMINOSITY_SCALE[LuminosityCount] = {
+        1.0f,   // Okänd
+        6.0f,   // 0
+        5.0f,   // I
+        4.0f,   // II
+        3.0f,   // III
+        1.5f,   // IV
+        1.0f,   // V
+        0.8f,   // VI
+        0.3f    // VII
+    };
+
+    // O to M keep their colours from before the table, Qt::darkBlue for O and
+    // so on. Wolf-Rayet, L, T, Y, C, S and white dwarfs were drawn cyan before
+    // and now get a colour of their own.
+    static constexpr QRgb CLASS_RGB[ClassCount] = {
+        0xff00ffff,                                                 // Okänd, cyan
+        0xff000080, 0xff0000ff, 0xffffffff, 0xffffff00,             // O B A F
+        0xff808000, 0xffff0000, 0xff800000,                         // G K M
+        0xff000080,                                                 // Wolf-Rayet, as O
+        0xff800000, 0xff600000, 0xff400000,                         // L T Y
+        0xff800000, 0xff800000                                      // C S, as M
+    };
+
+    static constexpr QRgb WHITE_DWARF_RGB = 0xffffffff;
+
+private:
+    static constexpr Class classOf(char letter)
+    {
+        switch (letter) {
+        case 'O': return O;
+        case 'B': return B;
+        case 'A': return A;
+        case 'F': return F;
+        case 'G': return G;
+        case 'K': return K;
+        case 'M': return M;
+        case 'W': return WolfRayet;
+        case 'L': return L;
+        case 'T': return T;
+        case 'Y': return Y;
+        case 'C': case 'R': case 'N': return Carbon;
+        case 'S': return S;
+        default:  return UnknownClass;
+        }
+    }
+
+    static constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+    static constexpr bool isUpper(char c) { return c >= 'A' && c <= 'Z'; }
+    static constexpr bool isLower(char c) { return c >= 'a' && c <= 'z'; }
+};
+
+/*
+ * SP_TYPE is read left to right once: prefix, class letter, subclass,
+ * luminosity class, then peculiarity notes. Only the first of a range
+ * such as "G8/K0" or "III-IV" is kept. A '+' followed by a class letter
+ * starts the companion's type, which is not read, any other '+' is
+ * SIMBAD's "a little later" suffix on the subclass.
+ */
+constexpr SpectralType SpectralType::parse(const char *text, int length)
+{
+    SpectralType type;
+    auto at = [text, length](int index) { return index < length ? text[index] : '\0'; };
+    auto companionAt = [&at](int index) {
+        while (at(index) == ' ')
+            ++index;
+        return classOf(at(index)) != UnknownClass || (at(index) == 'D' && isUpper(at(index + 1)));
+    };
+
+    int i = 0;
+    while (at(i) == ' ')
+        ++i;
+
+    // Prefixes that give the luminosity class
+    if (at(i) == 's' && at(i + 1) == 'd') {
+        type.luminosity = Subdwarf;
+        i += 2;
+    } else if ((at(i) == 'e' || at(i) == 'u') && at(i + 1) == 's' && at(i + 2) == 'd') {
+        type.luminosity = Subdwarf;
+        i += 3;
+    } else if (at(i) == 'd' && classOf(at(i + 1)) != UnknownClass) {
+        // Mount Wilson dwarfs, dM4.5 and dMe
+        type.luminosity = Dwarf;
+        ++i;
+    } else if (at(i) == 'D' && isUpper(at(i + 1))) {
+        // DA, DB, DQ, DAZ ... the letters are spectral features, not a class
+        type.luminosity = WhiteDwarf;
+        ++i;
+        while (isUpper(at(i)))
+            ++i;
+    } else if (at(i) == 'k' && isUpper(at(i + 1))) {
+        // Am stars, kA2hA5mA7V: the hydrogen line type after h is used
+        int h = i + 1;
+        while (h < length && !(at(h) == 'h' && isUpper(at(h + 1))))
+            ++h;
+        i = h < length ? h + 1 : i + 1;
+        type.flags |= Metallic;
+    }
+
+    if (type.luminosity != WhiteDwarf) {
+        type.spectralClass = classOf(at(i));
+        if (type.spectralClass != UnknownClass) {
+            ++i;
+            // WN, WC, WO
+            if (type.spectralClass == WolfRayet)
+                while (isUpper(at(i)) && classOf(at(i)) != UnknownClass)
+                    ++i;
+        }
+    }
+
+    if (isDigit(at(i))) {
+        int tenths = 0;
+        while (isDigit(at(i))) {
+            tenths = tenths * 10 + (at(i) - '0') * 10;
+            ++i;
+        }
+        if (at(i) == '.' && isDigit(at(i + 1))) {
+            tenths += at(i + 1) - '0';
+            i += 2;
+            while (isDigit(at(i)))
+                ++i;
+        }
+        type.subclass = quint8(tenths < NO_SUBCLASS ? tenths : NO_SUBCLASS - 1);
+    }
+
+    // Second half of a class range, G8/K0 or F5-G0, or the metal line type of an Am star
+    if ((at(i) == '/' || at(i) == '-' || at(i) == 'm') && classOf(at(i + 1)) != UnknownClass) {
+        i += 2;
+        while (isDigit(at(i)) || at(i) == '.')
+            ++i;
+    }
+
+    // Second half of a subclass range, K0/1 or G8-9
+    if ((at(i) == '/' || at(i) == '-') && isDigit(at(i + 1))) {
+        ++i;
+        while (isDigit(at(i)) || at(i) == '.')
+            ++i;
+    }
+
+    // G8+V, a little later than G8
+    if (at(i) == '+' && !companionAt(i + 1))
+        ++i;
+
+    // An uncertain subclass, F2:V
+    if (at(i) == ':') {
+        type.flags |= Uncertain;
+        ++i;
+    }
+
+    while (at(i) == ' ')
+        ++i;
+
+    // K1(III), the luminosity class in parentheses
+    const bool parenthesised = at(i) == '(' && (at(i + 1) == 'I' || at(i + 1) == 'V');
+    if (parenthesised)
+        ++i;
+
+    // Luminosity class as a roman numeral, read where it stands and nowhere else
+    if (at(i) == '0') {
+        if (type.luminosity == UnknownLuminosity)
+            type.luminosity = Hypergiant;
+        ++i;
+    } else if (at(i) == 'I' || at(i) == 'V') {
+        int value = 0;
+        int previous = 0;
+        while (at(i) == 'I' || at(i) == 'V') {
+            const int digit = at(i) == 'I' ? 1 : 5;
+            value += previous != 0 && digit > previous ? digit - 2 * previous : digit;
+            previous = digit;
+            ++i;
+        }
+
+        Luminosity luminosity = UnknownLuminosity;
+        switch (value) {
+        case 1: luminosity = Supergiant; break;
+        case 2: luminosity = BrightGiant; break;
+        case 3: luminosity = Giant; break;
+        case 4: luminosity = Subgiant; break;
+        case 5: luminosity = Dwarf; break;
+        case 6: luminosity = Subdwarf; break;
+        case 7: luminosity = WhiteDwarf; break;
+        default: break;
+        }
+
+        // Ia+ and Ia0 are hypergiants, a and b only split the class
+        if (luminosity == Supergiant && at(i) == 'a' && (at(i + 1) == '+' || at(i + 1) == '0')) {
+            luminosity = Hypergiant;
+            i += 2;
+        }
+        while (at(i) == 'a' || at(i) == 'b')
+            ++i;
+
+        // Second half of a luminosity range, III-IV or IV/V
+        if ((at(i) == '-' || at(i) == '/') && (at(i + 1) == 'I' || at(i + 1) == 'V')) {
+            ++i;
+            while (at(i) == 'I' || at(i) == 'V' || at(i) == 'a' || at(i) == 'b')
+                ++i;
+        }
+
+        if (type.luminosity == UnknownLuminosity)
+            type.luminosity = luminosity;
+    }
+    if (parenthesised && at(i) == ')')
+        ++i;
+
+    // Peculiarity notes up to the companion's type
+    while (i < length) {
+        const char c = at(i);
+        if (c == '+') {
+            if (companionAt(i + 1)) {
+                type.flags |= Composite;
+                break;
+            }
+            ++i;
+            continue;
+        }
+
+        // Abundance notes, Si, Fe-1, CN1, Ba2
+        if (isUpper(c)) {
+            type.flags |= Peculiar;
+            ++i;
+            while (isUpper(at(i)) || isLower(at(i)))
+                ++i;
+            while (isDigit(at(i)) || at(i) == '-' || at(i) == '.')
+                ++i;
+            continue;
+        }
+
+        if (c == 's' && at(i + 1) == 'h') {
+            type.flags |= Shell;
+            i += 2;
+            continue;
+        }
+        if (c == 'v' && at(i + 1) == 'a' && at(i + 2) == 'r') {
+            type.flags |= Variable;
+            i += 3;
+            continue;
+        }
+
+        switch (c) {
+        case 'e': type.flags |= Emission; break;
+        case 'm': type.flags |= Metallic; break;
+        case 'n': type.flags |= Nebulous; break;
+        case 'p': type.flags |= Peculiar; break;
+        case ':': case '?': type.flags |= Uncertain; break;
+        default: break;
+        }
+        ++i;
+    }
+
+    return type;
+}
+
+constexpr SpectralType SpectralType::parse(const char *text)
+{
+    int length = 0;
+    while (text[length] != '\0')
+        ++length;
+    return parse(text, length);
+}
+
+#endif // SPECTRALTYPE_H
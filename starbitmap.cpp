@@ -0,0 +1,111 @@
+#include "starbitmap.h"
+
+static int wordsFor(int size)
+{
+    return (size + 63) / 64;
+}
+
+StarBitmap::StarBitmap(int size)
+    : m_words(wordsFor(qMax(size, 0)), 0)
+    , m_size(qMax(size, 0))
+{
+}
+
+void StarBitmap::resize(int size)
+{
+    m_size = qMax(size, 0);
+    m_words.resize(wordsFor(m_size));
+    clearTail();
+}
+
+void StarBitmap::set(int row)
+{
+    if (row < 0)
+        return;
+    if (row >= m_size)
+        resize(row + 1);
+    m_words[row >> 6] |= quint64(1) << (row & 63);
+}
+
+void StarBitmap::reset(int row)
+{
+    if (row >= 0 && row < m_size)
+        m_words[row >> 6] &= ~(quint64(1) << (row & 63));
+}
+
+int StarBitmap::count() const
+{
+    int total = 0;
+    for (quint64 word : m_words)
+        total += qPopulationCount(word);
+    return total;
+}
+
+bool StarBitmap::any() const
+{
+    for (quint64 word : m_words) {
+        if (word)
+            return true;
+    }
+    return false;
+}
+
+QVector<int> StarBitmap::rows() const
+{
+    QVector<int> result;
+    result.reserve(count());
+    forEach([&result](int row) { result.append(row); });
+    return result;
+}
+
+StarBitmap &StarBitmap::operator&=(const StarBitmap &other)
+{
+    const int common = qMin(m_words.size(), other.m_words.size());
+    for (int i = 0; i < common; ++i)
+        m_words[i] &= other.m_words[i];
+    for (int i = common; i < m_words.size(); ++i)
+        m_words[i] = 0;
+
+    if (other.m_size > m_size)
+        resize(other.m_size);
+    return *this;
+}
+
+StarBitmap &StarBitmap::operator|=(const StarBitmap &other)
+{
+    if (other.m_size > m_size)
+        resize(other.m_size);
+    for (int i = 0; i < other.m_words.size(); ++i)
+        m_words[i] |= other.m_words[i];
+    return *this;
+}
+
+StarBitmap &StarBitmap::operator^=(const StarBitmap &other)
+{
+    if (other.m_size > m_size)
+        resize(other.m_size);
+    for (int i = 0; i < other.m_words.size(); ++i)
+        m_words[i] ^= other.m_words[i];
+    return *this;
+}
+
+StarBitmap StarBitmap::operator~() const
+{
+    StarBitmap result(*this);
+    for (quint64 &word : result.m_words)
+        word = ~word;
+    result.clearTail();
+    return result;
+}
+
+bool StarBitmap::operator==(const StarBitmap &other) const
+{
+    return m_size == other.m_size && m_words == other.m_words;
+}
+
+void StarBitmap::clearTail()
+{
+    const int used = m_size & 63;
+    if (used && !m_words.isEmpty())
+        m_words.last() &= (quint64(1) << used) - 1;
+}
@@ -0,0 +1,82 @@
+#ifndef STARBITMAP_H
+#define STARBITMAP_H
+
+#include <QVector>
+#include <QtGlobal>
+#include <QtAlgorithms>
+
+/*
+ * One bit per catalog row, 64 rows per word.
+ *
+ * Filters over the catalog are kept as bitmaps so combining them is a
+ * word by word AND, OR or XOR. Bitmaps of different sizes combine as if
+ * the shorter one were padded with zeros, the result has the larger
+ * size. Bits past size() are always zero.
+ *
+ * Part of astronav_core.
+ */
+class StarBitmap
+{
+public:
+    StarBitmap() = default;
+
+    // size rows, none of them set
+    explicit StarBitmap(int size);
+
+    int size() const { return m_size; }
+
+    // Grow or shrink to size rows, new rows are not set
+    void resize(int size);
+
+    bool test(int row) const
+    {
+        return row >= 0 && row < m_size && (m_words[row >> 6] >> (row & 63)) & 1u;
+    }
+
+    // Set a row, growing the bitmap if it is past the end
+    void set(int row);
+    void reset(int row);
+
+    // Number of rows set
+    int count() const;
+    bool any() const;
+
+    // The rows that are set, in order
+    QVector<int> rows() const;
+
+    // Calls function(row) for every row that is set, in order
+    template <typename Function>
+    void forEach(Function function) const
+    {
+        for (int word = 0; word < m_words.size(); ++word) {
+            quint64 bits = m_words[word];
+            while (bits) {
+                function(word * 64 + qCountTrailingZeroBits(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    StarBitmap &operator&=(const StarBitmap &other);
+    StarBitmap &operator|=(const StarBitmap &other);
+    StarBitmap &operator^=(const StarBitmap &other);
+
+    // Every row within size() flipped
+    StarBitmap operator~() const;
+
+    friend StarBitmap operator&(StarBitmap a, const StarBitmap &b) { return a &= b; }
+    friend StarBitmap operator|(StarBitmap a, const StarBitmap &b) { return a |= b; }
+    friend StarBitmap operator^(StarBitmap a, const StarBitmap &b) { return a ^= b; }
+
+    bool operator==(const StarBitmap &other) const;
+    bool operator!=(const StarBitmap &other) const { return !(*this == other); }
+
+private:
+    // Clears the bits of the last word that lie past m_size
+    void clearTail();
+
+    QVector<quint64> m_words;
+    int m_size = 0;
+};
+
+#endif // STARBITMAP_H
@@ -0,0 +1,135 @@
+#include "starbvh.h"
+#include <algorithm>
+
+void StarBvh::clear()
+{
+    m_nodes.clear();
+    m_order.clear();
+    m_slots.clear();
+}
+
+void StarBvh::build(const QVector<QVector3D> &positions,
+                    const QVector<float> &radii,
+                    float padding,
+                    int leafCapacity)
+{
+    clear();
+    m_leafCapacity = qMax(1, leafCapacity);
+
+    const int stars = positions.size();
+    if (stars == 0)
+        return;
+
+    QVector<float> extents(stars);
+    for (int i = 0; i < stars; ++i)
+        extents[i] = radii.value(i, 0.0f) * padding;
+
+    m_order.resize(stars);
+    for (int i = 0; i < stars; ++i)
+        m_order[i] = i;
+
+    // A binary tree with n leaves has 2n - 1 nodes
+    m_nodes.reserve(2 * (stars / m_leafCapacity + 1));
+    m_nodes.append(Node{ QVector3D(), QVector3D(), 0, stars, -1 });
+    buildNode(0, 0, stars, positions, extents);
+
+    m_slots.resize(stars);
+    for (int i = 0; i < stars; ++i)
+        m_slots[m_order[i]] = i;
+}
+
+void StarBvh::grow(int index, const QVector3D &center, float extent)
+{
+    if (index < 0 || index >= m_slots.size())
+        return;
+
+    const int slot = m_slots[index];
+    int nodeIndex = 0;
+    while (nodeIndex >= 0) {
+        Node &node = m_nodes[nodeIndex];
+        for (int axis = 0; axis < 3; ++axis) {
+            node.minPoint[axis] = qMin(node.minPoint[axis], center[axis] - extent);
+            node.maxPoint[axis] = qMax(node.maxPoint[axis], center[axis] + extent);
+        }
+
+        // Go down into the child whose range holds the star
+        if (node.leftChild < 0)
+            break;
+        const Node &left = m_nodes[node.leftChild];
+        nodeIndex = slot < left.first + left.count ? node.leftChild : node.leftChild + 1;
+    }
+}
+
+void StarBvh::buildNode(int nodeIndex, int first, int count,
+                        const QVector<QVector3D> &positions,
+                        const QVector<float> &extents)
+{
+    QVector3D minPoint(std::numeric_limits<float>::max(),
+                       std::numeric_limits<float>::max(),
+                       std::numeric_limits<float>::max());
+    QVector3D maxPoint = -minPoint;
+    QVector3D centerMin = minPoint;
+    QVector3D centerMax = maxPoint;
+
+    for (int i = first; i < first + count; ++i) {
+        const int star = m_order[i];
+        const QVector3D &p = positions[star];
+        const float e = extents[star];
+        for (int axis = 0; axis < 3; ++axis) {
+            minPoint[axis] = qMin(minPoint[axis], p[axis] - e);
+            maxPoint[axis] = qMax(maxPoint[axis], p[axis] + e);
+            centerMin[axis] = qMin(centerMin[axis], p[axis]);
+            centerMax[axis] = qMax(centerMax[axis], p[axis]);
+        }
+    }
+
+    m_nodes[nodeIndex].minPoint = minPoint;
+    m_nodes[nodeIndex].maxPoint = maxPoint;
+    m_nodes[nodeIndex].first = first;
+    m_nodes[nodeIndex].count = count;
+    m_nodes[nodeIndex].leftChild = -1;
+
+    const QVector3D spread = centerMax - centerMin;
+    if (count <= m_leafCapacity || spread.lengthSquared() == 0.0f)
+        return;
+
+    // Split at the median star along the axis where the centers spread most
+    int axis = 0;
+    if (spread.y() > spread[axis])
+        axis = 1;
+    if (spread.z() > spread[axis])
+        axis = 2;
+
+    const int half = count / 2;
+    std::nth_element(m_order.begin() + first,
+                     m_order.begin() + first + half,
+                     m_order.begin() + first + count,
+                     [&positions, axis](int a, int b) { return positions[a][axis] < positions[b][axis]; });
+
+    // Both children are appended before either is filled in so they stay adjacent
+    const int leftChild = m_nodes.size();
+    m_nodes.append(Node{ QVector3D(), QVector3D(), first, half, -1 });
+    m_nodes.append(Node{ QVector3D(), QVector3D(), first + half, count - half, -1 });
+    m_nodes[nodeIndex].leftChild = leftChild;
+
+    buildNode(leftChild, first, half, positions, extents);
+    buildNode(leftChild + 1, first + half, count - half, positions, extents);
+}
+
+float StarBvh::enterDistance(const Node &node, const QVector3D &origin, const QVector3D &inverseDirection)
+{
+    // Slab test, the ray starts at origin and goes on forever
+    float nearHit = 0.0f;
+    float farHit = std::numeric_limits<float>::max();
+    for (int axis = 0; axis < 3; ++axis) {
+        float t0 = (node.minPoint[axis] - origin[axis]) * inverseDirection[axis];
+        float t1 = (node.maxPoint[axis] - origin[axis]) * inverseDirection[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        nearHit = qMax(nearHit, t0);
+        farHit = qMin(farHit, t1);
+        if (nearHit > farHit)
+            return -1.0f;
+    }
+    return nearHit;
+}
@@ -0,0 +1,134 @@
+#ifndef STARBVH_H
+#define STARBVH_H
+
+#include <QVector>
+#include <QVector3D>
+#include <QVarLengthArray>
+#include <QtMath>
+#include <limits>
+#include <utility>
+
+/*
+ * Bounding volume hierarchy over the star spheres, used for picking.
+ *
+ * Unlike the octree, every node box is fitted to the spheres below it,
+ * and a ray walks the tree front to back, skipping every node that
+ * starts behind the closest hit so far. A pick touches a few dozen
+ * nodes no matter how many stars there are.
+ *
+ * Each node covers a contiguous range of order(). The two children of
+ * an inner node are stored next to each other.
+ */
+class StarBvh
+{
+public:
+    struct Node {
+        QVector3D minPoint;
+        QVector3D maxPoint;
+        int first;      // Range of the node's stars in order()
+        int count;
+        int leftChild;  // The right child follows it, -1 for a leaf
+    };
+
+    // Sphere radii are multiplied by padding when fitting the boxes
+    void build(const QVector<QVector3D> &positions,
+               const QVector<float> &radii,
+               float padding = 1.0f,
+               int leafCapacity = 4);
+    void clear();
+
+    bool isEmpty() const { return m_nodes.isEmpty(); }
+    const QVector<Node> &nodes() const { return m_nodes; }
+
+    // Catalog indices sorted by node
+    const QVector<int> &order() const { return m_order; }
+
+    // Enlarge the boxes from the root down to the star's leaf so they
+    // cover a sphere around center, e.g. after the star grew
+    void grow(int index, const QVector3D &center, float extent);
+
+    // Closest star along the ray, or -1. hitDistance(catalogIndex) returns
+    // the distance to the star along the ray, negative for a miss.
+    template <typename HitTest>
+    int closestHit(const QVector3D &origin, const QVector3D &direction,
+                   HitTest hitDistance, float *distance = nullptr) const;
+
+private:
+    void buildNode(int nodeIndex, int first, int count,
+                   const QVector<QVector3D> &positions,
+                   const QVector<float> &extents);
+
+    // Distance where the ray enters the node, negative if it misses
+    static float enterDistance(const Node &node, const QVector3D &origin, const QVector3D &inverseDirection);
+
+    QVector<Node> m_nodes;
+    QVector<int> m_order;
+    QVector<int> m_slots;       // Position of every catalog index in m_order
+    int m_leafCapacity = 4;
+};
+
+template <typename HitTest>
+int StarBvh::closestHit(const QVector3D &origin, const QVector3D &direction,
+                        HitTest hitDistance, float *distance) const
+{
+    int closestStar = -1;
+    float closestDistance = std::numeric_limits<float>::max();
+
+    if (m_nodes.isEmpty()) {
+        if (distance)
+            *distance = closestDistance;
+        return closestStar;
+    }
+
+    // Axes the ray runs parallel to get a huge factor instead of a division by zero
+    QVector3D inverseDirection;
+    for (int axis = 0; axis < 3; ++axis) {
+        inverseDirection[axis] = qFuzzyIsNull(direction[axis])
+                                     ? std::numeric_limits<float>::max()
+                                     : 1.0f / direction[axis];
+    }
+
+    // Node index and the distance where the ray enters it
+    QVarLengthArray<std::pair<int, float>, 64> stack;
+    const float rootEnter = enterDistance(m_nodes[0], origin, inverseDirection);
+    if (rootEnter >= 0.0f)
+        stack.append({ 0, rootEnter });
+
+    while (!stack.isEmpty()) {
+        const std::pair<int, float> entry = stack.takeLast();
+        if (entry.second > closestDistance)
+            continue;
+
+        const Node &node = m_nodes[entry.first];
+        if (node.leftChild < 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                const float hit = hitDistance(m_order[i]);
+                if (hit >= 0.0f && hit < closestDistance) {
+                    closestDistance = hit;
+                    closestStar = m_order[i];
+                }
+            }
+            continue;
+        }
+
+        // Push the far child first so the near one is walked first
+        int nearChild = node.leftChild;
+        int farChild = node.leftChild + 1;
+        float nearEnter = enterDistance(m_nodes[nearChild], origin, inverseDirection);
+        float farEnter = enterDistance(m_nodes[farChild], origin, inverseDirection);
+        if (farEnter >= 0.0f && (nearEnter < 0.0f || farEnter < nearEnter)) {
+            std::swap(nearChild, farChild);
+            std::swap(nearEnter, farEnter);
+        }
+        if (farEnter >= 0.0f && farEnter <= closestDistance)
+            stack.append({ farChild, farEnter });
+        if (nearEnter >= 0.0f && nearEnter <= closestDistance)
+            stack.append({ nearChild, nearEnter });
+    }
+
+    if (distance)
+        *distance = closestDistance;
+    return closestStar;
+}
+
+#endif // STARBVH_H
@@ -0,0 +1,73 @@
+#include "starcatalog.h"
+
+void StarCatalog::clear()
+{
+    m_ids.clear();
+    m_ra.clear();
+    m_dec.clear();
+    m_parallax.clear();
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+    m_spTypes.clear();
+    m_spectral.clear();
+    m_index.clear();
+    m_spectralIndex.clear();
+}
+
+void StarCatalog::append(const StarRecord &record)
+{
+    // Första raden vinner om samma MAIN_ID finns flera gånger
+    if (!m_index.contains(record.id))
+        m_index.insert(record.id, m_ids.size());
+
+    m_ids.append(record.id);
+    m_ra.append(record.rightAscension);
+    m_dec.append(record.declination);
+    m_parallax.append(record.parallax);
+    m_x.append(record.position.x());
+    m_y.append(record.position.y());
+    m_z.append(record.position.z());
+    m_spTypes.append(record.spType);
+    m_spectral.append(record.spectral);
+    m_spectralIndex.append(record.spectral);
+}
+
+void StarCatalog::update(int row, const StarRecord &record)
+{
+    if (row < 0 || row >= m_ids.size())
+        return;
+
+    if (m_ids[row] != record.id) {
+        if (m_index.value(m_ids[row], -1) == row)
+            m_index.remove(m_ids[row]);
+        if (!m_index.contains(record.id))
+            m_index.insert(record.id, row);
+        m_ids[row] = record.id;
+    }
+
+    m_ra[row] = record.rightAscension;
+    m_dec[row] = record.declination;
+    m_parallax[row] = record.parallax;
+    m_x[row] = record.position.x();
+    m_y[row] = record.position.y();
+    m_z[row] = record.position.z();
+    m_spTypes[row] = record.spType;
+    if (m_spectral[row] != record.spectral) {
+        m_spectralIndex.update(row, m_spectral[row], record.spectral);
+        m_spectral[row] = record.spectral;
+    }
+}
+
+StarRecord StarCatalog::record(int row) const
+{
+    StarRecord star;
+    star.id = m_ids[row];
+    star.rightAscension = m_ra[row];
+    star.declination = m_dec[row];
+    star.parallax = m_parallax[row];
+    star.position = position(row);
+    star.spType = m_spTypes[row];
+    star.spectral = m_spectral[row];
+    return star;
+}
@@ -0,0 +1,107 @@
+#ifndef STARCATALOG_H
+#define STARCATALOG_H
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <QVector3D>
+#include <QColor>
+#include <QMetaType>
+#include "spectraltype.h"
+#include "spectralindex.h"
+
+/*
+ * One row of the stars table plus the values derived from it, filled in
+ * by the loader thread so the GUI thread only has to copy it.
+ */
+struct StarRecord
+{
+    QString id;
+    double rightAscension = 0.0;
+    double declination = 0.0;
+    double parallax = 0.0;
+    QVector3D position;         // As stored in the database
+    QString spType;
+
+    // Derived
+    SpectralType spectral;
+    float radius = 0.0f;
+    QColor color;
+};
+
+Q_DECLARE_METATYPE(StarRecord)
+
+/*
+ * Every star in the stars table, filled in by StarLoader at startup.
+ *
+ * The columns are kept as separate arrays indexed by row, a hash maps
+ * MAIN_ID to its row and SpectralIndex keeps the rows of every class.
+ * The scene, the picker callbacks, the search panel and the camera
+ * controllers look stars up here instead of querying SQLite, so a click
+ * or a search never touches disk.
+ *
+ * Rows are in the order the stars were added to the renderer, so a
+ * renderer index is also a catalog row.
+ */
+class StarCatalog
+{
+public:
+    // Database coordinates are multiplied by this to get scene units
+    static constexpr float SCENE_SCALE = 15.0f;
+
+    StarCatalog() = default;
+
+    // Add a star as the next row
+    void append(const StarRecord &record);
+
+    // Replace the values of an existing row, the id index follows a new MAIN_ID
+    void update(int row, const StarRecord &record);
+
+    // The row as a record, with the derived values left empty
+    StarRecord record(int row) const;
+    void clear();
+
+    int count() const { return m_ids.size(); }
+    bool isEmpty() const { return m_ids.isEmpty(); }
+
+    // Row of a MAIN_ID or -1, O(1)
+    int indexOf(const QString &id) const { return m_index.value(id, -1); }
+    bool contains(const QString &id) const { return m_index.contains(id); }
+
+    const QString &id(int row) const { return m_ids[row]; }
+    const QVector<QString> &ids() const { return m_ids; }
+
+    double rightAscension(int row) const { return m_ra[row]; }
+    double declination(int row) const { return m_dec[row]; }
+    double parallax(int row) const { return m_parallax[row]; }
+
+    // Coordinates as stored in the database
+    QVector3D position(int row) const { return QVector3D(m_x[row], m_y[row], m_z[row]); }
+
+    // Coordinates in the 3D scene
+    QVector3D scenePosition(int row) const { return position(row) * SCENE_SCALE; }
+
+    const QString &spectralType(int row) const { return m_spTypes[row]; }
+
+    // SP_TYPE as parsed by the loader
+    SpectralType spectral(int row) const { return m_spectral[row]; }
+
+    // Class and luminosity class bitmaps over the rows, for type searches
+    const SpectralIndex &spectralIndex() const { return m_spectralIndex; }
+
+private:
+    QVector<QString> m_ids;
+    QVector<double> m_ra;
+    QVector<double> m_dec;
+    QVector<double> m_parallax;
+    QVector<float> m_x;
+    QVector<float> m_y;
+    QVector<float> m_z;
+    QVector<QString> m_spTypes;
+    QVector<SpectralType> m_spectral;
+
+    QHash<QString, int> m_index;
+    SpectralIndex m_spectralIndex;
+};
+
+#endif // STARCATALOG_H
@@ -0,0 +1,433 @@
+#include "starcatalogcache.h"
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+// Bump when the layout below changes
+static const quint32 CACHE_VERSION = 2;
+static const char CACHE_MAGIC[4] = { 'A', 'N', 'S', 'C' };
+
+// Written as a number, reads back differently on a machine with the other byte order
+static const quint32 BYTE_ORDER_MARK = 0x01020304;
+
+// Which database file the cache was made from
+struct SourceStamp
+{
+    qint64 size = -1;
+    qint64 modified = -1;
+    quint32 changeCounter = 0;
+};
+
+struct StarCatalogCache::Header
+{
+    char magic[4];
+    quint32 version;
+    quint32 byteOrder;
+    quint32 starCount;
+    quint32 nodeCount;
+    quint32 leafCount;
+
+    qint64 sourceSize;
+    qint64 sourceModified;
+    quint32 sourceChangeCounter;
+    quint32 reserved;
+
+    quint64 fileSize;
+
+    // Byte offsets of the sections, each aligned to 8
+    quint64 positions;          // float x, y, z per star, scene units
+    quint64 radii;              // float per star
+    quint64 colors;             // QRgb per star
+    quint64 astrometry;         // double RA, DEC, parallax per star
+    quint64 spectralTypes;      // SpectralType::code() per star
+    quint64 idOffsets;          // quint32 per star plus one, into idChars
+    quint64 idChars;            // UTF-16
+    quint64 spTypeOffsets;
+    quint64 spTypeChars;
+    quint64 nodes;              // CachedNode per octree node
+    quint64 leaves;             // qint32 per leaf
+    quint64 order;              // qint32 per star
+};
+
+struct CachedNode
+{
+    float minPoint[3];
+    float maxPoint[3];
+    qint32 firstChild;
+    qint32 childCount;
+    qint32 first;
+    qint32 count;
+    qint32 leaf;
+};
+
+/*
+ * Size and modification time of the database, and the change counter
+ * SQLite keeps at byte 24 of the file header. The counter goes up on
+ * every committed write, so edits within the same second are caught too.
+ */
+static SourceStamp sourceStamp(const QString &databaseFile)
+{
+    SourceStamp stamp;
+    QFileInfo info(databaseFile);
+    if (!info.exists())
+        return stamp;
+
+    stamp.size = info.size();
+    stamp.modified = info.lastModified().toMSecsSinceEpoch();
+
+    QFile file(databaseFile);
+    if (file.open(QIODevice::ReadOnly)) {
+        const QByteArray header = file.read(28);
+        if (header.size() == 28)
+            stamp.changeCounter = qFromBigEndian<quint32>(header.constData() + 24);
+    }
+    return stamp;
+}
+
+static quint64 alignedSize(quint64 size)
+{
+    return (size + 7) & ~quint64(7);
+}
+
+// Offsets that never go down keep every string inside its table, the last one is checked against the file
+static bool offsetsAscending(const quint32 *offsets, quint64 stars)
+{
+    for (quint64 row = 0; row < stars; ++row) {
+        if (offsets[row] > offsets[row + 1])
+            return false;
+    }
+    return true;
+}
+
+StarCatalogCache::StarCatalogCache(const QString &databaseFile)
+    : m_databaseFile(databaseFile)
+    , m_file(cacheFileFor(databaseFile))
+    , m_data(nullptr)
+    , m_header(nullptr)
+{
+}
+
+StarCatalogCache::~StarCatalogCache()
+{
+    close();
+}
+
+QString StarCatalogCache::cacheFileFor(const QString &databaseFile)
+{
+    QFileInfo info(databaseFile);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".cache";
+}
+
+bool StarCatalogCache::open()
+{
+    close();
+
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 size = m_file.size();
+    if (size < qint64(sizeof(Header))) {
+        close();
+        return false;
+    }
+
+    uchar *data = m_file.map(0, size);
+    if (!data) {
+        close();
+        return false;
+    }
+    m_data = data;
+    m_header = reinterpret_cast<const Header *>(m_data);
+
+    const SourceStamp stamp = sourceStamp(m_databaseFile);
+    const Header &header = *m_header;
+    bool valid = std::memcmp(header.magic, CACHE_MAGIC, 4) == 0
+                 && header.version == CACHE_VERSION
+                 && header.byteOrder == BYTE_ORDER_MARK
+                 && header.fileSize == quint64(size)
+                 && header.sourceSize == stamp.size
+                 && header.sourceModified == stamp.modified
+                 && header.sourceChangeCounter == stamp.changeCounter;
+
+    // Every section has to lie inside the file
+    const quint64 stars = header.starCount;
+    const quint64 sections[][2] = {
+        { header.positions, stars * 3 * sizeof(float) },
+        { header.radii, stars * sizeof(float) },
+        { header.colors, stars * sizeof(quint32) },
+        { header.astrometry, stars * 3 * sizeof(double) },
+        { header.spectralTypes, stars * sizeof(quint32) },
+        { header.idOffsets, (stars + 1) * sizeof(quint32) },
+        { header.spTypeOffsets, (stars + 1) * sizeof(quint32) },
+        { header.nodes, quint64(header.nodeCount) * sizeof(CachedNode) },
+        { header.leaves, quint64(header.leafCount) * sizeof(qint32) },
+        { header.order, stars * sizeof(qint32) },
+    };
+    for (const auto &range : sections) {
+        if (!valid)
+            break;
+        valid = range[0] % 8 == 0 && range[0] <= quint64(size) && range[1] <= quint64(size) - range[0];
+    }
+    if (valid) {
+        const quint64 idChars = section<quint32>(header.idOffsets)[stars];
+        const quint64 spTypeChars = section<quint32>(header.spTypeOffsets)[stars];
+        valid = header.idChars <= quint64(size) && idChars * 2 <= quint64(size) - header.idChars
+                && header.spTypeChars <= quint64(size) && spTypeChars * 2 <= quint64(size) - header.spTypeChars;
+    }
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    // The stamp matches, but the tables are only used without checks if they hold together
+    if (!offsetsAscending(section<quint32>(header.idOffsets), stars)
+        || !offsetsAscending(section<quint32>(header.spTypeOffsets), stars)
+        || !octreeValid()) {
+        qWarning() << "Ignoring broken star cache" << m_file.fileName();
+        close();
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Checks the cached octree the way build() leaves it: children come
+ * after their parent and inside the node table, every node's range lies
+ * inside its parent's, leaves and leaf nodes point at each other, and
+ * order() is a permutation of the rows. Nothing the renderer or a query
+ * reads can then be out of range, and walking the tree always ends.
+ */
+bool StarCatalogCache::octreeValid() const
+{
+    const Header &header = *m_header;
+    const qint64 stars = header.starCount;
+    const qint64 nodeCount = header.nodeCount;
+    const qint64 leafCount = header.leafCount;
+    const CachedNode *nodes = section<CachedNode>(header.nodes);
+    const qint32 *leaves = section<qint32>(header.leaves);
+    const qint32 *order = section<qint32>(header.order);
+
+    if (nodeCount == 0)
+        return stars == 0 && leafCount == 0;
+    if (nodes[0].first != 0 || nodes[0].count != stars)
+        return false;
+
+    for (qint64 i = 0; i < nodeCount; ++i) {
+        const CachedNode &node = nodes[i];
+        if (node.first < 0 || node.count < 0 || node.first > stars - node.count)
+            return false;
+
+        if (node.firstChild < 0) {
+            if (node.leaf < 0 || node.leaf >= leafCount || leaves[node.leaf] != i)
+                return false;
+            continue;
+        }
+
+        if (node.leaf != -1 || node.firstChild <= i || node.childCount < 1 || node.childCount > 8
+            || node.firstChild > nodeCount - node.childCount)
+            return false;
+        for (qint32 child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+            if (nodes[child].first < node.first
+                || qint64(nodes[child].first) + nodes[child].count > qint64(node.first) + node.count)
+                return false;
+        }
+    }
+
+    for (qint64 leaf = 0; leaf < leafCount; ++leaf) {
+        if (leaves[leaf] < 0 || leaves[leaf] >= nodeCount || nodes[leaves[leaf]].leaf != leaf)
+            return false;
+    }
+
+    QVector<bool> seen(stars, false);
+    for (qint64 slot = 0; slot < stars; ++slot) {
+        const qint32 row = order[slot];
+        if (row < 0 || row >= stars || seen[row])
+            return false;
+        seen[row] = true;
+    }
+    return true;
+}
+
+void StarCatalogCache::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar *>(m_data));
+    m_data = nullptr;
+    m_header = nullptr;
+    m_file.close();
+}
+
+int StarCatalogCache::count() const
+{
+    return m_header ? int(m_header->starCount) : 0;
+}
+
+QString StarCatalogCache::stringAt(quint64 offsetsSection, quint64 charsSection, int row) const
+{
+    const quint32 *offsets = section<quint32>(offsetsSection);
+    const QChar *chars = section<QChar>(charsSection);
+    return QString(chars + offsets[row], int(offsets[row + 1] - offsets[row]));
+}
+
+QVector3D StarCatalogCache::scenePosition(int row) const
+{
+    const float *position = section<float>(m_header->positions) + 3 * row;
+    return QVector3D(position[0], position[1], position[2]);
+}
+
+StarRecord StarCatalogCache::record(int row) const
+{
+    const double *astrometry = section<double>(m_header->astrometry) + 3 * row;
+
+    StarRecord star;
+    star.id = stringAt(m_header->idOffsets, m_header->idChars, row);
+    star.rightAscension = astrometry[0];
+    star.declination = astrometry[1];
+    star.parallax = astrometry[2];
+    star.position = scenePosition(row) / StarCatalog::SCENE_SCALE;
+    star.spType = stringAt(m_header->spTypeOffsets, m_header->spTypeChars, row);
+    star.spectral = SpectralType::fromCode(section<quint32>(m_header->spectralTypes)[row]);
+    star.radius = section<float>(m_header->radii)[row];
+    star.color = QColor::fromRgba(section<quint32>(m_header->colors)[row]);
+    return star;
+}
+
+StarOctree StarCatalogCache::octree() const
+{
+    QVector<StarOctree::Node> nodes(m_header->nodeCount);
+    const CachedNode *cachedNodes = section<CachedNode>(m_header->nodes);
+    for (int i = 0; i < nodes.size(); ++i) {
+        const CachedNode &cached = cachedNodes[i];
+        nodes[i] = StarOctree::Node{
+            QVector3D(cached.minPoint[0], cached.minPoint[1], cached.minPoint[2]),
+            QVector3D(cached.maxPoint[0], cached.maxPoint[1], cached.maxPoint[2]),
+            cached.firstChild, cached.childCount, cached.first, cached.count, cached.leaf
+        };
+    }
+
+    QVector<int> leaves(m_header->leafCount);
+    std::memcpy(leaves.data(), section<qint32>(m_header->leaves), leaves.size() * sizeof(qint32));
+
+    QVector<int> order(m_header->starCount);
+    std::memcpy(order.data(), section<qint32>(m_header->order), order.size() * sizeof(qint32));
+
+    StarOctree octree;
+    octree.assign(nodes, leaves, order);
+    return octree;
+}
+
+StarCatalogCache::Scene StarCatalogCache::sceneOf(const InstancedStarRenderer &starRenderer)
+{
+    return Scene{ starRenderer.positions(), starRenderer.radii(), starRenderer.colors(), starRenderer.octree() };
+}
+
+bool StarCatalogCache::write(const QString &databaseFile,
+                             const StarCatalog &catalog,
+                             const Scene &scene)
+{
+    const int stars = catalog.count();
+    const StarOctree &octree = scene.octree;
+    if (scene.positions.size() != stars || scene.radii.size() != stars || scene.colors.size() != stars
+        || octree.starCount() != stars)
+        return false;
+
+    // String tables first, their sizes decide the layout
+    QVector<quint32> idOffsets(stars + 1);
+    QVector<quint32> spTypeOffsets(stars + 1);
+    idOffsets[0] = 0;
+    spTypeOffsets[0] = 0;
+    for (int row = 0; row < stars; ++row) {
+        idOffsets[row + 1] = idOffsets[row] + quint32(catalog.id(row).size());
+        spTypeOffsets[row + 1] = spTypeOffsets[row] + quint32(catalog.spectralType(row).size());
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.starCount = quint32(stars);
+    header.nodeCount = quint32(octree.nodes().size());
+    header.leafCount = quint32(octree.leaves().size());
+
+    const SourceStamp stamp = sourceStamp(databaseFile);
+    header.sourceSize = stamp.size;
+    header.sourceModified = stamp.modified;
+    header.sourceChangeCounter = stamp.changeCounter;
+
+    quint64 offset = alignedSize(sizeof(Header));
+    auto place = [&offset](quint64 bytes) {
+        const quint64 start = offset;
+        offset = alignedSize(offset + bytes);
+        return start;
+    };
+    header.positions = place(quint64(stars) * 3 * sizeof(float));
+    header.radii = place(quint64(stars) * sizeof(float));
+    header.colors = place(quint64(stars) * sizeof(quint32));
+    header.astrometry = place(quint64(stars) * 3 * sizeof(double));
+    header.spectralTypes = place(quint64(stars) * sizeof(quint32));
+    header.idOffsets = place(quint64(stars + 1) * sizeof(quint32));
+    header.idChars = place(quint64(idOffsets[stars]) * sizeof(QChar));
+    header.spTypeOffsets = place(quint64(stars + 1) * sizeof(quint32));
+    header.spTypeChars = place(quint64(spTypeOffsets[stars]) * sizeof(QChar));
+    header.nodes = place(quint64(header.nodeCount) * sizeof(CachedNode));
+    header.leaves = place(quint64(header.leafCount) * sizeof(qint32));
+    header.order = place(quint64(stars) * sizeof(qint32));
+    header.fileSize = offset;
+
+    QByteArray data(qsizetype(offset), '\0');
+    char *base = data.data();
+    std::memcpy(base, &header, sizeof(Header));
+
+    float *positions = reinterpret_cast<float *>(base + header.positions);
+    float *radii = reinterpret_cast<float *>(base + header.radii);
+    quint32 *colors = reinterpret_cast<quint32 *>(base + header.colors);
+    double *astrometry = reinterpret_cast<double *>(base + header.astrometry);
+    quint32 *spectralTypes = reinterpret_cast<quint32 *>(base + header.spectralTypes);
+    QChar *idChars = reinterpret_cast<QChar *>(base + header.idChars);
+    QChar *spTypeChars = reinterpret_cast<QChar *>(base + header.spTypeChars);
+
+    for (int row = 0; row < stars; ++row) {
+        const QVector3D &position = scene.positions[row];
+        positions[3 * row] = position.x();
+        positions[3 * row + 1] = position.y();
+        positions[3 * row + 2] = position.z();
+        radii[row] = scene.radii[row];
+        colors[row] = scene.colors[row].rgba();
+        astrometry[3 * row] = catalog.rightAscension(row);
+        astrometry[3 * row + 1] = catalog.declination(row);
+        astrometry[3 * row + 2] = catalog.parallax(row);
+        spectralTypes[row] = catalog.spectral(row).code();
+
+        const QString &id = catalog.id(row);
+        std::memcpy(idChars + idOffsets[row], id.constData(), id.size() * sizeof(QChar));
+        const QString &spType = catalog.spectralType(row);
+        std::memcpy(spTypeChars + spTypeOffsets[row], spType.constData(), spType.size() * sizeof(QChar));
+    }
+    std::memcpy(base + header.idOffsets, idOffsets.constData(), idOffsets.size() * sizeof(quint32));
+    std::memcpy(base + header.spTypeOffsets, spTypeOffsets.constData(), spTypeOffsets.size() * sizeof(quint32));
+
+    CachedNode *nodes = reinterpret_cast<CachedNode *>(base + header.nodes);
+    for (int i = 0; i < octree.nodes().size(); ++i) {
+        const StarOctree::Node &node = octree.nodes()[i];
+        nodes[i] = CachedNode{
+            { node.minPoint.x(), node.minPoint.y(), node.minPoint.z() },
+            { node.maxPoint.x(), node.maxPoint.y(), node.maxPoint.z() },
+            node.firstChild, node.childCount, node.first, node.count, node.leaf
+        };
+    }
+    std::memcpy(base + header.leaves, octree.leaves().constData(), octree.leaves().size() * sizeof(qint32));
+    std::memcpy(base + header.order, octree.order().constData(), octree.order().size() * sizeof(qint32));
+
+    // Written to a temporary file and renamed, a crash never leaves half a cache
+    QSaveFile file(cacheFileFor(databaseFile));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write star cache:" << file.errorString();
+        return false;
+    }
+    file.write(data);
+    return file.commit();
+}
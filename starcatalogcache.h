@@ -0,0 +1,77 @@
+#ifndef STARCATALOGCACHE_H
+#define STARCATALOGCACHE_H
+
+#include <QFile>
+#include <QString>
+#include <QVector3D>
+#include "starcatalog.h"
+#include "staroctree.h"
+#include "instancedstarrenderer.h"
+
+/*
+ * Binary copy of the star catalog, kept next to local_stars.db.
+ *
+ * The file holds everything the scene needs in the form the renderer
+ * uses it: scene positions, radii, packed colours, the id and spectral
+ * type strings as UTF-16 tables, and the renderer's octree. It is
+ * memory-mapped and copied straight into the catalog and renderer, no
+ * SQL and no per-row string logic.
+ *
+ * The header records the size, modification time and SQLite change
+ * counter of the database it was made from. A cache whose stamp doesn't
+ * match the database is ignored and written again after the next load.
+ */
+class StarCatalogCache
+{
+public:
+    explicit StarCatalogCache(const QString &databaseFile);
+    ~StarCatalogCache();
+
+    // Path of the cache file belonging to a database file
+    static QString cacheFileFor(const QString &databaseFile);
+
+    // Map the cache, false when it is missing, broken or older than the database
+    bool open();
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    int count() const;
+    StarRecord record(int row) const;
+    QVector3D scenePosition(int row) const;
+
+    // The renderer's octree over the cached stars
+    StarOctree octree() const;
+
+    // What the cache takes from the renderer. The containers are implicitly
+    // shared, so a copy is cheap and can be written on another thread.
+    struct Scene {
+        QVector<QVector3D> positions;
+        QVector<float> radii;
+        QVector<QColor> colors;
+        StarOctree octree;
+    };
+    static Scene sceneOf(const InstancedStarRenderer &starRenderer);
+
+    // Write the cache for the catalog and the renderer's scene, the scene's
+    // stars must be the catalog's rows in the same order. Only reads the
+    // copies, so it can run off the GUI thread.
+    static bool write(const QString &databaseFile,
+                      const StarCatalog &catalog,
+                      const Scene &scene);
+
+private:
+    struct Header;
+
+    template <typename T>
+    const T *section(quint64 offset) const { return reinterpret_cast<const T *>(m_data + offset); }
+
+    QString stringAt(quint64 offsetsSection, quint64 charsSection, int row) const;
+    bool octreeValid() const;
+
+    QString m_databaseFile;
+    QFile m_file;
+    const uchar *m_data;
+    const Header *m_header;
+};
+
+#endif // STARCATALOGCACHE_H
@@ -0,0 +1,87 @@
+#include "starcatalogreader.h"
+#include "spectraltype.h"
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+// Shared with StarLoader, which logs the rest of a load
+Q_LOGGING_CATEGORY(lcStarLoading, "astronav.loading", QtInfoMsg)
+
+// Rows per batch sent from the loader thread
+static const int ROWS_PER_BATCH = 1024;
+
+// The loader thread has its own connection, SQLite connections can't be shared between threads
+static const char *LOADER_CONNECTION = "starsLoaderConnection";
+
+StarCatalogReader::StarCatalogReader(const QAtomicInt *generation, QObject *parent)
+    : QObject(parent)
+    , m_generation(generation)
+{
+}
+
+void StarCatalogReader::read(const QString &databaseFile, int generation)
+{
+    bool ok = false;
+    int rows = 0;
+
+    {
+        QSqlDatabase db = QSqlDatabase::contains(LOADER_CONNECTION)
+                              ? QSqlDatabase::database(LOADER_CONNECTION)
+                              : QSqlDatabase::addDatabase("QSQLITE", LOADER_CONNECTION);
+        db.setDatabaseName(databaseFile);
+
+        if (!db.open()) {
+            qCWarning(lcStarLoading) << "Error: Unable to open database:" << db.lastError().text();
+            emit finished(generation, false, 0);
+            return;
+        }
+
+        QSqlQuery query(db);
+        query.setForwardOnly(true);
+        if (!query.exec("SELECT MAIN_ID, RA, DEC, PLX_VALUE, x_koord, y_koord, z_koord, SP_TYPE FROM stars")) {
+            qCWarning(lcStarLoading) << "Error: Query failed:" << query.lastError().text();
+        } else {
+            ok = true;
+            QVector<StarRecord> batch;
+            batch.reserve(ROWS_PER_BATCH);
+
+            while (query.next()) {
+                // A newer read has been started, this one is thrown away anyway
+                if (m_generation->loadRelaxed() != generation) {
+                    ok = false;
+                    break;
+                }
+
+                StarRecord star;
+                star.id = query.value(0).toString();
+                star.rightAscension = query.value(1).toDouble();
+                star.declination = query.value(2).toDouble();
+                star.parallax = query.value(3).toDouble();
+                star.position = QVector3D(query.value(4).toFloat(),
+                                          query.value(5).toFloat(),
+                                          query.value(6).toFloat());
+                star.spType = query.value(7).toString();
+
+                star.spectral = SpectralType::parse(star.spType);
+                star.radius = star.spectral.radius();
+                star.color = star.spectral.color();
+
+                batch.append(star);
+                ++rows;
+
+                if (batch.size() == ROWS_PER_BATCH) {
+                    emit batchRead(generation, batch);
+                    batch.clear();
+                    batch.reserve(ROWS_PER_BATCH);
+                }
+            }
+
+            if (ok && !batch.isEmpty())
+                emit batchRead(generation, batch);
+        }
+
+        db.close();
+    }
+
+    emit finished(generation, ok, rows);
+}
@@ -0,0 +1,38 @@
+#ifndef STARCATALOGREADER_H
+#define STARCATALOGREADER_H
+
+#include <QObject>
+#include <QVector>
+#include <QString>
+#include <QAtomicInt>
+#include <QLoggingCategory>
+#include "starcatalog.h"
+
+Q_DECLARE_LOGGING_CATEGORY(lcStarLoading)
+
+/*
+ * Reads the stars table on the loader thread.
+ *
+ * Rows are read with a forward-only query on a connection of its own,
+ * the radius and colour are worked out here, and the records are sent
+ * back in batches. A read stops early when a newer one is started.
+ */
+class StarCatalogReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StarCatalogReader(const QAtomicInt *generation, QObject *parent = nullptr);
+
+    // Read the stars table of this SQLite file
+    void read(const QString &databaseFile, int generation);
+
+signals:
+    void batchRead(int generation, const QVector<StarRecord> &batch);
+    void finished(int generation, bool ok, int rows);
+
+private:
+    const QAtomicInt *m_generation;
+};
+
+#endif // STARCATALOGREADER_H
@@ -0,0 +1,381 @@
+#include "starchunkstore.h"
+#include "starcatalog.h"
+#include "spectraltype.h"
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <limits>
+#include <cstring>
+
+// Bump when the layout below changes
+static const quint32 CHUNK_VERSION = 1;
+static const char CHUNK_MAGIC[4] = { 'A', 'N', 'S', 'K' };
+
+// Written as a number, reads back differently on a machine with the other byte order
+static const quint32 BYTE_ORDER_MARK = 0x01020304;
+
+// Stars per leaf chunk, i.e. per block loaded at full detail
+static const int STARS_PER_LEAF = 4096;
+
+// Points kept in an inner node to stand in for its subtree
+static const int AGGREGATE_POINTS = 512;
+
+// Stars at the same position can't be split, stop dividing somewhere
+static const int MAX_DEPTH = 16;
+
+static const int FLOATS_PER_POINT = StarChunkStore::POINT_STRIDE / sizeof(float);
+
+// The build has its own connection, it may run before the GUI thread's is opened
+static const char *BUILD_CONNECTION = "starsChunkConnection";
+
+struct StarChunkStore::Header
+{
+    char magic[4];
+    quint32 version;
+    quint32 byteOrder;
+    quint32 nodeCount;
+    quint64 pointCount;
+    quint64 fileSize;
+
+    // Byte offsets of the sections, each aligned to 8
+    quint64 nodes;      // ChunkNode per octree node
+    quint64 points;     // POINT_STRIDE bytes per point
+};
+
+struct ChunkNode
+{
+    float minPoint[3];
+    float maxPoint[3];
+    qint32 firstChild;
+    qint32 childCount;
+    quint64 firstPoint;
+    qint32 pointCount;
+    qint32 starCount;
+};
+
+/*
+ * Builds the octree over the stars of a database. Every node covers one
+ * contiguous range of order, its point block is appended to points as
+ * soon as the node is filled in.
+ */
+struct ChunkBuilder
+{
+    QVector<float> stars;   // FLOATS_PER_POINT per star
+    QVector<int> order;
+    QVector<ChunkNode> nodes;
+    QVector<float> points;
+
+    QVector3D position(int star) const
+    {
+        const float *p = stars.constData() + FLOATS_PER_POINT * star;
+        return QVector3D(p[0], p[1], p[2]);
+    }
+
+    void appendPoints(ChunkNode &node, int first, int count, int step)
+    {
+        node.firstPoint = quint64(points.size() / FLOATS_PER_POINT);
+        node.pointCount = 0;
+        for (int i = first; i < first + count; i += step) {
+            const float *p = stars.constData() + FLOATS_PER_POINT * order[i];
+            for (int f = 0; f < FLOATS_PER_POINT; ++f)
+                points.append(p[f]);
+            ++node.pointCount;
+        }
+    }
+
+    void buildNode(int nodeIndex, int first, int count,
+                   const QVector3D &cellMin, const QVector3D &cellMax, int depth)
+    {
+        QVector3D minPoint(std::numeric_limits<float>::max(),
+                           std::numeric_limits<float>::max(),
+                           std::numeric_limits<float>::max());
+        QVector3D maxPoint = -minPoint;
+        for (int i = first; i < first + count; ++i) {
+            const QVector3D p = position(order[i]);
+            const float radius = stars[FLOATS_PER_POINT * order[i] + 3];
+            for (int axis = 0; axis < 3; ++axis) {
+                minPoint[axis] = qMin(minPoint[axis], p[axis] - radius);
+                maxPoint[axis] = qMax(maxPoint[axis], p[axis] + radius);
+            }
+        }
+
+        ChunkNode &node = nodes[nodeIndex];
+        node = ChunkNode{
+            { minPoint.x(), minPoint.y(), minPoint.z() },
+            { maxPoint.x(), maxPoint.y(), maxPoint.z() },
+            -1, 0, 0, 0, count
+        };
+
+        if (count <= STARS_PER_LEAF || depth == MAX_DEPTH) {
+            appendPoints(node, first, count, 1);
+            return;
+        }
+
+        // The range is still in read order here, every step-th star is an even sample
+        const int step = (count + AGGREGATE_POINTS - 1) / AGGREGATE_POINTS;
+        appendPoints(node, first, count, step);
+
+        // Sort the range into the eight octants of the cell
+        const QVector3D center = (cellMin + cellMax) * 0.5f;
+        auto octantOf = [this, &center](int star) {
+            const QVector3D p = position(star);
+            return (p.x() >= center.x() ? 1 : 0) | (p.y() >= center.y() ? 2 : 0) | (p.z() >= center.z() ? 4 : 0);
+        };
+
+        int starts[9] = {};
+        for (int i = first; i < first + count; ++i)
+            ++starts[octantOf(order[i]) + 1];
+        for (int octant = 0; octant < 8; ++octant)
+            starts[octant + 1] += starts[octant];
+
+        const QVector<int> range = order.mid(first, count);
+        int fill[8];
+        std::memcpy(fill, starts, sizeof(fill));
+        for (int star : range)
+            order[first + fill[octantOf(star)]++] = star;
+
+        // All children are appended before any is filled in so they stay adjacent
+        const int firstChild = nodes.size();
+        int childCount = 0;
+        for (int octant = 0; octant < 8; ++octant) {
+            if (starts[octant + 1] > starts[octant]) {
+                nodes.append(ChunkNode());
+                ++childCount;
+            }
+        }
+        nodes[nodeIndex].firstChild = firstChild;
+        nodes[nodeIndex].childCount = childCount;
+
+        int child = firstChild;
+        for (int octant = 0; octant < 8; ++octant) {
+            const int childFirst = first + starts[octant];
+            const int childStars = starts[octant + 1] - starts[octant];
+            if (childStars == 0)
+                continue;
+
+            QVector3D childMin = cellMin;
+            QVector3D childMax = center;
+            for (int axis = 0; axis < 3; ++axis) {
+                if (octant & (1 << axis)) {
+                    childMin[axis] = center[axis];
+                    childMax[axis] = cellMax[axis];
+                }
+            }
+            buildNode(child++, childFirst, childStars, childMin, childMax, depth + 1);
+        }
+    }
+};
+
+StarChunkStore::StarChunkStore(const QString &fileName)
+    : m_file(fileName)
+    , m_data(nullptr)
+    , m_pointsOffset(0)
+{
+}
+
+StarChunkStore::~StarChunkStore()
+{
+    close();
+}
+
+bool StarChunkStore::open()
+{
+    close();
+
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 size = m_file.size();
+    if (size < qint64(sizeof(Header))) {
+        close();
+        return false;
+    }
+
+    uchar *data = m_file.map(0, size);
+    if (!data) {
+        close();
+        return false;
+    }
+    m_data = data;
+
+    const Header &header = *reinterpret_cast<const Header *>(m_data);
+    const quint64 fileSize = quint64(size);
+    bool valid = std::memcmp(header.magic, CHUNK_MAGIC, 4) == 0
+                 && header.version == CHUNK_VERSION
+                 && header.byteOrder == BYTE_ORDER_MARK
+                 && header.nodeCount > 0
+                 && header.fileSize == fileSize
+                 && header.nodes % 8 == 0 && header.points % 8 == 0
+                 && header.nodes <= fileSize
+                 && quint64(header.nodeCount) * sizeof(ChunkNode) <= fileSize - header.nodes
+                 && header.points <= fileSize
+                 && header.pointCount <= (fileSize - header.points) / POINT_STRIDE;
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    const ChunkNode *chunkNodes = reinterpret_cast<const ChunkNode *>(m_data + header.nodes);
+    const int nodeCount = int(header.nodeCount);
+    m_nodes.resize(nodeCount);
+    m_parents.fill(-1, nodeCount);
+    for (int i = 0; i < nodeCount && valid; ++i) {
+        const ChunkNode &chunk = chunkNodes[i];
+        valid = chunk.pointCount >= 0
+                && chunk.firstPoint <= header.pointCount
+                && quint64(chunk.pointCount) <= header.pointCount - chunk.firstPoint
+                && (chunk.firstChild < 0
+                    || (chunk.firstChild > i && chunk.childCount > 0 && chunk.childCount <= 8
+                        && chunk.firstChild + chunk.childCount <= nodeCount));
+        if (!valid)
+            break;
+
+        m_nodes[i] = Node{
+            QVector3D(chunk.minPoint[0], chunk.minPoint[1], chunk.minPoint[2]),
+            QVector3D(chunk.maxPoint[0], chunk.maxPoint[1], chunk.maxPoint[2]),
+            chunk.firstChild, chunk.firstChild < 0 ? 0 : chunk.childCount,
+            chunk.firstPoint, chunk.pointCount, chunk.starCount
+        };
+        for (int child = 0; child < m_nodes[i].childCount; ++child)
+            m_parents[chunk.firstChild + child] = i;
+    }
+
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    m_pointsOffset = header.points;
+    return true;
+}
+
+void StarChunkStore::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar *>(m_data));
+    m_data = nullptr;
+    m_pointsOffset = 0;
+    m_nodes.clear();
+    m_parents.clear();
+    m_file.close();
+}
+
+QByteArray StarChunkStore::readBlock(int node) const
+{
+    if (!m_data || node < 0 || node >= m_nodes.size())
+        return QByteArray();
+
+    // Pages are only read from disk here, on the caller's thread
+    const Node &chunk = m_nodes[node];
+    const char *block = reinterpret_cast<const char *>(m_data + m_pointsOffset + chunk.firstPoint * POINT_STRIDE);
+    return QByteArray(block, qsizetype(blockSize(chunk)));
+}
+
+bool StarChunkStore::build(const QString &databaseFile, const QString &chunkFile)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // SQLite would create an empty database instead of failing
+    if (!QFileInfo::exists(databaseFile)) {
+        qWarning() << "Error: No database at" << databaseFile;
+        return false;
+    }
+
+    ChunkBuilder builder;
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", BUILD_CONNECTION);
+        db.setDatabaseName(databaseFile);
+
+        if (!db.open()) {
+            qWarning() << "Error: Unable to open database:" << db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            if (!query.exec("SELECT x_koord, y_koord, z_koord, SP_TYPE FROM stars")) {
+                qWarning() << "Error: Query failed:" << query.lastError().text();
+            } else {
+                ok = true;
+                while (query.next()) {
+                    const SpectralType spectral = SpectralType::parse(query.value(3).toString());
+                    const QColor color = spectral.color();
+                    const float point[FLOATS_PER_POINT] = {
+                        query.value(0).toFloat() * StarCatalog::SCENE_SCALE,
+                        query.value(1).toFloat() * StarCatalog::SCENE_SCALE,
+                        query.value(2).toFloat() * StarCatalog::SCENE_SCALE,
+                        spectral.radius(),
+                        float(color.redF()), float(color.greenF()), float(color.blueF()),
+                        1.0f
+                    };
+                    for (float value : point)
+                        builder.stars.append(value);
+                }
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(BUILD_CONNECTION);
+
+    const int stars = builder.stars.size() / FLOATS_PER_POINT;
+    if (!ok || stars == 0)
+        return false;
+
+    qInfo() << "read" << stars << "stars in" << timer.elapsed() << "ms";
+
+    // The root cell is a cube, so the octants stay cubes all the way down
+    QVector3D cellMin = builder.position(0);
+    QVector3D cellMax = cellMin;
+    for (int star = 1; star < stars; ++star) {
+        const QVector3D p = builder.position(star);
+        for (int axis = 0; axis < 3; ++axis) {
+            cellMin[axis] = qMin(cellMin[axis], p[axis]);
+            cellMax[axis] = qMax(cellMax[axis], p[axis]);
+        }
+    }
+    const QVector3D extent = cellMax - cellMin;
+    const float side = qMax(extent.x(), qMax(extent.y(), extent.z()));
+    cellMax = cellMin + QVector3D(side, side, side);
+
+    builder.order.resize(stars);
+    for (int star = 0; star < stars; ++star)
+        builder.order[star] = star;
+    builder.points.reserve(builder.stars.size() + builder.stars.size() / 8);
+    builder.nodes.append(ChunkNode());
+    builder.buildNode(0, 0, stars, cellMin, cellMax, 0);
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CHUNK_MAGIC, 4);
+    header.version = CHUNK_VERSION;
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.nodeCount = quint32(builder.nodes.size());
+    header.pointCount = quint64(builder.points.size() / FLOATS_PER_POINT);
+    header.nodes = sizeof(Header);
+    header.points = header.nodes + quint64(builder.nodes.size()) * sizeof(ChunkNode);
+    header.fileSize = header.points + header.pointCount * POINT_STRIDE;
+
+    // Written to a temporary file and renamed, a crash never leaves half a file
+    QSaveFile file(chunkFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not write chunk file:" << file.errorString();
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(reinterpret_cast<const char *>(builder.nodes.constData()),
+               qint64(builder.nodes.size()) * sizeof(ChunkNode));
+    file.write(reinterpret_cast<const char *>(builder.points.constData()),
+               qint64(builder.points.size()) * sizeof(float));
+    if (!file.commit()) {
+        qWarning() << "Could not write chunk file:" << file.errorString();
+        return false;
+    }
+
+    qInfo() << "wrote" << builder.nodes.size() << "chunks for" << stars << "stars to" << chunkFile
+            << "in" << timer.elapsed() << "ms";
+    return true;
+}
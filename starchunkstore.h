@@ -0,0 +1,74 @@
+#ifndef STARCHUNKSTORE_H
+#define STARCHUNKSTORE_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+#include <QVector3D>
+#include <QByteArray>
+
+/*
+ * Star catalog partitioned into octree chunks in one file on disk.
+ *
+ * Catalogs too large to keep in memory (Gaia extracts with millions of
+ * rows) are split once with build(). Every leaf of the octree stores its
+ * stars, every inner node a sample of the stars below it that stands in
+ * for the whole subtree when it is far away. Both are point blocks laid
+ * out like the renderer's star buffer, position and radius followed by
+ * colour and highlight scale, so a block goes to the GPU as it is read.
+ *
+ * Only the node table is copied on open(). The point blocks stay in the
+ * mapped file and readBlock() copies one out, which may be called from
+ * any thread.
+ */
+class StarChunkStore
+{
+public:
+    struct Node {
+        QVector3D minPoint;
+        QVector3D maxPoint;
+        int firstChild;     // Children are stored next to each other, -1 for a leaf
+        int childCount;
+        quint64 firstPoint; // Point block in the file
+        int pointCount;
+        int starCount;      // Stars in the whole subtree
+
+        bool isLeaf() const { return firstChild < 0; }
+    };
+
+    // Bytes per point, the same layout as InstancedStarRenderer's star buffer
+    static const int POINT_STRIDE = 8 * sizeof(float);
+
+    explicit StarChunkStore(const QString &fileName);
+    ~StarChunkStore();
+
+    // Map the file and read the node table, false when it is missing or broken
+    bool open();
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    const QVector<Node> &nodes() const { return m_nodes; }
+    qint64 starCount() const { return m_nodes.isEmpty() ? 0 : m_nodes.first().starCount; }
+
+    // Parent of every node, -1 for the root
+    const QVector<int> &parents() const { return m_parents; }
+
+    // Copy of one node's point block
+    QByteArray readBlock(int node) const;
+
+    static qint64 blockSize(const Node &node) { return qint64(node.pointCount) * POINT_STRIDE; }
+
+    // Partition the stars table of a database into a chunk file
+    static bool build(const QString &databaseFile, const QString &chunkFile);
+
+private:
+    struct Header;
+
+    QFile m_file;
+    const uchar *m_data;
+    quint64 m_pointsOffset;
+    QVector<Node> m_nodes;
+    QVector<int> m_parents;
+};
+
+#endif // STARCHUNKSTORE_H
@@ -0,0 +1,392 @@
+#include "starchunkstreamer.h"
+#include "staroctree.h"
+#include "shadermaterial.h"
+#include <Qt3DCore/QGeometry>
+#include <Qt3DCore/QBuffer>
+#include <Qt3DCore/QAttribute>
+#include <Qt3DCore/QBoundingVolume>
+#include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DRender/QCameraLens>
+#include <Qt3DRender/QParameter>
+#include <Qt3DRender/QPointSize>
+#include <Qt3DLogic/QFrameAction>
+#include <algorithm>
+#include <limits>
+
+Q_LOGGING_CATEGORY(lcStarStreaming, "astronav.streaming", QtInfoMsg)
+
+// Default bytes of point blocks kept resident
+static const qint64 DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+// Default ratio of node size to distance above which a node is opened up
+static const float DEFAULT_DETAIL = 0.5f;
+
+// Blocks asked of the reader at once, the rest wait so they can still be dropped
+static const int MAX_IN_FLIGHT = 4;
+
+static Qt3DCore::QAttribute *createChunkAttribute(const QString &name,
+                                                  int byteOffset,
+                                                  int count,
+                                                  Qt3DCore::QBuffer *buffer,
+                                                  Qt3DCore::QNode *parent)
+{
+    auto *attribute = new Qt3DCore::QAttribute(parent);
+    attribute->setName(name);
+    attribute->setAttributeType(Qt3DCore::QAttribute::VertexAttribute);
+    attribute->setVertexBaseType(Qt3DCore::QAttribute::Float);
+    attribute->setVertexSize(4);
+    attribute->setByteOffset(byteOffset);
+    attribute->setByteStride(StarChunkStore::POINT_STRIDE);
+    attribute->setCount(count);
+    attribute->setBuffer(buffer);
+    return attribute;
+}
+
+StarChunkReader::StarChunkReader(const StarChunkStore *store, QObject *parent)
+    : QObject(parent)
+    , m_store(store)
+{
+}
+
+void StarChunkReader::read(int node)
+{
+    emit blockRead(node, m_store->readBlock(node));
+}
+
+StarChunkStreamer::StarChunkStreamer(const QString &chunkFile, Qt3DCore::QNode *parent)
+    : Qt3DCore::QEntity(parent)
+    , m_store(chunkFile)
+    , m_reader(new StarChunkReader(&m_store))
+    , m_material(nullptr)
+    , m_camera(nullptr)
+    , m_dirty(true)
+    , m_memoryBudget(DEFAULT_MEMORY_BUDGET)
+    , m_residentBytes(0)
+    , m_detail(DEFAULT_DETAIL)
+    , m_frame(0)
+    , m_inFlight(0)
+{
+    if (m_store.open()) {
+        qCInfo(lcStarStreaming) << "streaming" << m_store.starCount() << "stars in"
+                                << m_store.nodes().size() << "chunks from" << chunkFile;
+    } else {
+        qCWarning(lcStarStreaming) << "Could not open chunk file" << chunkFile;
+    }
+
+    m_reader->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_reader, &QObject::deleteLater);
+    connect(m_reader, &StarChunkReader::blockRead, this, &StarChunkStreamer::onBlockRead);
+    m_thread.setObjectName("StarChunkStreamer");
+    m_thread.start();
+
+    // Same point sprite impostors as the renderer's far batch
+    auto *pointSize = new Qt3DRender::QPointSize();
+    pointSize->setSizeMode(Qt3DRender::QPointSize::Programmable);
+    m_material = createShaderMaterial(QStringLiteral("qrc:/shaders/starimpostor.vert"),
+                                      QStringLiteral("qrc:/shaders/starimpostor.frag"),
+                                      { pointSize }, this);
+
+    // There is no sphere batch for streamed stars, every one is an impostor
+    m_material->addParameter(new Qt3DRender::QParameter(QStringLiteral("nearDistance"), 0.0f));
+
+    // Camera moves only mark the selection dirty, it is made once per frame
+    Qt3DLogic::QFrameAction *frameAction = new Qt3DLogic::QFrameAction();
+    connect(frameAction, &Qt3DLogic::QFrameAction::triggered, this, &StarChunkStreamer::onFrame);
+    addComponent(frameAction);
+}
+
+StarChunkStreamer::~StarChunkStreamer()
+{
+    // Reads still queued are dropped with the event loop
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void StarChunkStreamer::setCamera(Qt3DRender::QCamera *camera)
+{
+    if (m_camera) {
+        disconnect(m_camera, nullptr, this, nullptr);
+        disconnect(m_camera->lens(), nullptr, this, nullptr);
+    }
+
+    m_camera = camera;
+    m_dirty = true;
+    if (!m_camera)
+        return;
+
+    connect(m_camera, &Qt3DRender::QCamera::positionChanged, this, [this]() { m_dirty = true; });
+    connect(m_camera, &Qt3DRender::QCamera::viewCenterChanged, this, [this]() { m_dirty = true; });
+    connect(m_camera, &Qt3DRender::QCamera::upVectorChanged, this, [this]() { m_dirty = true; });
+    connect(m_camera->lens(), &Qt3DRender::QCameraLens::projectionMatrixChanged, this, [this]() { m_dirty = true; });
+}
+
+void StarChunkStreamer::setMemoryBudget(qint64 bytes)
+{
+    m_memoryBudget = bytes;
+    evict();
+}
+
+void StarChunkStreamer::setDetail(float detail)
+{
+    m_detail = detail;
+    m_dirty = true;
+}
+
+float StarChunkStreamer::distanceTo(int node, const QVector3D &position) const
+{
+    const StarChunkStore::Node &chunk = m_store.nodes().at(node);
+    QVector3D outside;
+    for (int axis = 0; axis < 3; ++axis)
+        outside[axis] = qMax(qMax(chunk.minPoint[axis] - position[axis], 0.0f), position[axis] - chunk.maxPoint[axis]);
+    return outside.length();
+}
+
+/*
+ * Walks the octree from the root and collects the nodes to draw from the
+ * eye position, nearest first. A node is opened up while it is larger
+ * than the detail ratio times its distance, so the chunks get coarser
+ * further away. With cull set, nodes outside the camera frustum are left
+ * out as well.
+ */
+void StarChunkStreamer::selectNodes(const QVector3D &eye, bool cull, QVector<int> &selected) const
+{
+    const QVector<StarChunkStore::Node> &nodes = m_store.nodes();
+    if (nodes.isEmpty())
+        return;
+
+    StarFrustum frustum;
+    if (cull)
+        frustum = StarFrustum(m_camera->lens()->projectionMatrix() * m_camera->viewMatrix());
+
+    QVector<int> stack;
+    stack.append(0);
+    while (!stack.isEmpty()) {
+        const int index = stack.takeLast();
+        const StarChunkStore::Node &node = nodes[index];
+        if (cull && frustum.classify(node.minPoint, node.maxPoint) == StarFrustum::Outside)
+            continue;
+
+        const float size = (node.maxPoint - node.minPoint).length();
+        if (node.isLeaf() || size < m_detail * distanceTo(index, eye)) {
+            selected.append(index);
+            continue;
+        }
+
+        for (int child = 0; child < node.childCount; ++child)
+            stack.append(node.firstChild + child);
+    }
+
+    std::sort(selected.begin(), selected.end(), [this, &eye](int a, int b) {
+        return distanceTo(a, eye) < distanceTo(b, eye);
+    });
+}
+
+void StarChunkStreamer::updateSelection()
+{
+    QVector<int> selected;
+    selectNodes(m_camera->position(), true, selected);
+
+    m_wanted = QSet<int>(selected.begin(), selected.end());
+
+    // Prefetched blocks the camera has reached are ordinary ones again
+    m_prefetched.subtract(m_wanted);
+
+    const QVector<int> &parents = m_store.parents();
+    QSet<int> shown;
+    for (int index : selected) {
+        if (m_resident.contains(index)) {
+            shown.insert(index);
+            continue;
+        }
+
+        request(index, false);
+
+        // Draw the nearest resident ancestor until the block is here
+        int parent = parents[index];
+        while (parent >= 0 && !m_resident.contains(parent))
+            parent = parents[parent];
+        if (parent >= 0)
+            shown.insert(parent);
+    }
+
+    for (int index : std::as_const(m_shown)) {
+        if (!shown.contains(index) && m_resident.contains(index))
+            m_resident[index].entity->setEnabled(false);
+    }
+    for (int index : std::as_const(shown)) {
+        Chunk &chunk = m_resident[index];
+        chunk.entity->setEnabled(true);
+        chunk.lastUsed = m_frame;
+    }
+    m_shown = shown;
+
+    qCDebug(lcStarStreaming) << selected.size() << "chunks selected," << m_shown.size() << "drawn,"
+                             << m_queue.size() << "queued," << m_residentBytes / 1024 << "kB resident";
+}
+
+bool StarChunkStreamer::request(int node, bool urgent)
+{
+    if (m_resident.contains(node) || m_requested.contains(node))
+        return false;
+
+    m_requested.insert(node);
+    if (urgent)
+        m_queue.prepend(node);
+    else
+        m_queue.append(node);
+    return true;
+}
+
+void StarChunkStreamer::prefetch(const QVector3D &position)
+{
+    if (!isOpen())
+        return;
+
+    // Everything around the destination, the camera may end up facing any way
+    QVector<int> selected;
+    selectNodes(position, false, selected);
+
+    m_prefetched.clear();
+    QVector<int> missing;
+    qint64 bytes = 0;
+    for (int index : selected) {
+        // Leave room for what the camera sees on the way
+        bytes += StarChunkStore::blockSize(m_store.nodes().at(index));
+        if (bytes > m_memoryBudget / 2)
+            break;
+
+        m_prefetched.insert(index);
+        if (m_resident.contains(index))
+            m_resident[index].lastUsed = m_frame;
+        else
+            missing.append(index);
+    }
+
+    // Ahead of the blocks the camera asked for on its way, queued from the back
+    // so the nearest ends up first
+    int queued = 0;
+    for (auto it = missing.crbegin(); it != missing.crend(); ++it) {
+        if (request(*it, true))
+            ++queued;
+    }
+    dispatch();
+
+    qCInfo(lcStarStreaming) << "prefetching" << queued << "chunks around" << position;
+}
+
+void StarChunkStreamer::dispatch()
+{
+    while (m_inFlight < MAX_IN_FLIGHT && !m_queue.isEmpty()) {
+        const int node = m_queue.takeFirst();
+
+        // The camera moved on before the block was asked for
+        if (!m_wanted.contains(node) && !m_prefetched.contains(node)) {
+            m_requested.remove(node);
+            continue;
+        }
+
+        ++m_inFlight;
+        StarChunkReader *reader = m_reader;
+        QMetaObject::invokeMethod(reader, [reader, node]() {
+            reader->read(node);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void StarChunkStreamer::onBlockRead(int node, const QByteArray &block)
+{
+    --m_inFlight;
+    m_requested.remove(node);
+
+    if (m_wanted.contains(node) || m_prefetched.contains(node)) {
+        addChunk(node, block);
+        evict();
+
+        // The block can take over from its ancestor now
+        m_dirty = true;
+        emit residencyChanged(m_resident.size(), m_residentBytes);
+    }
+
+    dispatch();
+}
+
+void StarChunkStreamer::addChunk(int node, const QByteArray &block)
+{
+    const StarChunkStore::Node &chunk = m_store.nodes().at(node);
+    const int points = int(block.size() / StarChunkStore::POINT_STRIDE);
+
+    auto *entity = new Qt3DCore::QEntity(this);
+    entity->setEnabled(false);
+
+    auto *geometry = new Qt3DCore::QGeometry(entity);
+    auto *buffer = new Qt3DCore::QBuffer(geometry);
+    buffer->setData(block);
+    geometry->addAttribute(createChunkAttribute(QStringLiteral("starPosition"), 0, points, buffer, geometry));
+    geometry->addAttribute(createChunkAttribute(QStringLiteral("starColor"), 4 * sizeof(float), points, buffer, geometry));
+
+    auto *mesh = new Qt3DRender::QGeometryRenderer();
+    mesh->setGeometry(geometry);
+    mesh->setPrimitiveType(Qt3DRender::QGeometryRenderer::Points);
+    mesh->setVertexCount(points);
+
+    // The points have no vertexPosition, the node bounds are given instead
+    auto *bounds = new Qt3DCore::QBoundingVolume(entity);
+    bounds->setMinPoint(chunk.minPoint);
+    bounds->setMaxPoint(chunk.maxPoint);
+
+    entity->addComponent(mesh);
+    entity->addComponent(bounds);
+    entity->addComponent(m_material);
+
+    m_resident.insert(node, Chunk{ entity, block.size(), m_frame });
+    m_residentBytes += block.size();
+}
+
+/*
+ * Drops resident blocks until they fit in the memory budget, the one
+ * used longest ago first and prefetched ones last. Blocks drawn or
+ * wanted right now are kept even over the budget.
+ */
+void StarChunkStreamer::evict()
+{
+    while (m_residentBytes > m_memoryBudget) {
+        int victim = -1;
+        bool victimPrefetched = true;
+        qint64 oldest = std::numeric_limits<qint64>::max();
+        for (auto it = m_resident.cbegin(); it != m_resident.cend(); ++it) {
+            if (m_shown.contains(it.key()) || m_wanted.contains(it.key()))
+                continue;
+
+            const bool prefetched = m_prefetched.contains(it.key());
+            if (victim < 0 || (victimPrefetched && !prefetched)
+                || (prefetched == victimPrefetched && it->lastUsed < oldest)) {
+                victim = it.key();
+                victimPrefetched = prefetched;
+                oldest = it->lastUsed;
+            }
+        }
+
+        if (victim < 0) {
+            qCDebug(lcStarStreaming) << "the chunks in view alone take" << m_residentBytes / 1024
+                                     << "kB, over the budget";
+            break;
+        }
+
+        const Chunk chunk = m_resident.take(victim);
+        delete chunk.entity;
+        m_residentBytes -= chunk.bytes;
+        m_prefetched.remove(victim);
+    }
+}
+
+void StarChunkStreamer::onFrame(float dt)
+{
+    Q_UNUSED(dt);
+
+    ++m_frame;
+    if (m_dirty && m_camera && isOpen()) {
+        m_dirty = false;
+        updateSelection();
+    }
+    dispatch();
+}
@@ -0,0 +1,135 @@
+#ifndef STARCHUNKSTREAMER_H
+#define STARCHUNKSTREAMER_H
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QVector3D>
+#include <QByteArray>
+#include <QLoggingCategory>
+#include <Qt3DCore/QEntity>
+#include <Qt3DRender/QCamera>
+#include <Qt3DRender/QMaterial>
+#include "starchunkstore.h"
+
+Q_DECLARE_LOGGING_CATEGORY(lcStarStreaming)
+
+/*
+ * Copies point blocks out of a StarChunkStore on the streaming thread.
+ */
+class StarChunkReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StarChunkReader(const StarChunkStore *store, QObject *parent = nullptr);
+
+    void read(int node);
+
+signals:
+    void blockRead(int node, const QByteArray &block);
+
+private:
+    const StarChunkStore *m_store;
+};
+
+/*
+ * Draws a chunked catalog that doesn't fit in memory.
+ *
+ * Once per frame after the camera moved, the octree of the chunk file
+ * is walked from the root. A node that looks small from the camera, or
+ * a leaf, is drawn from its own point block: the leaf with all its
+ * stars, an inner node with the sample that stands in for its subtree.
+ * Blocks not yet resident are read on a worker thread, nearest first,
+ * and until one arrives its closest resident ancestor is drawn instead.
+ *
+ * Every resident block is one point entity with the star impostor
+ * material. When the blocks take more than the memory budget the ones
+ * used longest ago are dropped, never those drawn in the current frame.
+ *
+ * prefetch() asks for the blocks seen from a position the camera is
+ * about to fly to, so they are resident when it gets there.
+ */
+class StarChunkStreamer : public Qt3DCore::QEntity
+{
+    Q_OBJECT
+
+public:
+    explicit StarChunkStreamer(const QString &chunkFile, Qt3DCore::QNode *parent = nullptr);
+    ~StarChunkStreamer();
+
+    // False when the chunk file couldn't be opened, nothing is drawn then
+    bool isOpen() const { return m_store.isOpen(); }
+    qint64 starCount() const { return m_store.starCount(); }
+
+    // Follow this camera and choose the blocks again when it moves
+    void setCamera(Qt3DRender::QCamera *camera);
+
+    // Bytes of point blocks kept resident
+    void setMemoryBudget(qint64 bytes);
+    qint64 memoryBudget() const { return m_memoryBudget; }
+    qint64 residentBytes() const { return m_residentBytes; }
+    int residentCount() const { return m_resident.size(); }
+
+    // A node is opened up when its size is more than this times its distance
+    void setDetail(float detail);
+    float detail() const { return m_detail; }
+
+public slots:
+    // Load the blocks seen from this position ahead of the camera
+    void prefetch(const QVector3D &position);
+
+signals:
+    void residencyChanged(int chunks, qint64 bytes);
+
+private slots:
+    void onBlockRead(int node, const QByteArray &block);
+    void onFrame(float dt);
+
+private:
+    struct Chunk {
+        Qt3DCore::QEntity *entity;
+        qint64 bytes;
+        qint64 lastUsed;
+    };
+
+    void selectNodes(const QVector3D &eye, bool cull, QVector<int> &selected) const;
+    float distanceTo(int node, const QVector3D &position) const;
+    void updateSelection();
+    // Queue a block that isn't resident or asked for yet, urgent ones go first.
+    // False when there was nothing to queue.
+    bool request(int node, bool urgent);
+    void dispatch();
+    void addChunk(int node, const QByteArray &block);
+    void evict();
+
+    StarChunkStore m_store;
+
+    QThread m_thread;
+    StarChunkReader *m_reader;
+
+    Qt3DRender::QMaterial *m_material;
+    Qt3DRender::QCamera *m_camera;
+    bool m_dirty;
+
+    qint64 m_memoryBudget;
+    qint64 m_residentBytes;
+    float m_detail;
+    qint64 m_frame;
+
+    QHash<int, Chunk> m_resident;
+    QSet<int> m_shown;
+
+    // Blocks wanted by the last selection and by the last prefetch
+    QSet<int> m_wanted;
+    QSet<int> m_prefetched;
+
+    // Blocks waiting to be sent to the reader, and those sent and not back yet
+    QVector<int> m_queue;
+    QSet<int> m_requested;
+    int m_inFlight;
+};
+
+#endif // STARCHUNKSTREAMER_H
@@ -0,0 +1,158 @@
+#include "staridindex.h"
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+// Entries complete() ranks at most, a one letter prefix matches most of the catalog
+static const int MAX_COMPLETE_SCAN = 4096;
+
+// Compares key a with b, as memcmp but shorter first when one is a prefix of the other
+static int compareKeys(const char *a, int aLength, const char *b, int bLength)
+{
+    const int common = qMin(aLength, bLength);
+    const int result = common ? std::memcmp(a, b, size_t(common)) : 0;
+    if (result != 0)
+        return result;
+    return aLength - bLength;
+}
+
+QByteArray StarIdIndex::normalized(const QString &id)
+{
+    // Katalognamn är nästan alltid ASCII, den vägen slipper temporära strängar
+    QByteArray key;
+    key.reserve(id.size());
+    for (QChar c : id) {
+        const char16_t unicode = c.unicode();
+        if (unicode >= 0x80) {
+            // Annars samma sak med Qt:s case folding
+            QString folded;
+            for (QChar f : id.toCaseFolded()) {
+                if (!f.isSpace())
+                    folded.append(f);
+            }
+            return folded.toUtf8();
+        }
+        if (c.isSpace())
+            continue;
+        key.append(char(unicode >= 'A' && unicode <= 'Z' ? unicode + ('a' - 'A') : unicode));
+    }
+    return key;
+}
+
+void StarIdIndex::build(const QVector<QString> &ids)
+{
+    const int stars = ids.size();
+
+    // Keys in row order first
+    QByteArray keys;
+    keys.reserve(stars * 16);
+    QVector<quint32> offsets(stars + 1);
+    for (int row = 0; row < stars; ++row) {
+        offsets[row] = quint32(keys.size());
+        keys.append(normalized(ids[row]));
+    }
+    offsets[stars] = quint32(keys.size());
+
+    QVector<qint32> order(stars);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&keys, &offsets](qint32 a, qint32 b) {
+        return compareKeys(keys.constData() + offsets[a], int(offsets[a + 1] - offsets[a]),
+                           keys.constData() + offsets[b], int(offsets[b + 1] - offsets[b])) < 0;
+    });
+
+    // Then laid out in sorted order
+    m_keys.clear();
+    m_keys.reserve(keys.size());
+    m_offsets.resize(stars + 1);
+    for (int entry = 0; entry < stars; ++entry) {
+        const qint32 row = order[entry];
+        m_offsets[entry] = quint32(m_keys.size());
+        m_keys.append(keys.constData() + offsets[row], int(offsets[row + 1] - offsets[row]));
+    }
+    m_offsets[stars] = quint32(m_keys.size());
+    m_rows = order;
+}
+
+void StarIdIndex::clear()
+{
+    m_keys.clear();
+    m_offsets.clear();
+    m_rows.clear();
+}
+
+std::pair<int, int> StarIdIndex::range(const QByteArray &key) const
+{
+    const char *keys = m_keys.constData();
+    const int length = key.size();
+
+    // Entries before the range sort below the key
+    int low = 0;
+    int high = count();
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        if (compareKeys(keys + m_offsets[middle], keyLength(middle), key.constData(), length) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    const int first = low;
+
+    // Entries in the range start with the key, compare only that far
+    high = count();
+    while (low < high) {
+        const int middle = low + (high - low) / 2;
+        if (compareKeys(keys + m_offsets[middle], qMin(keyLength(middle), length), key.constData(), length) <= 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return { first, low };
+}
+
+QVector<int> StarIdIndex::complete(const QString &prefix, int count) const
+{
+    QVector<int> rows;
+    const QByteArray key = normalized(prefix);
+    if (key.isEmpty() || count <= 0)
+        return rows;
+
+    const auto [first, end] = range(key);
+    const int last = first + qMin(end - first, qMax(count, MAX_COMPLETE_SCAN));
+
+    // The count shortest keys, a small sorted list instead of sorting the whole range
+    QVector<int> best;
+    best.reserve(count + 1);
+    for (int entry = first; entry < last; ++entry) {
+        const int length = keyLength(entry);
+        if (best.size() == count) {
+            // Nothing can be shorter than an exact match
+            if (keyLength(best.last()) == key.size())
+                break;
+            if (length >= keyLength(best.last()))
+                continue;
+        }
+
+        auto position = std::upper_bound(best.begin(), best.end(), length, [this](int value, int other) {
+            return value < keyLength(other);
+        });
+        best.insert(position, entry);
+        if (best.size() > count)
+            best.removeLast();
+    }
+
+    rows.reserve(best.size());
+    for (int entry : std::as_const(best))
+        rows.append(m_rows[entry]);
+    return rows;
+}
+
+int StarIdIndex::find(const QString &id) const
+{
+    const QByteArray key = normalized(id);
+    if (key.isEmpty())
+        return -1;
+
+    // An exact match sorts first in its range
+    const auto [first, last] = range(key);
+    return first < last && keyLength(first) == key.size() ? m_rows[first] : -1;
+}
@@ -0,0 +1,56 @@
+#ifndef STARIDINDEX_H
+#define STARIDINDEX_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <utility>
+
+/*
+ * Sorted prefix index over the MAIN_IDs, for search-as-you-type.
+ *
+ * Every id is reduced to a key: case folded, whitespace removed, UTF-8.
+ * The keys are sorted and stored back to back in one buffer, so the ids
+ * starting with a typed prefix are one contiguous range found by two
+ * binary searches. "ucac4532" finds "UCAC4 532-042733".
+ *
+ * Building sorts every id and takes a while at a million stars, it is
+ * meant to run off the GUI thread. Lookups only read.
+ *
+ * Part of astronav_core.
+ */
+class StarIdIndex
+{
+public:
+    // Index the ids, the position in the vector is the row
+    void build(const QVector<QString> &ids);
+    void clear();
+
+    int count() const { return m_rows.size(); }
+    bool isEmpty() const { return m_rows.isEmpty(); }
+
+    // Up to count rows whose id starts with prefix. An exact match comes
+    // first, then shorter ids before longer ones, then in sorted order.
+    // Only the first few thousand matches in sorted order are ranked, so
+    // a short prefix costs no more than a long one.
+    QVector<int> complete(const QString &prefix, int count) const;
+
+    // Row of the id that equals id apart from case and whitespace, or -1
+    int find(const QString &id) const;
+
+    // The key an id is indexed and looked up by
+    static QByteArray normalized(const QString &id);
+
+private:
+    // Entries whose key starts with key, [first, last)
+    std::pair<int, int> range(const QByteArray &key) const;
+
+    int keyLength(int entry) const { return int(m_offsets[entry + 1] - m_offsets[entry]); }
+
+    // Keys in sorted order, entry i is m_keys[m_offsets[i] .. m_offsets[i + 1])
+    QByteArray m_keys;
+    QVector<quint32> m_offsets;
+    QVector<qint32> m_rows;
+};
+
+#endif // STARIDINDEX_H
@@ -0,0 +1,362 @@
+#include "starlabelrenderer.h"
+#include "shadermaterial.h"
+#include "perfmonitor.h"
+#include <Qt3DCore/QGeometry>
+#include <Qt3DRender/QCameraLens>
+#include <Qt3DRender/QMaterial>
+#include <Qt3DRender/QParameter>
+#include <Qt3DRender/QTexture>
+#include <Qt3DRender/QBlendEquation>
+#include <Qt3DRender/QBlendEquationArguments>
+#include <Qt3DRender/QNoDepthMask>
+#include <Qt3DLogic/QFrameAction>
+#include <algorithm>
+
+// Per-vertex layout: vec3 anchor, vec2 glyph offset, vec2 texture coordinate
+static const int FLOATS_PER_VERTEX = 7;
+static const int VERTEX_STRIDE = FLOATS_PER_VERTEX * sizeof(float);
+
+// Height of a line of label text in scene units, like the old 8 pt QText2DEntity labels
+static const float LABEL_HEIGHT = 11.0f;
+
+// Labels sit a bit above their star
+static const QVector3D LABEL_OFFSET(0.0f, 1.0f, 0.0f);
+
+// Glyphs are rasterised larger than they are drawn to stay sharp up close
+static const int ATLAS_PIXEL_SIZE = 32;
+
+// Laid out labels kept around for reuse
+static const int LABEL_POOL_SIZE = 256;
+
+static QFont labelFont()
+{
+    QFont font(QStringLiteral("Arial"));
+    font.setBold(true);
+    font.setPixelSize(ATLAS_PIXEL_SIZE);
+    return font;
+}
+
+static Qt3DCore::QAttribute *createLabelAttribute(const QString &name,
+                                                  int vertexSize,
+                                                  int byteOffset,
+                                                  Qt3DCore::QBuffer *buffer,
+                                                  Qt3DCore::QNode *parent)
+{
+    auto *attribute = new Qt3DCore::QAttribute(parent);
+    attribute->setName(name);
+    attribute->setAttributeType(Qt3DCore::QAttribute::VertexAttribute);
+    attribute->setVertexBaseType(Qt3DCore::QAttribute::Float);
+    attribute->setVertexSize(vertexSize);
+    attribute->setByteOffset(byteOffset);
+    attribute->setByteStride(VERTEX_STRIDE);
+    attribute->setBuffer(buffer);
+    return attribute;
+}
+
+StarLabelRenderer::StarLabelRenderer(const InstancedStarRenderer *starRenderer,
+                                     Qt3DCore::QNode *parent)
+    : Qt3DCore::QEntity(parent)
+    , m_starRenderer(starRenderer)
+    , m_projection(nullptr)
+    , m_camera(nullptr)
+    , m_labelRadius(0.0f)
+    , m_layouts(LABEL_POOL_SIZE)
+    , m_dirty(false)
+    , m_contentChanged(false)
+{
+    auto *geometry = new Qt3DCore::QGeometry(this);
+    m_vertexBuffer = new Qt3DCore::QBuffer(geometry);
+    m_anchorAttribute = createLabelAttribute(QStringLiteral("labelAnchor"), 3, 0,
+                                             m_vertexBuffer, geometry);
+    m_offsetAttribute = createLabelAttribute(QStringLiteral("glyphOffset"), 2, 3 * sizeof(float),
+                                             m_vertexBuffer, geometry);
+    m_texCoordAttribute = createLabelAttribute(QStringLiteral("glyphTexCoord"), 2, 5 * sizeof(float),
+                                               m_vertexBuffer, geometry);
+    geometry->addAttribute(m_anchorAttribute);
+    geometry->addAttribute(m_offsetAttribute);
+    geometry->addAttribute(m_texCoordAttribute);
+
+    m_mesh = new Qt3DRender::QGeometryRenderer();
+    m_mesh->setGeometry(geometry);
+    m_mesh->setPrimitiveType(Qt3DRender::QGeometryRenderer::Triangles);
+    m_mesh->setVertexCount(0);
+
+    m_bounds = new Qt3DCore::QBoundingVolume();
+
+    // Transparent text drawn over the scene without writing depth
+    auto *blendEquation = new Qt3DRender::QBlendEquation();
+    blendEquation->setBlendFunction(Qt3DRender::QBlendEquation::Add);
+    auto *blendArguments = new Qt3DRender::QBlendEquationArguments();
+    blendArguments->setSourceRgba(Qt3DRender::QBlendEquationArguments::SourceAlpha);
+    blendArguments->setDestinationRgba(Qt3DRender::QBlendEquationArguments::OneMinusSourceAlpha);
+
+    Qt3DRender::QMaterial *material =
+        createShaderMaterial(QStringLiteral("qrc:/shaders/starlabel.vert"),
+                             QStringLiteral("qrc:/shaders/starlabel.frag"),
+                             { blendEquation, blendArguments, new Qt3DRender::QNoDepthMask() },
+                             this);
+
+    // One atlas for all labels, glyphs are added the first time a label uses them
+    auto *atlasTexture = new Qt3DRender::QTexture2D(material);
+    atlasTexture->setMinificationFilter(Qt3DRender::QAbstractTexture::Linear);
+    atlasTexture->setMagnificationFilter(Qt3DRender::QAbstractTexture::Linear);
+    m_atlas = new GlyphAtlas(labelFont(), 512, atlasTexture);
+    atlasTexture->addTextureImage(m_atlas);
+
+    QColor labelColor(173, 216, 230); // ljus blå för texten
+    labelColor.setAlpha(127); // gör texten transparent
+
+    material->addParameter(new Qt3DRender::QParameter(QStringLiteral("glyphAtlas"), atlasTexture));
+    material->addParameter(new Qt3DRender::QParameter(QStringLiteral("labelColor"), labelColor));
+
+    addComponent(m_mesh);
+    addComponent(m_bounds);
+    addComponent(material);
+
+    // Shown labels and camera moves only mark the buffer dirty, it is rebuilt once per frame
+    Qt3DLogic::QFrameAction *frameAction = new Qt3DLogic::QFrameAction();
+    connect(frameAction, &Qt3DLogic::QFrameAction::triggered, this, [this](float) {
+        if (m_dirty) {
+            PerfTimer timer(PerfMonitor::Labels);
+            rebuild();
+        }
+    });
+    addComponent(frameAction);
+
+    // Stars may have moved, the anchors in the buffer are written again
+    connect(m_starRenderer, &InstancedStarRenderer::committed, this, [this]() {
+        m_contentChanged = true;
+        m_dirty = true;
+    });
+}
+
+void StarLabelRenderer::setLabelTexts(const QVector<QString> &texts)
+{
+    m_texts = texts;
+    m_layouts.clear();
+    m_contentChanged = true;
+    m_dirty = true;
+}
+
+void StarLabelRenderer::appendLabelTexts(const QVector<QString> &texts)
+{
+    m_texts += texts;
+    m_dirty = true;
+}
+
+void StarLabelRenderer::setLabelText(int index, const QString &text)
+{
+    if (index < 0 || index >= m_texts.size() || m_texts[index] == text)
+        return;
+
+    m_texts[index] = text;
+    m_layouts.remove(index);
+    m_contentChanged = true;
+    m_dirty = true;
+}
+
+void StarLabelRenderer::clear()
+{
+    m_texts.clear();
+    m_shownLabels.clear();
+    m_layouts.clear();
+    m_contentChanged = true;
+    m_dirty = true;
+}
+
+void StarLabelRenderer::showLabel(int index)
+{
+    if (index < 0 || m_shownLabels.contains(index))
+        return;
+
+    m_shownLabels.insert(index);
+    m_contentChanged = true;
+    m_dirty = true;
+}
+
+void StarLabelRenderer::hideLabel(int index)
+{
+    if (!m_shownLabels.remove(index))
+        return;
+
+    m_contentChanged = true;
+    m_dirty = true;
+}
+
+void StarLabelRenderer::setLabelRadius(float radius)
+{
+    if (m_labelRadius == radius)
+        return;
+
+    m_labelRadius = radius;
+    m_dirty = true;
+}
+
+void StarLabelRenderer::setCamera(Qt3DRender::QCamera *camera)
+{
+    if (m_camera) {
+        disconnect(m_camera, nullptr, this, nullptr);
+        disconnect(m_camera->lens(), nullptr, this, nullptr);
+    }
+
+    m_camera = camera;
+    if (!m_camera)
+        return;
+
+    connect(m_camera, &Qt3DRender::QCamera::positionChanged, this, &StarLabelRenderer::markDirty);
+    connect(m_camera, &Qt3DRender::QCamera::viewCenterChanged, this, &StarLabelRenderer::markDirty);
+    connect(m_camera, &Qt3DRender::QCamera::upVectorChanged, this, &StarLabelRenderer::markDirty);
+    connect(m_camera->lens(), &Qt3DRender::QCameraLens::projectionMatrixChanged, this, &StarLabelRenderer::markDirty);
+    m_dirty = true;
+}
+
+void StarLabelRenderer::setProjection(const StarProjection *projection)
+{
+    if (m_projection)
+        disconnect(m_projection, nullptr, this, nullptr);
+
+    m_projection = projection;
+    if (m_projection)
+        connect(m_projection, &StarProjection::updated, this, &StarLabelRenderer::markDirty);
+    m_dirty = true;
+}
+
+// A camera move can only change which labels are in range and inside the frustum
+void StarLabelRenderer::markDirty()
+{
+    if (!m_shownLabels.isEmpty() || m_labelRadius > 0.0f)
+        m_dirty = true;
+}
+
+void StarLabelRenderer::rebuild()
+{
+    m_dirty = false;
+
+    m_visibleLabels.clear();
+
+    StarFrustum frustum;
+    if (m_camera)
+        frustum = StarFrustum(m_camera->lens()->projectionMatrix() * m_camera->viewMatrix());
+
+    // A label is never wider than its character count times the line height
+    auto inView = [this, &frustum](int index) {
+        const float extent = m_texts[index].size() * LABEL_HEIGHT;
+        return !m_camera || frustum.intersectsSphere(m_starRenderer->position(index) + LABEL_OFFSET, extent);
+    };
+
+    for (int index : std::as_const(m_shownLabels)) {
+        if (index < m_texts.size() && index < m_starRenderer->count() && inView(index))
+            m_visibleLabels.append(index);
+    }
+
+    // Visible stars inside the label radius, the octree hands out the
+    // nodes around the camera and the projection pass decides per star
+    if (m_projection && m_camera && m_labelRadius > 0.0f) {
+        const int stars = qMin(m_projection->count(), int(m_texts.size()));
+        auto consider = [this, stars, &inView](int index) {
+            if (index < stars && m_projection->isVisible(index) &&
+                m_projection->distance(index) < m_labelRadius &&
+                !m_shownLabels.contains(index) && inView(index)) {
+                m_visibleLabels.append(index);
+            }
+        };
+
+        const StarOctree &octree = m_starRenderer->octree();
+        octree.forEachInSphere(m_camera->position(), m_labelRadius, consider);
+
+        // Stars added since the last commit are not in the octree yet
+        for (int index = octree.starCount(); index < stars; ++index)
+            consider(index);
+    }
+    std::sort(m_visibleLabels.begin(), m_visibleLabels.end());
+
+    if (!m_contentChanged && m_visibleLabels == m_drawnLabels)
+        return;
+
+    m_contentChanged = false;
+    m_drawnLabels = m_visibleLabels;
+
+    m_vertexData.clear();
+    QVector3D minPoint, maxPoint;
+    for (int i = 0; i < m_drawnLabels.size(); ++i) {
+        const int index = m_drawnLabels[i];
+
+        // Lay the label out on first use, the pool drops the least recently used one
+        const QByteArray *layout = m_layouts.object(index);
+        if (!layout) {
+            auto *created = new QByteArray(layoutLabel(index));
+            m_layouts.insert(index, created);
+            layout = created;
+        }
+        const QVector3D anchor = m_starRenderer->position(index) + LABEL_OFFSET;
+        const int first = m_vertexData.size();
+        m_vertexData.append(*layout);
+        for (int offset = first; offset < m_vertexData.size(); offset += VERTEX_STRIDE) {
+            float *vertex = reinterpret_cast<float *>(m_vertexData.data() + offset);
+            vertex[0] = anchor.x();
+            vertex[1] = anchor.y();
+            vertex[2] = anchor.z();
+        }
+
+        const float extent = m_texts[index].size() * LABEL_HEIGHT;
+        const QVector3D low = anchor - QVector3D(extent, extent, extent);
+        const QVector3D high = anchor + QVector3D(extent, extent, extent);
+        if (i == 0) {
+            minPoint = low;
+            maxPoint = high;
+            continue;
+        }
+        minPoint = QVector3D(qMin(minPoint.x(), low.x()), qMin(minPoint.y(), low.y()), qMin(minPoint.z(), low.z()));
+        maxPoint = QVector3D(qMax(maxPoint.x(), high.x()), qMax(maxPoint.y(), high.y()), qMax(maxPoint.z(), high.z()));
+    }
+
+    const int vertices = m_vertexData.size() / VERTEX_STRIDE;
+    m_vertexBuffer->setData(m_vertexData);
+    m_anchorAttribute->setCount(vertices);
+    m_offsetAttribute->setCount(vertices);
+    m_texCoordAttribute->setCount(vertices);
+    m_mesh->setVertexCount(vertices);
+    m_bounds->setMinPoint(minPoint);
+    m_bounds->setMaxPoint(maxPoint);
+}
+
+// Two triangles per glyph, laid out left to right from the label origin.
+// The anchor is left at zero, rebuild() writes the star's position there.
+QByteArray StarLabelRenderer::layoutLabel(int index)
+{
+    QByteArray vertices;
+    const float unitsPerPixel = LABEL_HEIGHT / m_atlas->lineHeight();
+
+    float pen = 0.0f;
+    for (QChar character : m_texts[index]) {
+        const GlyphAtlas::Glyph &glyph = m_atlas->glyph(character);
+
+        const float left = pen;
+        const float right = pen + float(glyph.size.width()) * unitsPerPixel;
+        const float top = float(glyph.size.height()) * unitsPerPixel;
+        const QRectF &uv = glyph.texCoords;
+
+        // Atlas rows run top to bottom, so the top of the glyph is uv.top()
+        const float corners[6][4] = {
+            { left,  0.0f, float(uv.left()),  float(uv.bottom()) },
+            { right, 0.0f, float(uv.right()), float(uv.bottom()) },
+            { right, top,  float(uv.right()), float(uv.top()) },
+            { left,  0.0f, float(uv.left()),  float(uv.bottom()) },
+            { right, top,  float(uv.right()), float(uv.top()) },
+            { left,  top,  float(uv.left()),  float(uv.top()) }
+        };
+
+        for (const auto &corner : corners) {
+            const float vertex[FLOATS_PER_VERTEX] = {
+                0.0f, 0.0f, 0.0f,
+                corner[0], corner[1],
+                corner[2], corner[3]
+            };
+            vertices.append(reinterpret_cast<const char *>(vertex), VERTEX_STRIDE);
+        }
+
+        pen += glyph.advance * unitsPerPixel;
+    }
+
+    return vertices;
+}
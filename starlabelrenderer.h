@@ -0,0 +1,108 @@
+#ifndef STARLABELRENDERER_H
+#define STARLABELRENDERER_H
+
+#include <Qt3DCore/QEntity>
+#include <Qt3DCore/QBuffer>
+#include <Qt3DCore/QAttribute>
+#include <Qt3DCore/QBoundingVolume>
+#include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DRender/QCamera>
+#include <QVector>
+#include <QSet>
+#include <QString>
+#include <QByteArray>
+#include <QCache>
+#include "glyphatlas.h"
+#include "instancedstarrenderer.h"
+#include "starprojection.h"
+
+/*
+ * Draws the star name labels from one glyph atlas and one vertex buffer.
+ *
+ * Labels cost nothing until they are shown, either on hover or by
+ * coming inside the label radius around the camera. Their glyphs are
+ * rasterised and their quads laid out on first use, and the layouts are
+ * kept in a bounded pool that drops the least recently drawn label. The
+ * pooled layouts leave out the star's position, it is filled in when
+ * the buffer is built, so a star that moved needs no new layout.
+ *
+ * The buffer is rebuilt once per frame, and only when the set of labels
+ * to draw changed, from the pooled layouts of those labels. Turning the
+ * quads towards the camera and keeping them a constant size on screen is
+ * done in the vertex shader, so camera moves never touch the buffer.
+ *
+ * Labels are addressed by the same catalog index as the star renderer.
+ */
+class StarLabelRenderer : public Qt3DCore::QEntity
+{
+    Q_OBJECT
+
+public:
+    explicit StarLabelRenderer(const InstancedStarRenderer *starRenderer,
+                               Qt3DCore::QNode *parent = nullptr);
+
+    // Label text for every star, indexed like the catalog
+    void setLabelTexts(const QVector<QString> &texts);
+
+    // Texts for stars added after the current ones, cached layouts are kept
+    void appendLabelTexts(const QVector<QString> &texts);
+
+    // Change one label, only its own layout is dropped
+    void setLabelText(int index, const QString &text);
+
+    // Hide every label and forget the texts
+    void clear();
+
+    void showLabel(int index);
+    void hideLabel(int index);
+    bool isLabelShown(int index) const { return m_shownLabels.contains(index); }
+
+    // Stars closer to the camera than this show their label, 0 turns it off.
+    // Needs the camera and the projection pass, which supplies the distances.
+    void setLabelRadius(float radius);
+    float labelRadius() const { return m_labelRadius; }
+
+    // Follow this camera to cull labels outside the frustum
+    void setCamera(Qt3DRender::QCamera *camera);
+
+    // Read star distances and visibility from this pass
+    void setProjection(const StarProjection *projection);
+
+    // Labels that got quads in the last rebuild
+    int visibleLabelCount() const { return m_drawnLabels.size(); }
+
+    // Labels with a laid out vertex block in the pool
+    int pooledLabelCount() const { return m_layouts.size(); }
+
+private:
+    void markDirty();
+    void rebuild();
+    QByteArray layoutLabel(int index);
+
+    const InstancedStarRenderer *m_starRenderer;
+    const StarProjection *m_projection;
+    Qt3DRender::QCamera *m_camera;
+
+    GlyphAtlas *m_atlas;
+    Qt3DCore::QBuffer *m_vertexBuffer;
+    Qt3DCore::QAttribute *m_anchorAttribute;
+    Qt3DCore::QAttribute *m_offsetAttribute;
+    Qt3DCore::QAttribute *m_texCoordAttribute;
+    Qt3DRender::QGeometryRenderer *m_mesh;
+    Qt3DCore::QBoundingVolume *m_bounds;
+
+    QVector<QString> m_texts;
+    QSet<int> m_shownLabels;
+    float m_labelRadius;
+
+    // Vertex block of each recently drawn label, least recently used goes first
+    QCache<int, QByteArray> m_layouts;
+
+    QVector<int> m_visibleLabels;
+    QVector<int> m_drawnLabels;
+    QByteArray m_vertexData;
+    bool m_dirty;
+    bool m_contentChanged;
+};
+
+#endif // STARLABELRENDERER_H
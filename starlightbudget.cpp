@@ -0,0 +1,104 @@
+#include "starlightbudget.h"
+#include "starsearch.h"
+
+StarLightBudget::StarLightBudget(Qt3DCore::QEntity *rootEntity,
+                                 const StarProjection *projection,
+                                 const InstancedStarRenderer *starRenderer,
+                                 int lightCount,
+                                 QObject *parent)
+    : QObject(parent)
+    , m_projection(projection)
+    , m_starRenderer(starRenderer)
+    , m_strategy(NearestToCamera)
+    , m_dirty(true)
+{
+    // Same light settings every star used to carry
+    for (int i = 0; i < lightCount; ++i) {
+        Qt3DCore::QEntity *lightEntity = new Qt3DCore::QEntity(rootEntity);
+        Qt3DRender::QPointLight *light = new Qt3DRender::QPointLight();
+        light->setIntensity(30.0f);
+        light->setConstantAttenuation(1.0f);
+        light->setLinearAttenuation(0.2f);
+        Qt3DCore::QTransform *transform = new Qt3DCore::QTransform();
+
+        lightEntity->addComponent(light);
+        lightEntity->addComponent(transform);
+        lightEntity->setEnabled(false);
+
+        m_lights.append(lightEntity);
+        m_lightTransforms.append(transform);
+    }
+
+    // A new projection only marks the budget dirty, the work is done once per frame
+    connect(m_projection, &StarProjection::updated, this, &StarLightBudget::invalidate);
+
+    Qt3DLogic::QFrameAction *frameAction = new Qt3DLogic::QFrameAction();
+    connect(frameAction, &Qt3DLogic::QFrameAction::triggered, this, &StarLightBudget::onFrame);
+    rootEntity->addComponent(frameAction);
+}
+
+void StarLightBudget::setStrategy(Strategy strategy)
+{
+    if (m_strategy == strategy)
+        return;
+
+    m_strategy = strategy;
+    invalidate();
+}
+
+void StarLightBudget::invalidate()
+{
+    m_dirty = true;
+}
+
+void StarLightBudget::onFrame(float dt)
+{
+    Q_UNUSED(dt);
+
+    if (!m_dirty)
+        return;
+
+    m_dirty = false;
+    assignLights();
+}
+
+void StarLightBudget::assignLights()
+{
+    // Distances and visibility come from the shared per-frame projection pass
+    const int stars = qMin(m_projection->count(), m_starRenderer->count());
+
+    m_candidates.clear();
+    m_scores.resize(stars);
+
+    for (int i = 0; i < stars; ++i) {
+        float distance = m_projection->distance(i);
+        float distanceSquared = qMax(distance * distance, 0.0001f);
+
+        if (m_strategy == NearestToCamera) {
+            // Lower is better, so negate for a common "highest score wins"
+            m_scores[i] = -distanceSquared;
+        } else {
+            if (!m_projection->isVisible(i))
+                continue;
+
+            float radius = m_starRenderer->radius(i);
+            m_scores[i] = radius * radius / distanceSquared;
+        }
+        m_candidates.append(i);
+    }
+
+    // Only the best N matter, their internal order does not
+    const int lit = qMin(int(m_lights.size()), int(m_candidates.size()));
+    StarSearch::selectBest(m_candidates, m_scores, lit);
+
+    m_litStars = m_candidates.mid(0, lit);
+
+    for (int i = 0; i < m_lights.size(); ++i) {
+        if (i < lit) {
+            m_lightTransforms[i]->setTranslation(m_starRenderer->position(m_litStars[i]));
+            m_lights[i]->setEnabled(true);
+        } else {
+            m_lights[i]->setEnabled(false);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef STARLIGHTBUDGET_H
+#define STARLIGHTBUDGET_H
+
+#include <QObject>
+#include <QVector>
+#include <Qt3DCore/QEntity>
+#include <Qt3DCore/QTransform>
+#include <Qt3DRender/QPointLight>
+#include <Qt3DLogic/QFrameAction>
+#include "instancedstarrenderer.h"
+#include "starprojection.h"
+
+/*
+ * Keeps a fixed pool of point lights and moves them onto the stars that
+ * matter most for the current view, instead of one light per star.
+ *
+ * The forward renderer only evaluates a handful of lights per draw, so
+ * the pool size should not exceed that (8 for the default shaders).
+ */
+class StarLightBudget : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Strategy {
+        NearestToCamera,    // The N stars closest to the camera
+        BrightestInView     // The N visible stars with the highest radius^2 / distance^2, i.e. apparent area
+    };
+    Q_ENUM(Strategy)
+
+    explicit StarLightBudget(Qt3DCore::QEntity *rootEntity,
+                             const StarProjection *projection,
+                             const InstancedStarRenderer *starRenderer,
+                             int lightCount = 8,
+                             QObject *parent = nullptr);
+
+    void setStrategy(Strategy strategy);
+    Strategy strategy() const { return m_strategy; }
+
+    int lightCount() const { return m_lights.size(); }
+
+    // Indices of the stars that currently carry a light
+    const QVector<int> &litStars() const { return m_litStars; }
+
+public slots:
+    // Reassign the lights on the next frame, e.g. after the catalog changed
+    void invalidate();
+
+private slots:
+    void onFrame(float dt);
+
+private:
+    void assignLights();
+
+    const StarProjection *m_projection;
+    const InstancedStarRenderer *m_starRenderer;
+    Strategy m_strategy;
+    bool m_dirty;
+
+    QVector<Qt3DCore::QEntity *> m_lights;
+    QVector<Qt3DCore::QTransform *> m_lightTransforms;
+    QVector<int> m_litStars;
+    QVector<int> m_candidates;
+    QVector<float> m_scores;
+};
+
+#endif // STARLIGHTBUDGET_H
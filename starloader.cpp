@@ -0,0 +1,319 @@
+#include "starloader.h"
+#include "starcreator.h"
+#include "spectraltype.h"
+#include "starcatalogcache.h"
+#include "databasehandler.h"
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <QPointer>
+
+// Stars added between checks of the frame budget
+static const int STARS_PER_STEP = 256;
+
+// Default time per frame spent adding stars
+static const int DEFAULT_FRAME_BUDGET = 4;
+
+// Quiet time after an edit before the cache is written again
+static const int CACHE_WRITE_DELAY = 2000;
+
+StarLoader::StarLoader(Qt3DCore::QEntity *rootEntity,
+                       StarCatalog *catalog,
+                       InstancedStarRenderer *starRenderer,
+                       StarLabelRenderer *labelRenderer,
+                       QObject *parent)
+    : QObject(parent)
+    , m_catalog(catalog)
+    , m_starRenderer(starRenderer)
+    , m_labelRenderer(labelRenderer)
+    , m_fromCache(false)
+    , m_reader(new StarCatalogReader(&m_generation))
+    , m_generation(0)
+    , m_pendingOffset(0)
+    , m_loading(false)
+    , m_readDone(true)
+    , m_readOk(true)
+    , m_frameBudget(DEFAULT_FRAME_BUDGET)
+    , m_cacheWriting(false)
+    , m_cacheStale(false)
+    , m_firstFrameLogged(false)
+    , m_firstStarsLogged(false)
+{
+    qRegisterMetaType<QVector<StarRecord>>();
+
+    m_reader->moveToThread(&m_thread);
+    connect(&m_thread, &QThread::finished, m_reader, &QObject::deleteLater);
+    connect(m_reader, &StarCatalogReader::batchRead, this, &StarLoader::onBatchRead);
+    connect(m_reader, &StarCatalogReader::finished, this, &StarLoader::onReadFinished);
+    m_thread.setObjectName("StarLoader");
+    m_thread.start();
+
+    Qt3DLogic::QFrameAction *frameAction = new Qt3DLogic::QFrameAction();
+    connect(frameAction, &Qt3DLogic::QFrameAction::triggered, this, &StarLoader::onFrame);
+    rootEntity->addComponent(frameAction);
+
+    m_cacheTimer.setSingleShot(true);
+    m_cacheTimer.setInterval(CACHE_WRITE_DELAY);
+    connect(&m_cacheTimer, &QTimer::timeout, this, &StarLoader::writeCache);
+
+    m_clock.start();
+}
+
+StarLoader::~StarLoader()
+{
+    // Stop a running read at its next row
+    m_generation.fetchAndAddRelaxed(1);
+    m_thread.quit();
+    m_thread.wait();
+}
+
+void StarLoader::start(const QString &databasePath)
+{
+    const int generation = m_generation.fetchAndAddRelaxed(1) + 1;
+
+    m_pending.clear();
+    m_pendingOffset = 0;
+    m_loading = true;
+    m_readDone = false;
+    m_readOk = true;
+    m_firstStarsLogged = false;
+    m_cacheTimer.stop();
+    m_clock.restart();
+    emit loadingChanged(true);
+
+    // Rensa gamla stjärnor från scenen
+    m_labelRenderer->clear();
+    m_starRenderer->clear();
+    m_catalog->clear();
+
+    m_databasePath = databasePath;
+    m_databaseFile = QString::fromStdString(getDatabasePath(databasePath.toStdString()));
+    m_fromCache = loadFromCache();
+    if (m_fromCache) {
+        m_readDone = true;
+        finish();
+        return;
+    }
+
+    StarCatalogReader *reader = m_reader;
+    const QString databaseFile = m_databaseFile;
+    QMetaObject::invokeMethod(reader, [reader, databaseFile, generation]() {
+        reader->read(databaseFile, generation);
+    }, Qt::QueuedConnection);
+}
+
+/*
+ * Copies the whole catalog out of the mapped cache file and commits it
+ * with the cached octree. False when there is no usable cache.
+ */
+bool StarLoader::loadFromCache()
+{
+    StarCatalogCache cache(m_databaseFile);
+    if (!cache.open()) {
+        qCInfo(lcStarLoading) << "no up to date star cache, reading the database";
+        return false;
+    }
+
+    const int stars = cache.count();
+    m_starRenderer->reserve(stars);
+    for (int row = 0; row < stars; ++row) {
+        const StarRecord star = cache.record(row);
+        m_catalog->append(star);
+        m_starRenderer->addStar(cache.scenePosition(row), star.radius, star.color);
+    }
+    m_starRenderer->commit(cache.octree());
+    m_labelRenderer->setLabelTexts(m_catalog->ids());
+
+    qCInfo(lcStarLoading) << "mapped" << stars << "stars from" << StarCatalogCache::cacheFileFor(m_databaseFile)
+                          << "in" << m_clock.elapsed() << "ms";
+    return true;
+}
+
+/*
+ * Writes the cache on a worker thread. The catalog and the renderer's
+ * arrays are implicitly shared, the copies cost nothing here and later
+ * changes on the GUI thread detach from them. One write runs at a time,
+ * a request during it writes again when it is done.
+ */
+void StarLoader::writeCache()
+{
+    // Half a catalog mustn't be stamped as the database, finish() writes it
+    m_cacheTimer.stop();
+    if (m_loading)
+        return;
+    if (m_cacheWriting) {
+        m_cacheStale = true;
+        return;
+    }
+    m_cacheWriting = true;
+    m_cacheStale = false;
+
+    const QString databaseFile = m_databaseFile;
+    const StarCatalog catalog = *m_catalog;
+    const StarCatalogCache::Scene scene = StarCatalogCache::sceneOf(*m_starRenderer);
+    QPointer<StarLoader> target(this);
+
+    QThreadPool::globalInstance()->start([target, databaseFile, catalog, scene]() {
+        QElapsedTimer timer;
+        timer.start();
+        const bool written = StarCatalogCache::write(databaseFile, catalog, scene);
+        if (written)
+            qCInfo(lcStarLoading) << "wrote star cache in" << timer.elapsed() << "ms";
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [target]() {
+            if (!target)
+                return;
+            target->m_cacheWriting = false;
+            if (target->m_cacheStale)
+                target->writeCache();
+        }, Qt::QueuedConnection);
+    });
+}
+
+/*
+ * Updates a star after an edit without reloading the scene. Every row
+ * with the old MAIN_ID is changed, like the UPDATE in the database, and
+ * only what differs is touched: the label for a new id, radius and
+ * colour for a new spectral type.
+ */
+void StarLoader::reconcileStar(const QString &oldId, const QString &newId, const QString &spType)
+{
+    const int row = m_catalog->indexOf(oldId);
+
+    // Stars still on their way may have been read before the edit
+    if (m_loading || row < 0) {
+        start(m_databasePath);
+        return;
+    }
+
+    // MAIN_ID är inte unikt i tabellen, UPDATE ändrar alla rader med id:t
+    QVector<int> rows;
+    const QVector<QString> &ids = m_catalog->ids();
+    for (int index = 0; index < ids.size(); ++index) {
+        if (ids[index] == oldId)
+            rows.append(index);
+    }
+
+    bool changed = false;
+    for (int index : std::as_const(rows)) {
+        StarRecord star = m_catalog->record(index);
+        const bool renamed = star.id != newId;
+        const bool retyped = star.spType != spType;
+        if (!renamed && !retyped)
+            continue;
+        changed = true;
+
+        star.id = newId;
+        star.spType = spType;
+        star.spectral = SpectralType::parse(spType);
+        m_catalog->update(index, star);
+
+        if (renamed)
+            m_labelRenderer->setLabelText(index, newId);
+        if (retyped) {
+            m_starRenderer->updateStar(index, m_starRenderer->position(index),
+                                       star.spectral.radius(),
+                                       star.spectral.color());
+        }
+    }
+    if (!changed)
+        return;
+
+    qCInfo(lcStarLoading) << "updated" << rows.size() << "rows of" << oldId << "in place";
+
+    // The database changed, the cache follows once the edits stop
+    m_cacheTimer.start();
+}
+
+void StarLoader::onBatchRead(int generation, const QVector<StarRecord> &batch)
+{
+    if (generation != m_generation.loadRelaxed())
+        return;
+
+    m_pending.enqueue(batch);
+}
+
+void StarLoader::onReadFinished(int generation, bool ok, int rows)
+{
+    if (generation != m_generation.loadRelaxed())
+        return;
+
+    qCInfo(lcStarLoading) << "read" << rows << "rows in" << m_clock.elapsed() << "ms";
+
+    m_readDone = true;
+    m_readOk = ok;
+    if (m_pending.isEmpty())
+        finish();
+}
+
+void StarLoader::onFrame(float dt)
+{
+    Q_UNUSED(dt);
+
+    if (!m_firstFrameLogged) {
+        m_firstFrameLogged = true;
+        qCInfo(lcStarLoading) << "first frame after" << m_clock.elapsed() << "ms";
+    }
+
+    if (m_pending.isEmpty())
+        return;
+
+    QElapsedTimer budget;
+    budget.start();
+
+    const int first = m_catalog->count();
+
+    // Always add at least one step so loading moves on even on slow frames
+    do {
+        const QVector<StarRecord> &batch = m_pending.head();
+        const int end = qMin(int(batch.size()), m_pendingOffset + STARS_PER_STEP);
+        for (; m_pendingOffset < end; ++m_pendingOffset) {
+            const StarRecord &star = batch[m_pendingOffset];
+            m_catalog->append(star);
+            StarCreator::createStar(m_starRenderer, star);
+        }
+
+        if (m_pendingOffset == batch.size()) {
+            m_pending.dequeue();
+            m_pendingOffset = 0;
+        }
+    } while (!m_pending.isEmpty() && budget.elapsed() < m_frameBudget);
+
+    const int added = m_catalog->count() - first;
+    m_starRenderer->uploadPending();
+    m_labelRenderer->appendLabelTexts(m_catalog->ids().mid(first, added));
+
+    qCDebug(lcStarLoading) << "added" << added << "stars in" << budget.elapsed() << "ms,"
+                           << m_pending.size() << "batches left";
+
+    if (!m_firstStarsLogged) {
+        m_firstStarsLogged = true;
+        qCInfo(lcStarLoading) << "first" << added << "stars in the scene after" << m_clock.elapsed() << "ms";
+    }
+
+    emit starsAdded(first, added);
+
+    if (m_pending.isEmpty() && m_readDone)
+        finish();
+}
+
+void StarLoader::finish()
+{
+    m_loading = false;
+
+    // Sort everything read into the octree at once, the cache came with its own
+    if (!m_fromCache) {
+        QElapsedTimer timer;
+        timer.start();
+        m_starRenderer->commit();
+        qCInfo(lcStarLoading) << "built the octree in" << timer.elapsed() << "ms";
+    }
+
+    qCInfo(lcStarLoading) << "loaded" << m_catalog->count() << "stars in" << m_clock.elapsed() << "ms";
+
+    // Next start maps the stars instead of reading them
+    if (!m_fromCache && m_readOk)
+        writeCache();
+
+    emit loadingChanged(false);
+    emit finished(m_readOk, m_catalog->count());
+}
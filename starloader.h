@@ -0,0 +1,122 @@
+#ifndef STARLOADER_H
+#define STARLOADER_H
+
+#include <QObject>
+#include <QThread>
+#include <QQueue>
+#include <QVector>
+#include <QString>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QLoggingCategory>
+#include <Qt3DCore/QEntity>
+#include <Qt3DLogic/QFrameAction>
+#include "starcatalog.h"
+#include "starcatalogreader.h"
+#include "instancedstarrenderer.h"
+#include "starlabelrenderer.h"
+
+/*
+ * Streams the catalog into the scene without blocking the GUI thread.
+ *
+ * StarCatalogReader runs on a worker thread and hands over batches of
+ * finished records. Every frame the loader moves as many of them into
+ * the catalog, the renderer and the labels as fit in its frame budget
+ * and uploads only those, so the skybox and panels show straight away
+ * and the stars appear over the next frames. The renderer sorts them
+ * into its octree once, when the read is done.
+ *
+ * When the binary cache next to the database is up to date the stars
+ * are copied from it in one go instead, with the octree already built,
+ * and the database isn't read at all. After a read from the database
+ * the cache is written again, on a worker thread from implicitly shared
+ * copies of the catalog and the renderer's arrays.
+ *
+ * An admin edit doesn't reload anything. reconcileStar() compares the
+ * edited values with the star's row and only changes the label, radius
+ * and colour that differ, so no entities are created or destroyed. The
+ * cache is written again once the edits have stopped for a moment.
+ *
+ * The time to the first frame, the first stars and the whole catalog
+ * is logged under astronav.loading.
+ */
+class StarLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StarLoader(Qt3DCore::QEntity *rootEntity,
+                        StarCatalog *catalog,
+                        InstancedStarRenderer *starRenderer,
+                        StarLabelRenderer *labelRenderer,
+                        QObject *parent = nullptr);
+    ~StarLoader();
+
+    // Clear the scene and read the stars again, a running read is dropped
+    void start(const QString &databasePath);
+
+    bool isLoading() const { return m_loading; }
+
+    // The last start() mapped the cache instead of reading the database
+    bool fromCache() const { return m_fromCache; }
+
+    // Milliseconds per frame spent adding stars
+    void setFrameBudget(int milliseconds) { m_frameBudget = milliseconds; }
+    int frameBudget() const { return m_frameBudget; }
+
+public slots:
+    // Bring one edited star up to date in place, found by its old MAIN_ID
+    void reconcileStar(const QString &oldId, const QString &newId, const QString &spType);
+
+signals:
+    // Stars first .. first + count - 1 are in the catalog and drawn, the
+    // octree follows when loading finishes
+    void starsAdded(int first, int count);
+    void finished(bool ok, int stars);
+
+    // Stars are being added frame by frame
+    void loadingChanged(bool loading);
+
+private slots:
+    void onBatchRead(int generation, const QVector<StarRecord> &batch);
+    void onReadFinished(int generation, bool ok, int rows);
+    void onFrame(float dt);
+
+private:
+    bool loadFromCache();
+    void writeCache();
+    void finish();
+
+    StarCatalog *m_catalog;
+    InstancedStarRenderer *m_starRenderer;
+    StarLabelRenderer *m_labelRenderer;
+
+    QString m_databasePath;
+    QString m_databaseFile;
+    bool m_fromCache;
+
+    QThread m_thread;
+    StarCatalogReader *m_reader;
+    QAtomicInt m_generation;
+
+    // Batches read but not yet in the scene, m_pendingOffset into the first
+    QQueue<QVector<StarRecord>> m_pending;
+    int m_pendingOffset;
+
+    bool m_loading;
+    bool m_readDone;
+    bool m_readOk;
+    int m_frameBudget;
+
+    // Edits restart the timer, one cache write follows a burst of them
+    QTimer m_cacheTimer;
+    bool m_cacheWriting;
+    bool m_cacheStale;
+
+    QElapsedTimer m_clock;
+    bool m_firstFrameLogged;
+    bool m_firstStarsLogged;
+};
+
+#endif // STARLOADER_H
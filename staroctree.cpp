@@ -0,0 +1,255 @@
+#include "staroctree.h"
+#include <algorithm>
+
+StarFrustum::StarFrustum(const QMatrix4x4 &viewProjection)
+{
+    // Gribb/Hartmann: each plane is the last row plus or minus one of the others
+    const QVector4D row0 = viewProjection.row(0);
+    const QVector4D row1 = viewProjection.row(1);
+    const QVector4D row2 = viewProjection.row(2);
+    const QVector4D row3 = viewProjection.row(3);
+
+    m_planes = {
+        row3 + row0,    // left
+        row3 - row0,    // right
+        row3 + row1,    // bottom
+        row3 - row1,    // top
+        row3 + row2,    // near
+        row3 - row2     // far
+    };
+
+    for (QVector4D &plane : m_planes) {
+        float length = plane.toVector3D().length();
+        if (length > 0.0f)
+            plane /= length;
+    }
+}
+
+StarFrustum::Result StarFrustum::classify(const QVector3D &minPoint, const QVector3D &maxPoint) const
+{
+    Result result = Inside;
+
+    for (const QVector4D &plane : m_planes) {
+        // Box corners furthest along and against the plane normal
+        QVector3D positive(plane.x() >= 0.0f ? maxPoint.x() : minPoint.x(),
+                           plane.y() >= 0.0f ? maxPoint.y() : minPoint.y(),
+                           plane.z() >= 0.0f ? maxPoint.z() : minPoint.z());
+        QVector3D negative(plane.x() >= 0.0f ? minPoint.x() : maxPoint.x(),
+                           plane.y() >= 0.0f ? minPoint.y() : maxPoint.y(),
+                           plane.z() >= 0.0f ? minPoint.z() : maxPoint.z());
+
+        if (QVector3D::dotProduct(plane.toVector3D(), positive) + plane.w() < 0.0f)
+            return Outside;
+        if (QVector3D::dotProduct(plane.toVector3D(), negative) + plane.w() < 0.0f)
+            result = Intersects;
+    }
+
+    return result;
+}
+
+bool StarFrustum::intersectsSphere(const QVector3D &center, float radius) const
+{
+    for (const QVector4D &plane : m_planes) {
+        if (QVector3D::dotProduct(plane.toVector3D(), center) + plane.w() < -radius)
+            return false;
+    }
+    return true;
+}
+
+void StarOctree::clear()
+{
+    m_nodes.clear();
+    m_leaves.clear();
+    m_order.clear();
+}
+
+int StarOctree::grow(int slot, const QVector3D &center, float extent)
+{
+    if (m_nodes.isEmpty() || slot < 0 || slot >= m_order.size())
+        return -1;
+
+    int nodeIndex = 0;
+    while (true) {
+        Node &node = m_nodes[nodeIndex];
+        for (int axis = 0; axis < 3; ++axis) {
+            node.minPoint[axis] = qMin(node.minPoint[axis], center[axis] - extent);
+            node.maxPoint[axis] = qMax(node.maxPoint[axis], center[axis] + extent);
+        }
+
+        if (node.firstChild < 0)
+            return node.leaf;
+
+        // Go down into the child whose range holds the slot
+        int next = -1;
+        for (int child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+            const Node &candidate = m_nodes[child];
+            if (slot >= candidate.first && slot < candidate.first + candidate.count) {
+                next = child;
+                break;
+            }
+        }
+        if (next < 0)
+            return -1;
+        nodeIndex = next;
+    }
+}
+
+void StarOctree::assign(const QVector<Node> &nodes, const QVector<int> &leaves, const QVector<int> &order)
+{
+    m_nodes = nodes;
+    m_leaves = leaves;
+    m_order = order;
+}
+
+void StarOctree::build(const QVector<QVector3D> &positions,
+                       const QVector<float> &radii,
+                       float padding,
+                       int leafCapacity,
+                       int maxDepth)
+{
+    clear();
+    m_leafCapacity = qMax(1, leafCapacity);
+    m_maxDepth = qMax(0, maxDepth);
+
+    const int stars = positions.size();
+    if (stars == 0)
+        return;
+
+    QVector<float> extents(stars);
+    m_order.resize(stars);
+    m_scratch.resize(stars);
+
+    // The root cell is the cube around all star centers
+    QVector3D minPoint = positions[0];
+    QVector3D maxPoint = positions[0];
+    for (int i = 0; i < stars; ++i) {
+        m_order[i] = i;
+        extents[i] = radii[i] * padding;
+        minPoint = QVector3D(qMin(minPoint.x(), positions[i].x()),
+                             qMin(minPoint.y(), positions[i].y()),
+                             qMin(minPoint.z(), positions[i].z()));
+        maxPoint = QVector3D(qMax(maxPoint.x(), positions[i].x()),
+                             qMax(maxPoint.y(), positions[i].y()),
+                             qMax(maxPoint.z(), positions[i].z()));
+    }
+
+    const QVector3D size = maxPoint - minPoint;
+    const float halfSide = qMax(qMax(size.x(), size.y()), size.z()) * 0.5f;
+    const QVector3D center = (minPoint + maxPoint) * 0.5f;
+    const QVector3D halfCube(halfSide, halfSide, halfSide);
+
+    m_nodes.append(Node{ {}, {}, -1, 0, 0, stars, -1 });
+    buildNode(0, positions, extents, center - halfCube, center + halfCube, 0);
+
+    m_scratch.clear();
+    m_scratch.squeeze();
+}
+
+/*
+ * Fills in the node at nodeIndex, whose stars are m_order[first, first + count).
+ * Inner nodes sort their range by octant so every child is contiguous too.
+ */
+void StarOctree::buildNode(int nodeIndex,
+                           const QVector<QVector3D> &positions,
+                           const QVector<float> &extents,
+                           const QVector3D &cellMin,
+                           const QVector3D &cellMax,
+                           int depth)
+{
+    const int first = m_nodes[nodeIndex].first;
+    const int count = m_nodes[nodeIndex].count;
+
+    // Bounds of the stars themselves, including their padded radius
+    QVector3D minPoint = positions[m_order[first]];
+    QVector3D maxPoint = minPoint;
+    for (int i = first; i < first + count; ++i) {
+        const int star = m_order[i];
+        const QVector3D extent(extents[star], extents[star], extents[star]);
+        const QVector3D low = positions[star] - extent;
+        const QVector3D high = positions[star] + extent;
+        minPoint = QVector3D(qMin(minPoint.x(), low.x()), qMin(minPoint.y(), low.y()), qMin(minPoint.z(), low.z()));
+        maxPoint = QVector3D(qMax(maxPoint.x(), high.x()), qMax(maxPoint.y(), high.y()), qMax(maxPoint.z(), high.z()));
+    }
+    m_nodes[nodeIndex].minPoint = minPoint;
+    m_nodes[nodeIndex].maxPoint = maxPoint;
+
+    if (count <= m_leafCapacity || depth >= m_maxDepth) {
+        m_nodes[nodeIndex].leaf = m_leaves.size();
+        m_leaves.append(nodeIndex);
+        return;
+    }
+
+    // Counting sort of the range by octant
+    const QVector3D center = (cellMin + cellMax) * 0.5f;
+    auto octantOf = [&positions, &center](int star) {
+        const QVector3D &position = positions[star];
+        return (position.x() >= center.x() ? 1 : 0)
+             | (position.y() >= center.y() ? 2 : 0)
+             | (position.z() >= center.z() ? 4 : 0);
+    };
+
+    int octantCounts[8] = {};
+    for (int i = first; i < first + count; ++i)
+        ++octantCounts[octantOf(m_order[i])];
+
+    int octantStarts[8];
+    int childCount = 0;
+    for (int octant = 0, offset = first; octant < 8; ++octant) {
+        octantStarts[octant] = offset;
+        offset += octantCounts[octant];
+        if (octantCounts[octant] > 0)
+            ++childCount;
+    }
+
+    int fill[8];
+    std::copy(octantStarts, octantStarts + 8, fill);
+    for (int i = first; i < first + count; ++i) {
+        const int star = m_order[i];
+        m_scratch[fill[octantOf(star)]++] = star;
+    }
+    std::copy(m_scratch.constBegin() + first, m_scratch.constBegin() + first + count, m_order.begin() + first);
+
+    // Children are allocated together so the parent only stores the first
+    const int firstChild = m_nodes.size();
+    m_nodes[nodeIndex].firstChild = firstChild;
+    m_nodes[nodeIndex].childCount = childCount;
+
+    int child = firstChild;
+    for (int octant = 0; octant < 8; ++octant) {
+        if (octantCounts[octant] > 0)
+            m_nodes.append(Node{ {}, {}, -1, 0, octantStarts[octant], octantCounts[octant], -1 });
+    }
+
+    for (int octant = 0; octant < 8; ++octant) {
+        if (octantCounts[octant] == 0)
+            continue;
+
+        QVector3D childMin(octant & 1 ? center.x() : cellMin.x(),
+                           octant & 2 ? center.y() : cellMin.y(),
+                           octant & 4 ? center.z() : cellMin.z());
+        QVector3D childMax(octant & 1 ? cellMax.x() : center.x(),
+                           octant & 2 ? cellMax.y() : center.y(),
+                           octant & 4 ? cellMax.z() : center.z());
+        buildNode(child++, positions, extents, childMin, childMax, depth + 1);
+    }
+}
+
+void StarOctree::queryFrustum(const StarFrustum &frustum, QVector<int> &visibleLeaves) const
+{
+    visibleLeaves.clear();
+
+    visitNodes([&frustum](const Node &node) { return frustum.classify(node.minPoint, node.maxPoint); },
+               [this, &visibleLeaves](const Node &node) {
+                   if (node.leaf >= 0) {
+                       visibleLeaves.append(node.leaf);
+                       return;
+                   }
+
+                   // A subtree fully inside, its leaves are the ones covering its range
+                   auto startsBefore = [this](int leafNode, int first) { return m_nodes[leafNode].first < first; };
+                   int leaf = std::lower_bound(m_leaves.constBegin(), m_leaves.constEnd(), node.first, startsBefore)
+                              - m_leaves.constBegin();
+                   for (; leaf < m_leaves.size() && m_nodes[m_leaves[leaf]].first < node.first + node.count; ++leaf)
+                       visibleLeaves.append(leaf);
+               });
+}
@@ -0,0 +1,170 @@
+#ifndef STAROCTREE_H
+#define STAROCTREE_H
+
+#include <QVector>
+#include <QVector3D>
+#include <QVector4D>
+#include <QMatrix4x4>
+#include <QVarLengthArray>
+#include <array>
+
+/*
+ * The six planes of a camera frustum, extracted from a view-projection
+ * matrix. Normals point into the frustum.
+ */
+class StarFrustum
+{
+public:
+    enum Result {
+        Outside,
+        Intersects,
+        Inside
+    };
+
+    StarFrustum() = default;
+    explicit StarFrustum(const QMatrix4x4 &viewProjection);
+
+    Result classify(const QVector3D &minPoint, const QVector3D &maxPoint) const;
+    bool intersectsSphere(const QVector3D &center, float radius) const;
+
+private:
+    std::array<QVector4D, 6> m_planes;
+};
+
+/*
+ * Octree over the star positions in scene units.
+ *
+ * Building the tree sorts the stars so that every node covers one
+ * contiguous range of order(). The renderer uploads its star buffer in
+ * that order, so a leaf can be drawn or skipped as a single range.
+ * Node bounds enclose each star's radius times the padding given to
+ * build(), so queries return candidates that callers test exactly.
+ */
+class StarOctree
+{
+public:
+    struct Node {
+        QVector3D minPoint;
+        QVector3D maxPoint;
+        int firstChild;     // Children are stored next to each other, -1 for a leaf
+        int childCount;
+        int first;          // Range of the node's stars in order()
+        int count;
+        int leaf;           // Index into leaves(), -1 for inner nodes
+    };
+
+    void build(const QVector<QVector3D> &positions,
+               const QVector<float> &radii,
+               float padding = 1.0f,
+               int leafCapacity = 64,
+               int maxDepth = 8);
+    void clear();
+
+    // Enlarge the boxes from the root down to the leaf holding order()[slot]
+    // so they cover a sphere around center. Returns the leaf, -1 if none.
+    int grow(int slot, const QVector3D &center, float extent);
+
+    // Take over a tree built earlier, e.g. read from the catalog cache
+    void assign(const QVector<Node> &nodes, const QVector<int> &leaves, const QVector<int> &order);
+
+    bool isEmpty() const { return m_nodes.isEmpty(); }
+    int starCount() const { return m_order.size(); }
+
+    const QVector<Node> &nodes() const { return m_nodes; }
+
+    // Node indices of the leaves, in the same order as their star ranges
+    const QVector<int> &leaves() const { return m_leaves; }
+
+    // Catalog indices sorted by octree node
+    const QVector<int> &order() const { return m_order; }
+
+    // Collect the leaves (as indices into leaves()) that touch the frustum
+    void queryFrustum(const StarFrustum &frustum, QVector<int> &visibleLeaves) const;
+
+    // Call visit(catalogIndex) for every star in a node touching the frustum
+    template <typename Visitor>
+    void forEachInFrustum(const StarFrustum &frustum, Visitor visit) const;
+
+    // Call visit(catalogIndex) for every star in a node touching the sphere
+    template <typename Visitor>
+    void forEachInSphere(const QVector3D &center, float radius, Visitor visit) const;
+
+private:
+    void buildNode(int nodeIndex,
+                   const QVector<QVector3D> &positions,
+                   const QVector<float> &extents,
+                   const QVector3D &cellMin,
+                   const QVector3D &cellMax,
+                   int depth);
+
+    template <typename Accept, typename Visitor>
+    void visitNodes(Accept accept, Visitor visit) const;
+
+    QVector<Node> m_nodes;
+    QVector<int> m_leaves;
+    QVector<int> m_order;
+    QVector<int> m_scratch;
+    int m_leafCapacity = 64;
+    int m_maxDepth = 8;
+};
+
+// Depth first walk, accept(node) returns Outside, Intersects or Inside.
+// Subtrees fully inside are visited without testing their children.
+template <typename Accept, typename Visitor>
+void StarOctree::visitNodes(Accept accept, Visitor visit) const
+{
+    if (m_nodes.isEmpty())
+        return;
+
+    QVarLengthArray<int, 64> stack;
+    stack.append(0);
+
+    while (!stack.isEmpty()) {
+        const Node &node = m_nodes[stack.takeLast()];
+        const StarFrustum::Result result = accept(node);
+        if (result == StarFrustum::Outside)
+            continue;
+
+        if (result == StarFrustum::Inside || node.firstChild < 0) {
+            visit(node);
+            continue;
+        }
+
+        for (int child = 0; child < node.childCount; ++child)
+            stack.append(node.firstChild + child);
+    }
+}
+
+template <typename Visitor>
+void StarOctree::forEachInFrustum(const StarFrustum &frustum, Visitor visit) const
+{
+    visitNodes([&frustum](const Node &node) { return frustum.classify(node.minPoint, node.maxPoint); },
+               [this, &visit](const Node &node) {
+                   for (int i = node.first; i < node.first + node.count; ++i)
+                       visit(m_order[i]);
+               });
+}
+
+template <typename Visitor>
+void StarOctree::forEachInSphere(const QVector3D &center, float radius, Visitor visit) const
+{
+    const float radiusSquared = radius * radius;
+    visitNodes([&center, radiusSquared](const Node &node) {
+                   // Squared distance from the sphere center to the box
+                   float distanceSquared = 0.0f;
+                   for (int axis = 0; axis < 3; ++axis) {
+                       float v = center[axis];
+                       if (v < node.minPoint[axis])
+                           distanceSquared += (node.minPoint[axis] - v) * (node.minPoint[axis] - v);
+                       else if (v > node.maxPoint[axis])
+                           distanceSquared += (v - node.maxPoint[axis]) * (v - node.maxPoint[axis]);
+                   }
+                   return distanceSquared <= radiusSquared ? StarFrustum::Intersects : StarFrustum::Outside;
+               },
+               [this, &visit](const Node &node) {
+                   for (int i = node.first; i < node.first + node.count; ++i)
+                       visit(m_order[i]);
+               });
+}
+
+#endif // STAROCTREE_H
@@ -0,0 +1,162 @@
+#include "starpicker.h"
+#include <Qt3DRender/QCamera>
+#include <QMouseEvent>
+#include <QMatrix4x4>
+#include <QElapsedTimer>
+#include <QtMath>
+
+Q_LOGGING_CATEGORY(lcStarPicking, "astronav.picking", QtWarningMsg)
+
+// Stars per BVH leaf
+static const int STARS_PER_LEAF = 4;
+
+// A press and release further apart than this is a camera drag, not a click
+static const float CLICK_TOLERANCE = 5.0f;
+
+StarPicker::StarPicker(Qt3DExtras::Qt3DWindow *view,
+                       InstancedStarRenderer *starRenderer,
+                       QObject *parent)
+    : QObject(parent)
+    , m_view(view)
+    , m_starRenderer(starRenderer)
+    , m_bvhDirty(true)
+    , m_hoveredStar(-1)
+    , m_pressedStar(-1)
+{
+    connect(m_starRenderer, &InstancedStarRenderer::committed, this, &StarPicker::invalidate);
+    connect(m_starRenderer, &InstancedStarRenderer::starUpdated, this, &StarPicker::onStarUpdated);
+    m_view->installEventFilter(this);
+}
+
+void StarPicker::invalidate()
+{
+    m_bvhDirty = true;
+}
+
+// Boxes cover the highlight scale so hovered stars stay inside their node
+void StarPicker::rebuild() const
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_bvhDirty = false;
+
+    m_bvh.build(m_starRenderer->positions(), m_starRenderer->radii(),
+                InstancedStarRenderer::HIGHLIGHT_SCALE, STARS_PER_LEAF);
+
+    qCDebug(lcStarPicking) << "built BVH over" << m_starRenderer->count() << "stars,"
+                           << m_bvh.nodes().size() << "nodes in" << timer.elapsed() << "ms";
+}
+
+// A star changed size in place, its boxes only need to grow
+void StarPicker::onStarUpdated(int index)
+{
+    // A stale tree is built again with the new size anyway
+    if (m_bvhDirty)
+        return;
+
+    m_bvh.grow(index, m_starRenderer->position(index),
+               m_starRenderer->radius(index) * InstancedStarRenderer::HIGHLIGHT_SCALE);
+}
+
+int StarPicker::pickStar(const QPointF &windowPosition) const
+{
+    if (m_view->width() <= 0 || m_view->height() <= 0)
+        return -1;
+
+    if (m_bvhDirty)
+        rebuild();
+
+    Qt3DRender::QCamera *camera = m_view->camera();
+
+    // Unproject the cursor to a world space ray
+    float ndcX = 2.0f * windowPosition.x() / m_view->width() - 1.0f;
+    float ndcY = 1.0f - 2.0f * windowPosition.y() / m_view->height();
+    QMatrix4x4 inverse = (camera->projectionMatrix() * camera->viewMatrix()).inverted();
+    QVector3D nearPoint = inverse.map(QVector3D(ndcX, ndcY, -1.0f));
+    QVector3D farPoint = inverse.map(QVector3D(ndcX, ndcY, 1.0f));
+
+    QVector3D origin = camera->position();
+    QVector3D direction = (farPoint - nearPoint).normalized();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Nodes are walked front to back, only stars in their leaves are tested exactly
+    int closestStar = m_bvh.closestHit(origin, direction, [&](int i) {
+        QVector3D toStar = m_starRenderer->position(i) - origin;
+        float radius = m_starRenderer->pickRadius(i);
+        float radiusSquared = radius * radius;
+        float distanceSquared = toStar.lengthSquared();
+
+        // Ignore the star the camera is inside so it doesn't block picking
+        if (distanceSquared <= radiusSquared)
+            return -1.0f;
+
+        float along = QVector3D::dotProduct(toStar, direction);
+        if (along <= 0.0f)
+            return -1.0f;
+
+        float missSquared = distanceSquared - along * along;
+        if (missSquared > radiusSquared)
+            return -1.0f;
+
+        return along - qSqrt(radiusSquared - missSquared);
+    });
+
+    qCDebug(lcStarPicking) << "picked" << closestStar << "in" << timer.nsecsElapsed() / 1000 << "us";
+
+    return closestStar;
+}
+
+bool StarPicker::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::MouseMove: {
+        auto *mouseEvent = static_cast<QMouseEvent *>(event);
+        setHoveredStar(pickStar(mouseEvent->position()));
+        break;
+    }
+    case QEvent::MouseButtonPress: {
+        auto *mouseEvent = static_cast<QMouseEvent *>(event);
+        if (mouseEvent->button() == Qt::LeftButton) {
+            m_pressPosition = mouseEvent->position();
+            m_pressedStar = pickStar(m_pressPosition);
+        }
+        break;
+    }
+    case QEvent::MouseButtonRelease: {
+        auto *mouseEvent = static_cast<QMouseEvent *>(event);
+        if (mouseEvent->button() == Qt::LeftButton && m_pressedStar >= 0) {
+            QPointF moved = mouseEvent->position() - m_pressPosition;
+            if (moved.manhattanLength() <= CLICK_TOLERANCE &&
+                pickStar(mouseEvent->position()) == m_pressedStar) {
+                emit clicked(m_pressedStar);
+            }
+        }
+        m_pressedStar = -1;
+        break;
+    }
+    case QEvent::Leave:
+        setHoveredStar(-1);
+        break;
+    default:
+        break;
+    }
+
+    // Never consume the event, the camera controllers need it too
+    return QObject::eventFilter(watched, event);
+}
+
+void StarPicker::setHoveredStar(int index)
+{
+    if (index == m_hoveredStar)
+        return;
+
+    int previous = m_hoveredStar;
+    m_hoveredStar = index;
+
+    if (previous >= 0)
+        emit exited(previous);
+    if (index >= 0)
+        emit entered(index);
+}
@@ -0,0 +1,62 @@
+#ifndef STARPICKER_H
+#define STARPICKER_H
+
+#include <QObject>
+#include <QPointF>
+#include <QVector3D>
+#include <Qt3DExtras/Qt3DWindow>
+#include <QLoggingCategory>
+#include "instancedstarrenderer.h"
+#include "starbvh.h"
+
+Q_DECLARE_LOGGING_CATEGORY(lcStarPicking)
+
+/*
+ * Picks stars from the instanced star renderer with a CPU ray cast.
+ *
+ * Mouse events are read straight from the 3D window, so one picker
+ * serves the whole catalog. Every mouse event casts one ray through a
+ * bounding volume hierarchy. A commit only marks it stale, the first
+ * pick after it builds it again, so commits in a row cost one build.
+ * All signals carry the star's catalog index.
+ */
+class StarPicker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StarPicker(Qt3DExtras::Qt3DWindow *view,
+                        InstancedStarRenderer *starRenderer,
+                        QObject *parent = nullptr);
+
+    // Returns the index of the closest star under the window position, or -1
+    int pickStar(const QPointF &windowPosition) const;
+
+    int hoveredStar() const { return m_hoveredStar; }
+
+signals:
+    void clicked(int index);
+    void entered(int index);
+    void exited(int index);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void invalidate();
+    void onStarUpdated(int index);
+
+private:
+    void rebuild() const;
+    void setHoveredStar(int index);
+
+    Qt3DExtras::Qt3DWindow *m_view;
+    InstancedStarRenderer *m_starRenderer;
+    mutable StarBvh m_bvh;
+    mutable bool m_bvhDirty;
+    int m_hoveredStar;
+    int m_pressedStar;
+    QPointF m_pressPosition;
+};
+
+#endif // STARPICKER_H
@@ -0,0 +1,185 @@
+#include "starprojection.h"
+#include "perfmonitor.h"
+#include <Qt3DRender/QCameraLens>
+#include <QMatrix4x4>
+#include <QtMath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+StarProjection::StarProjection(Qt3DCore::QEntity *rootEntity,
+                               Qt3DRender::QCamera *camera,
+                               const InstancedStarRenderer *starRenderer,
+                               QObject *parent)
+    : QObject(parent)
+    , m_camera(camera)
+    , m_starRenderer(starRenderer)
+    , m_dirty(true)
+    , m_visibleCount(0)
+{
+    // Camera and catalog changes only mark the pass dirty, it runs once per frame
+    connect(m_camera, &Qt3DRender::QCamera::positionChanged, this, &StarProjection::invalidate);
+    connect(m_camera, &Qt3DRender::QCamera::viewCenterChanged, this, &StarProjection::invalidate);
+    connect(m_camera, &Qt3DRender::QCamera::upVectorChanged, this, &StarProjection::invalidate);
+    connect(m_camera->lens(), &Qt3DRender::QCameraLens::projectionMatrixChanged, this, &StarProjection::invalidate);
+    connect(m_starRenderer, &InstancedStarRenderer::committed, this, &StarProjection::syncPositions);
+
+    Qt3DLogic::QFrameAction *frameAction = new Qt3DLogic::QFrameAction();
+    connect(frameAction, &Qt3DLogic::QFrameAction::triggered, this, &StarProjection::onFrame);
+    rootEntity->addComponent(frameAction);
+
+    syncPositions();
+}
+
+void StarProjection::invalidate()
+{
+    m_dirty = true;
+}
+
+void StarProjection::onFrame(float dt)
+{
+    Q_UNUSED(dt);
+
+    if (m_dirty)
+        update();
+}
+
+// Copy the committed positions into one array per coordinate
+void StarProjection::syncPositions()
+{
+    const int stars = m_starRenderer->count();
+    m_x.resize(stars);
+    m_y.resize(stars);
+    m_z.resize(stars);
+    for (int i = 0; i < stars; ++i) {
+        const QVector3D position = m_starRenderer->position(i);
+        m_x[i] = position.x();
+        m_y[i] = position.y();
+        m_z[i] = position.z();
+    }
+
+    m_depth.resize(stars);
+    m_distance.resize(stars);
+    m_screenX.resize(stars);
+    m_screenY.resize(stars);
+    m_visible.resize(stars);
+    m_dirty = true;
+}
+
+void StarProjection::update()
+{
+    PerfTimer timer(PerfMonitor::Projection);
+    m_dirty = false;
+
+    const QVector3D eye = m_camera->position();
+    const QVector3D forward = m_camera->viewVector().normalized();
+    const QMatrix4x4 viewProjection = m_camera->lens()->projectionMatrix() * m_camera->viewMatrix();
+
+    // Cone around the view direction that encloses the frustum corners
+    const float aspect = m_camera->aspectRatio();
+    const float tanHalfFov = qTan(qDegreesToRadians(m_camera->fieldOfView()) * 0.5f);
+    const float cosCone = qCos(qAtan(tanHalfFov * qSqrt(1.0f + aspect * aspect)));
+    const float cosConeSquared = cosCone * cosCone;
+    const float farPlane = m_camera->farPlane();
+
+    const int stars = m_x.size();
+    const float *xs = m_x.constData();
+    const float *ys = m_y.constData();
+    const float *zs = m_z.constData();
+    int i = 0;
+    int visible = 0;
+
+#ifdef __SSE2__
+    const __m128 eyeX = _mm_set1_ps(eye.x());
+    const __m128 eyeY = _mm_set1_ps(eye.y());
+    const __m128 eyeZ = _mm_set1_ps(eye.z());
+    const __m128 forwardX = _mm_set1_ps(forward.x());
+    const __m128 forwardY = _mm_set1_ps(forward.y());
+    const __m128 forwardZ = _mm_set1_ps(forward.z());
+    const __m128 cone = _mm_set1_ps(cosConeSquared);
+    const __m128 farSquared = _mm_set1_ps(farPlane * farPlane);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    // Rows of the view-projection matrix used for clip x, y and w
+    __m128 row[3][4];
+    const int rows[3] = { 0, 1, 3 };
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 4; ++c)
+            row[r][c] = _mm_set1_ps(viewProjection(rows[r], c));
+    }
+
+    for (; i + 4 <= stars; i += 4) {
+        const __m128 x = _mm_loadu_ps(xs + i);
+        const __m128 y = _mm_loadu_ps(ys + i);
+        const __m128 z = _mm_loadu_ps(zs + i);
+
+        const __m128 dx = _mm_sub_ps(x, eyeX);
+        const __m128 dy = _mm_sub_ps(y, eyeY);
+        const __m128 dz = _mm_sub_ps(z, eyeZ);
+        const __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                                                  _mm_mul_ps(dz, dz));
+        const __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, forwardX), _mm_mul_ps(dy, forwardY)),
+                                        _mm_mul_ps(dz, forwardZ));
+
+        // In front, inside the cone (depth^2 >= cos^2 * d^2) and before the far plane
+        const __m128 inFront = _mm_cmpgt_ps(depth, zero);
+        const __m128 inCone = _mm_cmpge_ps(_mm_mul_ps(depth, depth), _mm_mul_ps(cone, distanceSquared));
+        const __m128 inRange = _mm_cmplt_ps(distanceSquared, farSquared);
+        const __m128 mask = _mm_and_ps(_mm_and_ps(inFront, inCone), inRange);
+
+        const __m128 clipX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row[0][0], x), _mm_mul_ps(row[0][1], y)),
+                                        _mm_add_ps(_mm_mul_ps(row[0][2], z), row[0][3]));
+        const __m128 clipY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row[1][0], x), _mm_mul_ps(row[1][1], y)),
+                                        _mm_add_ps(_mm_mul_ps(row[1][2], z), row[1][3]));
+        __m128 clipW = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row[2][0], x), _mm_mul_ps(row[2][1], y)),
+                                  _mm_add_ps(_mm_mul_ps(row[2][2], z), row[2][3]));
+
+        // Stars behind the camera divide by one, their flag is off anyway
+        clipW = _mm_or_ps(_mm_and_ps(inFront, clipW), _mm_andnot_ps(inFront, one));
+
+        _mm_storeu_ps(m_depth.data() + i, depth);
+        _mm_storeu_ps(m_distance.data() + i, _mm_sqrt_ps(distanceSquared));
+        _mm_storeu_ps(m_screenX.data() + i, _mm_div_ps(clipX, clipW));
+        _mm_storeu_ps(m_screenY.data() + i, _mm_div_ps(clipY, clipW));
+
+        const int bits = _mm_movemask_ps(mask);
+        for (int lane = 0; lane < 4; ++lane)
+            m_visible[i + lane] = (bits >> lane) & 1;
+        visible += qPopulationCount(quint32(bits));
+    }
+#endif
+
+    // Scalar path for the remainder, or everything without SSE2
+    for (; i < stars; ++i) {
+        const float dx = xs[i] - eye.x();
+        const float dy = ys[i] - eye.y();
+        const float dz = zs[i] - eye.z();
+        const float distanceSquared = dx * dx + dy * dy + dz * dz;
+        const float depth = dx * forward.x() + dy * forward.y() + dz * forward.z();
+
+        const bool inFront = depth > 0.0f;
+        const bool isVisible = inFront
+                               && depth * depth >= cosConeSquared * distanceSquared
+                               && distanceSquared < farPlane * farPlane;
+
+        const float clipX = viewProjection(0, 0) * xs[i] + viewProjection(0, 1) * ys[i]
+                            + viewProjection(0, 2) * zs[i] + viewProjection(0, 3);
+        const float clipY = viewProjection(1, 0) * xs[i] + viewProjection(1, 1) * ys[i]
+                            + viewProjection(1, 2) * zs[i] + viewProjection(1, 3);
+        const float clipW = inFront ? viewProjection(3, 0) * xs[i] + viewProjection(3, 1) * ys[i]
+                                      + viewProjection(3, 2) * zs[i] + viewProjection(3, 3)
+                                    : 1.0f;
+
+        m_depth[i] = depth;
+        m_distance[i] = qSqrt(distanceSquared);
+        m_screenX[i] = clipX / clipW;
+        m_screenY[i] = clipY / clipW;
+        m_visible[i] = isVisible ? 1 : 0;
+        visible += isVisible ? 1 : 0;
+    }
+
+    m_visibleCount = visible;
+    emit updated();
+}
@@ -0,0 +1,80 @@
+#ifndef STARPROJECTION_H
+#define STARPROJECTION_H
+
+#include <QObject>
+#include <QVector>
+#include <Qt3DCore/QEntity>
+#include <Qt3DRender/QCamera>
+#include <Qt3DLogic/QFrameAction>
+#include "instancedstarrenderer.h"
+
+/*
+ * Projects every star against the camera once per frame.
+ *
+ * Star positions are copied into separate x, y and z arrays when the
+ * catalog is committed, and one pass (four stars at a time with SSE2)
+ * fills in the view depth, distance, normalised screen position and a
+ * visibility flag of every star. A star is visible when it lies inside
+ * the cone around the view direction that encloses the frustum and
+ * closer than the far plane, tested with cos(angle) instead of acos.
+ *
+ * Consumers read the arrays after updated() instead of each looping
+ * over the stars with their own vector maths.
+ */
+class StarProjection : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StarProjection(Qt3DCore::QEntity *rootEntity,
+                            Qt3DRender::QCamera *camera,
+                            const InstancedStarRenderer *starRenderer,
+                            QObject *parent = nullptr);
+
+    int count() const { return m_x.size(); }
+
+    // Distance along the view direction, negative behind the camera
+    float depth(int index) const { return m_depth[index]; }
+    float distance(int index) const { return m_distance[index]; }
+
+    // Normalised device coordinates, only meaningful for visible stars
+    float screenX(int index) const { return m_screenX[index]; }
+    float screenY(int index) const { return m_screenY[index]; }
+
+    bool isVisible(int index) const { return m_visible[index] != 0; }
+    int visibleCount() const { return m_visibleCount; }
+
+    // Run the pass now instead of on the next frame
+    void update();
+
+public slots:
+    // Project again on the next frame
+    void invalidate();
+
+signals:
+    void updated();
+
+private slots:
+    void onFrame(float dt);
+    void syncPositions();
+
+private:
+    Qt3DRender::QCamera *m_camera;
+    const InstancedStarRenderer *m_starRenderer;
+    bool m_dirty;
+
+    // Inputs, one array per coordinate
+    QVector<float> m_x;
+    QVector<float> m_y;
+    QVector<float> m_z;
+
+    // Outputs
+    QVector<float> m_depth;
+    QVector<float> m_distance;
+    QVector<float> m_screenX;
+    QVector<float> m_screenY;
+    QVector<quint8> m_visible;
+    int m_visibleCount;
+};
+
+#endif // STARPROJECTION_H
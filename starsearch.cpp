@@ -0,0 +1,98 @@
+#include "starsearch.h"
+#include <algorithm>
+#include <cmath>
+
+QVector<int> StarSearch::byType(const StarCatalog &catalog,
+                                SpectralType::Class spectralClass,
+                                SpectralType::Luminosity luminosity)
+{
+    QVector<SpectralType::Class> classes;
+    if (spectralClass != SpectralType::UnknownClass)
+        classes.append(spectralClass);
+    QVector<SpectralType::Luminosity> luminosities;
+    if (luminosity != SpectralType::UnknownLuminosity)
+        luminosities.append(luminosity);
+
+    return catalog.spectralIndex().match(classes, luminosities).rows();
+}
+
+/*
+ * Octree query in a sphere around the point that doubles until it holds
+ * count stars. The first radius is the side of a cube that would hold
+ * count stars at the catalog's mean density, plus the distance to the
+ * catalog for a point outside it, so a typical query takes one or two
+ * rounds and only touches the leaves around the point.
+ */
+QVector<int> StarSearch::nearest(const StarCatalog &catalog, const StarOctree &octree,
+                                 const QVector3D &point, int count)
+{
+    QVector<int> rows;
+    const int stars = octree.starCount();
+    count = qMin(count, stars);
+    if (count <= 0)
+        return rows;
+
+    const StarOctree::Node &root = octree.nodes().first();
+    float outsideSquared = 0.0f;
+    float farthestSquared = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float below = root.minPoint[axis] - point[axis];
+        const float above = point[axis] - root.maxPoint[axis];
+        const float outside = qMax(qMax(below, above), 0.0f);
+        const float farthest = qMax(qAbs(below), qAbs(above));
+        outsideSquared += outside * outside;
+        farthestSquared += farthest * farthest;
+    }
+
+    const QVector3D size = root.maxPoint - root.minPoint;
+    const float volume = qMax(size.x() * size.y() * size.z(), 1e-6f);
+    float radius = std::sqrt(outsideSquared) + std::cbrt(volume * count / stars);
+
+    QVector<float> distances;
+    while (true) {
+        const float radiusSquared = radius * radius;
+        rows.clear();
+        distances.clear();
+        octree.forEachInSphere(point, radius, [&](int row) {
+            // Leaves hand out every star they hold, only those inside the sphere count
+            const float distanceSquared = (catalog.scenePosition(row) - point).lengthSquared();
+            if (distanceSquared <= radiusSquared) {
+                rows.append(row);
+                distances.append(distanceSquared);
+            }
+        });
+
+        // Every star is inside once the sphere reaches the far corner of the root box
+        if (rows.size() >= count || radiusSquared >= farthestSquared)
+            break;
+        radius *= 2.0f;
+    }
+
+    // The sphere may hold more than count, keep the nearest. Indices into rows
+    // and distances, negated for selectBest() where higher is better.
+    QVector<int> candidates(rows.size());
+    QVector<float> scores(rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        candidates[i] = i;
+        scores[i] = -distances[i];
+    }
+    count = qMin(count, int(candidates.size()));
+    selectBest(candidates, scores, count);
+    candidates.resize(count);
+    std::sort(candidates.begin(), candidates.end(), [&scores](int a, int b) { return scores[a] > scores[b]; });
+
+    QVector<int> nearestRows(count);
+    for (int i = 0; i < count; ++i)
+        nearestRows[i] = rows[candidates[i]];
+    return nearestRows;
+}
+
+void StarSearch::selectBest(QVector<int> &candidates, const QVector<float> &scores, int count)
+{
+    // Only the best count matter, their internal order does not
+    if (count <= 0 || count >= candidates.size())
+        return;
+
+    auto byScore = [&scores](int a, int b) { return scores[a] > scores[b]; };
+    std::nth_element(candidates.begin(), candidates.begin() + count, candidates.end(), byScore);
+}
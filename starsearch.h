@@ -0,0 +1,34 @@
+#ifndef STARSEARCH_H
+#define STARSEARCH_H
+
+#include <QVector>
+#include <QVector3D>
+#include <QString>
+#include "starcatalog.h"
+#include "staroctree.h"
+
+/*
+ * Search kernels over the loaded catalog, shared by the search panel,
+ * the light budget and the benchmarks. No widgets or Qt 3D, part of
+ * astronav_core.
+ */
+class StarSearch
+{
+public:
+    // Rows of the given class and luminosity class, from the catalog's
+    // SpectralIndex. UnknownClass and UnknownLuminosity match everything.
+    static QVector<int> byType(const StarCatalog &catalog,
+                               SpectralType::Class spectralClass,
+                               SpectralType::Luminosity luminosity);
+
+    // Rows of the count stars closest to point, in scene units, nearest first.
+    // octree is built over the catalog's scene positions, e.g. the renderer's.
+    static QVector<int> nearest(const StarCatalog &catalog, const StarOctree &octree,
+                                const QVector3D &point, int count);
+
+    // Reorder candidates so the count with the highest score come first, in any order.
+    // scores is indexed by the values in candidates.
+    static void selectBest(QVector<int> &candidates, const QVector<float> &scores, int count);
+};
+
+#endif // STARSEARCH_H
@@ -0,0 +1,276 @@
+#include "textureloader.h"
+#include <Qt3DRender/QTexture>
+#include <Qt3DRender/QTextureImageData>
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <QPointer>
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
+#include <QDebug>
+
+Q_LOGGING_CATEGORY(lcTextures, "astronav.textures", QtInfoMsg)
+
+// Pre-compressed containers tried before the image itself, in this order
+static const char *COMPRESSED_EXTENSIONS[] = { ".ktx", ".dds" };
+
+/*
+ * Hands an already decoded QImage to Qt 3D. Two generators are the same
+ * when they hold the same image, so re-setting it doesn't upload again.
+ */
+class DecodedImageGenerator : public Qt3DRender::QTextureImageDataGenerator
+{
+public:
+    explicit DecodedImageGenerator(const QImage &image)
+        : m_image(image)
+    {
+    }
+
+    Qt3DRender::QTextureImageDataPtr operator()() override
+    {
+        Qt3DRender::QTextureImageDataPtr data = Qt3DRender::QTextureImageDataPtr::create();
+        data->setImage(m_image);
+        return data;
+    }
+
+    bool operator==(const Qt3DRender::QTextureImageDataGenerator &other) const override
+    {
+        const DecodedImageGenerator *that = Qt3DRender::functor_cast<DecodedImageGenerator>(&other);
+        return that && that->m_image.cacheKey() == m_image.cacheKey();
+    }
+
+    QT3D_FUNCTOR(DecodedImageGenerator)
+
+private:
+    QImage m_image;
+};
+
+// QFile name for a qrc:/ or file url
+static QString fileNameFor(const QString &source)
+{
+    const QUrl url(source);
+    if (url.scheme() == QLatin1String("qrc"))
+        return QLatin1Char(':') + url.path();
+    return url.isLocalFile() ? url.toLocalFile() : source;
+}
+
+// Url of a pre-compressed container with this base name, empty if there is none
+static QString compressedSourceFor(const QString &baseName)
+{
+    for (const char *extension : COMPRESSED_EXTENSIONS) {
+        const QString source = baseName + QLatin1String(extension);
+        if (QFile::exists(fileNameFor(source)))
+            return source;
+    }
+    return QString();
+}
+
+static Qt3DRender::QAbstractTexture *loadCompressed(const QString &source, Qt3DCore::QNode *parent)
+{
+    auto *texture = new Qt3DRender::QTextureLoader(parent);
+
+    // Compressed blocks can't be flipped on load, the file is stored bottom row first
+    texture->setMirrored(false);
+    texture->setSource(QUrl(source));
+
+    // The mipmaps come with the file
+    texture->setMinificationFilter(Qt3DRender::QAbstractTexture::LinearMipMapLinear);
+    texture->setMagnificationFilter(Qt3DRender::QAbstractTexture::Linear);
+    return texture;
+}
+
+DecodedTextureImage::DecodedTextureImage(Qt3DCore::QNode *parent)
+    : Qt3DRender::QAbstractTextureImage(parent)
+{
+}
+
+void DecodedTextureImage::decode(const QString &fileName, bool mirrored)
+{
+    // The image may be gone by the time the decode is done
+    QPointer<DecodedTextureImage> target(this);
+
+    QThreadPool::globalInstance()->start([target, fileName, mirrored]() {
+        QImage image(fileName);
+        if (image.isNull()) {
+            qWarning() << "Could not decode texture" << fileName;
+            return;
+        }
+
+        // Same format Qt 3D would convert to, done here instead of on upload
+        image = image.convertToFormat(QImage::Format_RGBA8888);
+        if (mirrored)
+            image = image.mirrored();
+
+        QMetaObject::invokeMethod(QCoreApplication::instance(), [target, image]() {
+            if (target)
+                target->setImage(image);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DecodedTextureImage::setImage(const QImage &image)
+{
+    m_image = image;
+    notifyDataGeneratorChanged();
+    emit imageDecoded();
+}
+
+Qt3DRender::QTextureImageDataGeneratorPtr DecodedTextureImage::dataGenerator() const
+{
+    return Qt3DRender::QTextureImageDataGeneratorPtr(new DecodedImageGenerator(m_image));
+}
+
+Qt3DRender::QAbstractTexture *loadTexture2D(const QString &source, Qt3DCore::QNode *parent)
+{
+    const QString compressed = compressedSourceFor(source.left(source.lastIndexOf(QLatin1Char('.'))));
+    if (!compressed.isEmpty())
+        return loadCompressed(compressed, parent);
+
+    auto *texture = new Qt3DRender::QTexture2D(parent);
+    auto *image = new DecodedTextureImage(texture);
+    QObject::connect(image, &DecodedTextureImage::imageDecoded, texture, [texture, image]() {
+        texture->addTextureImage(image);
+    }, Qt::SingleShotConnection);
+    image->decode(fileNameFor(source), true);
+    return texture;
+}
+
+Qt3DRender::QAbstractTexture *loadCubeMap(const QString &baseName,
+                                          const QString &extension,
+                                          Qt3DCore::QNode *parent)
+{
+    const QString compressed = compressedSourceFor(baseName);
+    if (!compressed.isEmpty())
+        return loadCompressed(compressed, parent);
+
+    // Same settings as QSkyboxEntity
+    auto *texture = new Qt3DRender::QTextureCubeMap(parent);
+    texture->setMinificationFilter(Qt3DRender::QAbstractTexture::Linear);
+    texture->setMagnificationFilter(Qt3DRender::QAbstractTexture::Linear);
+    texture->setGenerateMipMaps(false);
+    texture->wrapMode()->setX(Qt3DRender::QTextureWrapMode::ClampToEdge);
+    texture->wrapMode()->setY(Qt3DRender::QTextureWrapMode::ClampToEdge);
+    texture->wrapMode()->setZ(Qt3DRender::QTextureWrapMode::ClampToEdge);
+
+    const struct {
+        const char *suffix;
+        Qt3DRender::QAbstractTexture::CubeMapFace face;
+    } faces[] = {
+        { "_posx", Qt3DRender::QAbstractTexture::CubeMapPositiveX },
+        { "_negx", Qt3DRender::QAbstractTexture::CubeMapNegativeX },
+        { "_posy", Qt3DRender::QAbstractTexture::CubeMapPositiveY },
+        { "_negy", Qt3DRender::QAbstractTexture::CubeMapNegativeY },
+        { "_posz", Qt3DRender::QAbstractTexture::CubeMapPositiveZ },
+        { "_negz", Qt3DRender::QAbstractTexture::CubeMapNegativeZ },
+    };
+
+    // The six faces decode in parallel on the pool
+    for (const auto &face : faces) {
+        auto *image = new DecodedTextureImage(texture);
+        image->setFace(face.face);
+        QObject::connect(image, &DecodedTextureImage::imageDecoded, texture, [texture, image]() {
+            texture->addTextureImage(image);
+        }, Qt::SingleShotConnection);
+        image->decode(fileNameFor(baseName + QLatin1String(face.suffix) + extension), false);
+    }
+    return texture;
+}
+
+TextureCache *TextureCache::instance()
+{
+    static TextureCache cache;
+    return &cache;
+}
+
+static QString samplerKey(const TextureCache::Sampler &sampler)
+{
+    return QStringLiteral("%1/%2/%3").arg(int(sampler.minification)).arg(int(sampler.magnification)).arg(int(sampler.wrap));
+}
+
+Qt3DRender::QAbstractTexture *TextureCache::texture2D(const QString &source, const Sampler &sampler)
+{
+    const QString key = QStringLiteral("2d|") + source + QLatin1Char('|') + samplerKey(sampler);
+    if (Qt3DRender::QAbstractTexture *texture = find(key))
+        return texture;
+
+    Qt3DRender::QAbstractTexture *texture = loadTexture2D(source);
+    insert(key, texture, sampler);
+    return texture;
+}
+
+Qt3DRender::QAbstractTexture *TextureCache::cubeMap(const QString &baseName,
+                                                    const QString &extension,
+                                                    const Sampler &sampler)
+{
+    const QString key = QStringLiteral("cube|") + baseName + extension + QLatin1Char('|') + samplerKey(sampler);
+    if (Qt3DRender::QAbstractTexture *texture = find(key))
+        return texture;
+
+    Qt3DRender::QAbstractTexture *texture = loadCubeMap(baseName, extension);
+    insert(key, texture, sampler);
+    return texture;
+}
+
+Qt3DRender::QAbstractTexture *TextureCache::find(const QString &key)
+{
+    const auto it = m_entries.constFind(key);
+    if (it == m_entries.constEnd() || !it->texture)
+        return nullptr;
+
+    ++m_hits;
+    qCDebug(lcTextures) << "cache hit for" << key;
+    emit statisticsChanged();
+    return it->texture;
+}
+
+void TextureCache::insert(const QString &key, Qt3DRender::QAbstractTexture *texture, const Sampler &sampler)
+{
+    ++m_misses;
+    qCInfo(lcTextures) << "loading" << key;
+
+    // A pre-compressed file brings its mipmaps, use them when filtering linearly
+    auto *loader = qobject_cast<Qt3DRender::QTextureLoader *>(texture);
+    if (loader && sampler.minification == Qt3DRender::QAbstractTexture::Linear)
+        texture->setMinificationFilter(Qt3DRender::QAbstractTexture::LinearMipMapLinear);
+    else
+        texture->setMinificationFilter(sampler.minification);
+    texture->setMagnificationFilter(sampler.magnification);
+    texture->wrapMode()->setX(sampler.wrap);
+    texture->wrapMode()->setY(sampler.wrap);
+    texture->wrapMode()->setZ(sampler.wrap);
+
+    m_entries.insert(key, Entry{ texture, 0 });
+
+    if (loader) {
+        addBytes(key, QFileInfo(fileNameFor(loader->source().toString())).size());
+    } else {
+        // Counted once the pixels are there
+        // The images are only added to the texture when decoded, find them as children
+        const auto images = texture->findChildren<DecodedTextureImage *>(Qt::FindDirectChildrenOnly);
+        for (DecodedTextureImage *decoded : images) {
+            connect(decoded, &DecodedTextureImage::imageDecoded, this, [this, key, decoded]() {
+                addBytes(key, decoded->image().sizeInBytes());
+            });
+        }
+    }
+
+    connect(texture, &QObject::destroyed, this, [this, key]() {
+        const Entry entry = m_entries.take(key);
+        m_residentBytes -= entry.bytes;
+        emit statisticsChanged();
+    });
+
+    emit statisticsChanged();
+}
+
+void TextureCache::addBytes(const QString &key, qint64 bytes)
+{
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+        return;
+
+    it->bytes += bytes;
+    m_residentBytes += bytes;
+    qCDebug(lcTextures) << key << "holds" << it->bytes << "bytes," << m_residentBytes << "in all";
+    emit statisticsChanged();
+}
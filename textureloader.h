@@ -0,0 +1,140 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <QObject>
+#include <QString>
+#include <QImage>
+#include <QHash>
+#include <QPointer>
+#include <QLoggingCategory>
+#include <Qt3DCore/QNode>
+#include <Qt3DRender/QAbstractTexture>
+#include <Qt3DRender/QAbstractTextureImage>
+#include <Qt3DRender/QTextureImageDataGenerator>
+#include <Qt3DRender/QTextureWrapMode>
+
+Q_DECLARE_LOGGING_CATEGORY(lcTextures)
+
+/*
+ * Texture image whose pixels were decoded somewhere else.
+ *
+ * decode() reads the image file on a pool thread and hands the QImage
+ * back to the GUI thread, which only passes it on to Qt 3D. The loaders
+ * below add it to its texture on imageDecoded(), until then the texture
+ * stays empty.
+ */
+class DecodedTextureImage : public Qt3DRender::QAbstractTextureImage
+{
+    Q_OBJECT
+
+public:
+    explicit DecodedTextureImage(Qt3DCore::QNode *parent = nullptr);
+
+    // Decode the file on a worker thread, setImage() is called when it is done.
+    // Mirrored flips it so row 0 is the bottom, as QTextureImage does.
+    void decode(const QString &fileName, bool mirrored);
+
+    void setImage(const QImage &image);
+    QImage image() const { return m_image; }
+
+signals:
+    void imageDecoded();
+
+protected:
+    Qt3DRender::QTextureImageDataGeneratorPtr dataGenerator() const override;
+
+private:
+    QImage m_image;
+};
+
+/*
+Function to load a 2D texture. A pre-compressed container with mipmaps
+next to the image (same name, .ktx or .dds) is preferred, otherwise the
+image is decoded on a worker thread
+
+Input:
+- QString with the url of the image (qrc:/ or file)
+- QNode pointer (parent)
+
+Output:
+- Qt3DRender::QAbstractTexture pointer, empty until the data is loaded
+*/
+Qt3DRender::QAbstractTexture *loadTexture2D(const QString &source, Qt3DCore::QNode *parent = nullptr);
+
+/*
+Function to load a cube map. A pre-compressed <baseName>.ktx or .dds
+holding all six faces is preferred, otherwise the six images
+<baseName>_posx<extension> ... _negz<extension> are decoded on worker threads
+
+Input:
+- QString with the base url of the faces (qrc:/ or file)
+- QString with the extension of the face images
+- QNode pointer (parent)
+
+Output:
+- Qt3DRender::QAbstractTexture pointer, empty until the data is loaded
+*/
+Qt3DRender::QAbstractTexture *loadCubeMap(const QString &baseName,
+                                          const QString &extension,
+                                          Qt3DCore::QNode *parent = nullptr);
+
+/*
+ * Process-wide cache of loaded textures.
+ *
+ * Textures are keyed by url and sampler settings, so every material
+ * asking for the same image with the same filtering gets the same
+ * texture node and the image is decoded and uploaded once. A cached
+ * texture has no parent of its own, the first QParameter it is set on
+ * takes it, and it leaves the cache when it is destroyed.
+ *
+ * Hits, misses and the bytes of the decoded or compressed data are
+ * counted, and logged under astronav.textures.
+ */
+class TextureCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Sampler {
+        Qt3DRender::QAbstractTexture::Filter minification = Qt3DRender::QAbstractTexture::Linear;
+        Qt3DRender::QAbstractTexture::Filter magnification = Qt3DRender::QAbstractTexture::Linear;
+        Qt3DRender::QTextureWrapMode::WrapMode wrap = Qt3DRender::QTextureWrapMode::ClampToEdge;
+    };
+
+    static TextureCache *instance();
+
+    // Same as loadTexture2D() and loadCubeMap(), shared between callers
+    Qt3DRender::QAbstractTexture *texture2D(const QString &source, const Sampler &sampler = Sampler());
+    Qt3DRender::QAbstractTexture *cubeMap(const QString &baseName,
+                                          const QString &extension,
+                                          const Sampler &sampler = Sampler());
+
+    int hits() const { return m_hits; }
+    int misses() const { return m_misses; }
+    int count() const { return m_entries.size(); }
+
+    // Bytes of texture data held by the cached textures
+    qint64 residentBytes() const { return m_residentBytes; }
+
+signals:
+    void statisticsChanged();
+
+private:
+    struct Entry {
+        QPointer<Qt3DRender::QAbstractTexture> texture;
+        qint64 bytes;
+    };
+
+    TextureCache() = default;
+
+    Qt3DRender::QAbstractTexture *find(const QString &key);
+    void insert(const QString &key, Qt3DRender::QAbstractTexture *texture, const Sampler &sampler);
+    void addBytes(const QString &key, qint64 bytes);
+
+    QHash<QString, Entry> m_entries;
+    int m_hits = 0;
+    int m_misses = 0;
+    qint64 m_residentBytes = 0;
+};
+
+#endif // TEXTURELOADER_H
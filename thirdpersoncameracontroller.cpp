@@ -1,18 +1,15 @@
 #include "thirdpersoncameracontroller.h"
 
-ThirdPersonCameraController::ThirdPersonCameraController(Qt3DRender::QCamera *camera, Qt3DCore::QEntity *rootEntity, BackgroundMusic *bgMusic, QObject *parent)
-    : QObject(parent), m_camera(camera), m_rootEntity(rootEntity), m_bgMusic(bgMusic),
-    m_isAnimating(false), m_elapsedTime(0.0f), m_focusPoint(0, 0, 0),
+ThirdPersonCameraController::ThirdPersonCameraController(Qt3DRender::QCamera *camera, Qt3DCore::QEntity *rootEntity, BackgroundMusic *bgMusic,
+                                                         AnimationEngine *animator, QObject *parent)
+    : QObject(parent), m_camera(camera), m_rootEntity(rootEntity), m_animator(animator), m_bgMusic(bgMusic),
+    m_isAnimating(false), m_focusPoint(0, 0, 0),
     m_duration(2000.0f), m_easingCurve(QEasingCurve::InOutQuad),
     m_thirdPersonOffset(0, 5, 15)
 {
-    m_cameraTimer = new QTimer(this);
-    m_cameraTimer->setInterval(16);
-    connect(m_cameraTimer, &QTimer::timeout, this, &ThirdPersonCameraController::updateCameraPosition);
-
-    m_focusTimer = new QTimer(this);
-    m_focusTimer->setInterval(16);
-    connect(m_focusTimer, &QTimer::timeout, this, &ThirdPersonCameraController::updateFocus);
+    // The focus is only put back when something moved the view center, no polling
+    if (m_camera)
+        connect(m_camera, &Qt3DRender::QCamera::viewCenterChanged, this, &ThirdPersonCameraController::updateFocus);
 
     // Initialize orbit controller for third-person mode
     m_orbitController = new Qt3DExtras::QOrbitCameraController(rootEntity);
@@ -24,12 +21,9 @@ ThirdPersonCameraController::ThirdPersonCameraController(Qt3DRender::QCamera *ca
 
 ThirdPersonCameraController::~ThirdPersonCameraController()
 {
-    // Clean up timers if active
-    if (m_cameraTimer->isActive())
-        m_cameraTimer->stop();
-
-    if (m_focusTimer->isActive())
-        m_focusTimer->stop();
+    // A running flight would call back into this controller
+    if (m_animator)
+        m_animator->stop(m_flight);
 }
 
 void ThirdPersonCameraController::setEnabled(bool enabled)
@@ -48,10 +42,14 @@ void ThirdPersonCameraController::animateCameraToPosition(const QVector3D &targe
     m_targetPosition = targetPosition;
     m_startViewCenter = m_camera->viewCenter();
     m_targetViewCenter = targetViewCenter;
-    m_elapsedTime = 0.0f;
     m_isAnimating = true;
-    m_cameraTimer->start();
     m_focusPoint = targetViewCenter;
+
+    // Driven by the frame time, a flight takes m_duration ms at any refresh rate
+    m_animator->stop(m_flight);
+    m_flight = m_animator->animate(m_duration, m_easingCurve,
+                                   [this](float t) { updateCameraPosition(t); },
+                                   [this]() { finishAnimation(); });
 }
 
 void ThirdPersonCameraController::teleportToStar(const QVector3D &coordinates, const QString &starId)
@@ -62,34 +60,32 @@ void ThirdPersonCameraController::teleportToStar(const QVector3D &coordinates, c
         m_bgMusic->playSoundEffect(nullptr, QString("qrc:/BackgroundMusic/star_click.wav"));
     }
 
-    const float scaleFactor = 10.0f;
-    QVector3D scaledCoords = coordinates * scaleFactor;
+    // Coordinates come from the star catalog, already in scene units
+    const QVector3D &starPosition = coordinates;
 
     // Calculate direction from current position to star
-    QVector3D toStar = scaledCoords - m_camera->position();
+    QVector3D toStar = starPosition - m_camera->position();
     QVector3D direction = toStar.normalized();
 
     // Set target position at fixed distance from star
-    QVector3D targetCameraPos = scaledCoords - direction * m_stoppingDistance;
+    QVector3D targetCameraPos = starPosition - direction * m_stoppingDistance;
 
     // Animate camera to this position
-    animateCameraToPosition(targetCameraPos, scaledCoords);
+    animateCameraToPosition(targetCameraPos, starPosition);
 
     if (!starId.isEmpty()) {
-        emit starTeleported(starId, scaledCoords);
+        emit starTeleported(starId, starPosition);
     }
 }
 
-void ThirdPersonCameraController::handleStarClick(Qt3DCore::QTransform *starTransform)
+void ThirdPersonCameraController::handleStarClick(const QVector3D &starPosition)
 {
-    if (!m_camera || !starTransform || !m_isEnabled) return;
+    if (!m_camera || !m_isEnabled) return;
 
     if (m_bgMusic) {
         m_bgMusic->playSoundEffect(nullptr, QString("qrc:/BackgroundMusic/star_click.wav"));
     }
 
-    QVector3D starPosition = starTransform->translation();
-
     // Calculate direction from current position to star
     QVector3D toStar = starPosition - m_camera->position();
     QVector3D direction = toStar.normalized();
@@ -101,16 +97,14 @@ void ThirdPersonCameraController::handleStarClick(Qt3DCore::QTransform *starTran
     animateCameraToPosition(targetPosition, starPosition);
 }
 
-void ThirdPersonCameraController::handleSunClick(Qt3DCore::QTransform *sunTransform)
+void ThirdPersonCameraController::handleSunClick(const QVector3D &sunPosition)
 {
-    if (!m_camera || !sunTransform || !m_isEnabled) return;
+    if (!m_camera || !m_isEnabled) return;
 
     if (m_bgMusic) {
         m_bgMusic->playSoundEffect(nullptr, QString("qrc:/BackgroundMusic/star_click.wav"));
     }
 
-    QVector3D sunPosition = sunTransform->translation();
-
     // Position the camera at an offset from the sun for third-person view
     QVector3D targetPosition = sunPosition + m_thirdPersonOffset;
 
@@ -120,19 +114,8 @@ void ThirdPersonCameraController::handleSunClick(Qt3DCore::QTransform *sunTransf
     emit starSelected("Sun", sunPosition);
 }
 
-void ThirdPersonCameraController::updateCameraPosition()
+void ThirdPersonCameraController::updateCameraPosition(float t)
 {
-    m_elapsedTime += 16.0f;
-
-    float t = m_easingCurve.valueForProgress(m_elapsedTime / m_duration);
-    if (t >= 1.0f) {
-        t = 1.0f;
-        m_cameraTimer->stop();
-        m_isAnimating = false;
-        m_camera->setViewCenter(m_targetViewCenter);
-        m_focusTimer->start();
-    }
-
     QVector3D newPosition = m_startPosition * (1 - t) + m_targetPosition * t;
     QVector3D newViewCenter = m_startViewCenter * (1 - t) + m_targetViewCenter * t;
 
@@ -140,9 +123,16 @@ void ThirdPersonCameraController::updateCameraPosition()
     m_camera->setViewCenter(newViewCenter);
 }
 
+void ThirdPersonCameraController::finishAnimation()
+{
+    m_isAnimating = false;
+    m_camera->setViewCenter(m_targetViewCenter);
+    m_holdFocus = true;
+}
+
 void ThirdPersonCameraController::updateFocus()
 {
-    if (!m_isAnimating && m_isEnabled) {
+    if (m_holdFocus && !m_isAnimating && m_isEnabled && m_camera->viewCenter() != m_focusPoint) {
         m_camera->setViewCenter(m_focusPoint);
     }
 }
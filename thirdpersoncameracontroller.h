@@ -2,20 +2,22 @@
 #define THIRDPERSONCAMERACONTROLLER_H
 
 #include <QObject>
-#include <QTimer>
+#include <QPointer>
 #include <QVector3D>
 #include <QEasingCurve>
 #include <Qt3DRender/QCamera>
 #include <Qt3DCore/QTransform>
 #include <Qt3DExtras/QOrbitCameraController>
 #include "music.h"
+#include "animationengine.h"
 
 class ThirdPersonCameraController : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit ThirdPersonCameraController(Qt3DRender::QCamera *camera, Qt3DCore::QEntity *rootEntity, BackgroundMusic *bgMusic, QObject *parent = nullptr);
+    explicit ThirdPersonCameraController(Qt3DRender::QCamera *camera, Qt3DCore::QEntity *rootEntity, BackgroundMusic *bgMusic,
+                                         AnimationEngine *animator, QObject *parent = nullptr);
     ~ThirdPersonCameraController();
 
     void animateCameraToPosition(const QVector3D &targetPosition, const QVector3D &targetViewCenter);
@@ -30,28 +32,30 @@ public:
 
 public slots:
     void teleportToStar(const QVector3D &coordinates, const QString &starId = QString());
-    void handleStarClick(Qt3DCore::QTransform *starTransform);
-    void handleSunClick(Qt3DCore::QTransform *sunTransform);
+    void handleStarClick(const QVector3D &starPosition);
+    void handleSunClick(const QVector3D &sunPosition);
 
 signals:
     void starTeleported(const QString &starId, const QVector3D &position);
     void starSelected(const QString &starId, const QVector3D &position);
 
 private slots:
-    void updateCameraPosition();
     void updateFocus();
 
 private:
+    void updateCameraPosition(float t);
+    void finishAnimation();
+
     Qt3DRender::QCamera *m_camera;
     Qt3DCore::QEntity *m_rootEntity;
-    QTimer *m_cameraTimer;
-    QTimer *m_focusTimer;
+    QPointer<AnimationEngine> m_animator;
+    int m_flight = 0;
+    bool m_holdFocus = false;     // Keep looking at m_focusPoint once a flight is done
     bool m_isAnimating;
     QVector3D m_startPosition;
     QVector3D m_targetPosition;
     QVector3D m_startViewCenter;
     QVector3D m_targetViewCenter;
-    float m_elapsedTime;
     float m_duration;
     QEasingCurve m_easingCurve;
     QVector3D m_focusPoint;